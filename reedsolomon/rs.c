@@ -637,3 +637,30 @@ int reed_solomon_reconstruct(reed_solomon* rs, unsigned char** shards, unsigned
 
     return err;
 }
+
+/**
+ * build the decode matrix for a fixed set of valid shards
+ * input:
+ * rs
+ * valid_shards[rs->data_shards]: indices of the shards used as decode inputs
+ * output:
+ * decode_matrix[rs->data_shards][rs->data_shards]: row i recovers data shard i
+ * */
+int reed_solomon_decode_matrix(reed_solomon* rs, const unsigned char* valid_shards, unsigned char* decode_matrix) {
+    int i, c;
+    int ds = rs->data_shards;
+
+    for (i = 0; i < ds; i++) {
+        if (valid_shards[i] >= rs->shards)
+            return -1;
+
+        for (c = 0; c < ds; c++)
+            decode_matrix[i*ds + c] = rs->m[valid_shards[i]*ds + c];
+    }
+
+    return invert_mat(decode_matrix, ds) ? -1 : 0;
+}
+
+unsigned char reed_solomon_gf_mul(unsigned char a, unsigned char b) {
+    return gf_mul(a, b);
+}
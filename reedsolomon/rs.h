@@ -38,5 +38,22 @@ int reed_solomon_encode(reed_solomon* rs, unsigned char** shards, int nr_shards,
  * marks[nr_shards] marks as errors
  * */
 int reed_solomon_reconstruct(reed_solomon* rs, unsigned char** shards, unsigned char* marks, int nr_shards, int block_size);
+
+/**
+ * build the decode matrix for a fixed set of valid shards, so callers
+ * that see the same erasure patterns repeatedly can invert it only once
+ * input:
+ * rs
+ * valid_shards[rs->data_shards]: indices of the shards used as decode inputs
+ * output:
+ * decode_matrix[rs->data_shards][rs->data_shards]: row i recovers data shard i
+ * returns -1 if the shards cannot be used to recover the data
+ * */
+int reed_solomon_decode_matrix(reed_solomon* rs, const unsigned char* valid_shards, unsigned char* decode_matrix);
+
+/**
+ * multiply two elements of GF(2^8)
+ * */
+unsigned char reed_solomon_gf_mul(unsigned char a, unsigned char b);
 #endif
 
@@ -2,7 +2,8 @@
 
 static SOCKET rtpSocket = INVALID_SOCKET;
 
-static LINKED_BLOCKING_QUEUE packetQueue;
+#define AUDIO_PACKET_QUEUE_BOUND 30
+static SPSC_BLOCKING_QUEUE packetQueue;
 static RTP_AUDIO_QUEUE rtpAudioQueue;
 
 static PLT_THREAD udpPingThread;
@@ -26,8 +27,8 @@ static uint8_t opusHeaderByte;
 #define MAX_PACKET_SIZE 1400
 
 typedef struct _QUEUE_AUDIO_PACKET_HEADER {
-    LINKED_BLOCKING_QUEUE_ENTRY lentry;
     int size;
+    uint32_t presentationTimeMs;
 } QUEUED_AUDIO_PACKET_HEADER, *PQUEUED_AUDIO_PACKET_HEADER;
 
 typedef struct _QUEUED_AUDIO_PACKET {
@@ -35,6 +36,25 @@ typedef struct _QUEUED_AUDIO_PACKET {
     char data[MAX_PACKET_SIZE];
 } QUEUED_AUDIO_PACKET, *PQUEUED_AUDIO_PACKET;
 
+// Packets that are ready together are passed to decodeAndPlaySamples() in batches of up to
+// this many. Batches are only built by the thread calling the audio renderer.
+#define MAX_AUDIO_BATCH_PACKETS 8
+
+static OPUS_SAMPLE audioBatchSamples[MAX_AUDIO_BATCH_PACKETS];
+static PQUEUED_AUDIO_PACKET audioBatchPackets[MAX_AUDIO_BATCH_PACKETS];
+static unsigned char audioBatchDecryptedData[MAX_AUDIO_BATCH_PACKETS][ROUND_TO_PKCS7_PADDED_LEN(MAX_PACKET_SIZE)];
+static int audioBatchCount;
+
+// These are read by other threads for stats. The packet counts are written by the
+// receive thread and the rest by the thread calling the audio renderer.
+static uint32_t dataPacketsReceived;
+static uint32_t fecPacketsReceived;
+static uint32_t resyncDroppedPackets;
+static uint32_t packetsConcealed;
+static uint32_t decryptFailures;
+static uint32_t callbackTimeBuckets[AUDIO_CALLBACK_TIME_BUCKETS];
+static uint32_t maxCallbackTimeUs;
+
 static void AudioPingThreadProc(void* context) {
     char legacyPingData[] = { 0x50, 0x49, 0x4E, 0x47 };
     LC_SOCKADDR saddr;
@@ -66,9 +86,23 @@ static void AudioPingThreadProc(void* context) {
 
 // Initialize the audio stream and start
 int initializeAudioStream(void) {
-    LbqInitializeLinkedBlockingQueue(&packetQueue, 30);
+    int err;
+
+    err = SbqInitializeQueue(&packetQueue, AUDIO_PACKET_QUEUE_BOUND);
+    if (err != 0) {
+        return err;
+    }
+
     RtpaInitializeQueue(&rtpAudioQueue);
     lastSeq = 0;
+    audioBatchCount = 0;
+    dataPacketsReceived = 0;
+    fecPacketsReceived = 0;
+    resyncDroppedPackets = 0;
+    packetsConcealed = 0;
+    decryptFailures = 0;
+    memset(callbackTimeBuckets, 0, sizeof(callbackTimeBuckets));
+    maxCallbackTimeUs = 0;
     receivedDataFromPeer = false;
     pingThreadStarted = false;
     firstReceiveTime = 0;
@@ -100,7 +134,7 @@ int notifyAudioPortNegotiationComplete(void) {
 
     // We may receive audio before our threads are started, but that's okay. We'll
     // drop the first 1 second of audio packets to catch up with the backlog.
-    int err = PltCreateThread("AudioPing", AudioPingThreadProc, NULL, &udpPingThread);
+    int err = PltCreateThread("AudioPing", THREAD_ROLE_DEFAULT, AudioPingThreadProc, NULL, &udpPingThread);
     if (err != 0) {
         return err;
     }
@@ -109,16 +143,13 @@ int notifyAudioPortNegotiationComplete(void) {
     return 0;
 }
 
-static void freePacketList(PLINKED_BLOCKING_QUEUE_ENTRY entry) {
-    PLINKED_BLOCKING_QUEUE_ENTRY nextEntry;
-
-    while (entry != NULL) {
-        nextEntry = entry->flink;
-
-        // The entry is stored within the data allocation
-        free(entry->data);
+static void flushPacketQueue(void) {
+    void* packets[AUDIO_PACKET_QUEUE_BOUND];
+    int count;
 
-        entry = nextEntry;
+    count = SbqFlushQueueItems(&packetQueue, packets);
+    for (int i = 0; i < count; i++) {
+        free(packets[i]);
     }
 }
 
@@ -135,37 +166,79 @@ void destroyAudioStream(void) {
     }
 
     PltDestroyCryptoContext(audioDecryptionCtx);
-    freePacketList(LbqDestroyLinkedBlockingQueue(&packetQueue));
+    flushPacketQueue();
+    SbqDestroyQueue(&packetQueue);
     RtpaCleanupQueue(&rtpAudioQueue);
 }
 
-static bool queuePacketToLbq(PQUEUED_AUDIO_PACKET* packet) {
+void getAudioReorderStats(PRTP_REORDER_STATS stats) {
+    stats->audioReorderedPackets = PltAtomicLoad32(&rtpAudioQueue.reorderEstimator.reorderedPackets);
+    stats->audioOosWaitTimeMs = PltAtomicLoad32(&rtpAudioQueue.oosWaitTimeMs);
+    stats->audioDuplicatePackets = PltAtomicLoad32(&rtpAudioQueue.replayWindow.rejectedPackets);
+}
+
+void LiGetAudioStreamStats(PAUDIO_STREAM_STATS stats) {
+    stats->dataPacketsReceived = PltAtomicLoad32(&dataPacketsReceived);
+    stats->fecPacketsReceived = PltAtomicLoad32(&fecPacketsReceived);
+    stats->packetsRecovered = PltAtomicLoad32(&rtpAudioQueue.recoveredPackets);
+    stats->packetsConcealed = PltAtomicLoad32(&packetsConcealed);
+    stats->oosEvents = PltAtomicLoad32(&rtpAudioQueue.oosEvents);
+    stats->abandonedFecBlocks = PltAtomicLoad32(&rtpAudioQueue.abandonedBlocks);
+    stats->resyncDroppedPackets = PltAtomicLoad32(&resyncDroppedPackets);
+    stats->decryptFailures = PltAtomicLoad32(&decryptFailures);
+    for (int i = 0; i < AUDIO_CALLBACK_TIME_BUCKETS; i++) {
+        stats->callbackTimeBuckets[i] = PltAtomicLoad32(&callbackTimeBuckets[i]);
+    }
+    stats->maxCallbackTimeUs = PltAtomicLoad32(&maxCallbackTimeUs);
+}
+
+static void recordCallbackTime(uint64_t startTimeUs) {
+    uint64_t callbackTimeUs = PltGetMicroseconds() - startTimeUs;
+    int bucket = 0;
+
+    while (bucket < AUDIO_CALLBACK_TIME_BUCKETS - 1 && (1ULL << bucket) <= callbackTimeUs) {
+        bucket++;
+    }
+
+    PltAtomicStore32(&callbackTimeBuckets[bucket], callbackTimeBuckets[bucket] + 1);
+    if (callbackTimeUs > maxCallbackTimeUs) {
+        PltAtomicStore32(&maxCallbackTimeUs, callbackTimeUs > UINT32_MAX ? UINT32_MAX : (uint32_t)callbackTimeUs);
+    }
+}
+
+static bool queuePacketToSbq(PQUEUED_AUDIO_PACKET* packet) {
     int err;
 
     do {
-        err = LbqOfferQueueItem(&packetQueue, *packet, &(*packet)->header.lentry);
+        err = SbqOfferQueueItem(&packetQueue, *packet);
         if (err == LBQ_SUCCESS) {
-            // The LBQ owns the buffer now
+            // The queue owns the buffer now
             *packet = NULL;
         }
         else if (err == LBQ_BOUND_EXCEEDED) {
             Limelog("Audio packet queue overflow\n");
 
             // The audio queue is full, so free all existing items and try again
-            freePacketList(LbqFlushQueueItems(&packetQueue));
+            flushPacketQueue();
         }
     } while (err == LBQ_BOUND_EXCEEDED);
 
     return err == LBQ_SUCCESS;
 }
 
-static void decodeInputData(PQUEUED_AUDIO_PACKET packet) {
+// Gets the Opus data of an audio packet, decrypting it into decryptedOpusData if necessary.
+// The returned sample data is NULL for a placeholder of a missing packet. Returns false if
+// the packet should be dropped.
+static bool getOpusSample(PQUEUED_AUDIO_PACKET packet, unsigned char* decryptedOpusData, POPUS_SAMPLE sample) {
     // If the packet size is zero, this is a placeholder for a missing
     // packet. Trigger packet loss concealment logic in libopus by
     // invoking the decoder with a NULL buffer.
+    sample->presentationTimeMs = packet->header.presentationTimeMs;
     if (packet->header.size == 0) {
-        AudioCallbacks.decodeAndPlaySample(NULL, 0);
-        return;
+        PltAtomicStore32(&packetsConcealed, packetsConcealed + 1);
+        sample->sampleData = NULL;
+        sample->sampleLength = 0;
+        return true;
     }
 
     PRTP_PACKET rtp = (PRTP_PACKET)&packet->data[0];
@@ -176,8 +249,7 @@ static void decodeInputData(PQUEUED_AUDIO_PACKET packet) {
     lastSeq = rtp->sequenceNumber;
 
     if (AudioEncryptionEnabled) {
-        // We must have room for the AES padding which may be written to the buffer
-        unsigned char decryptedOpusData[ROUND_TO_PKCS7_PADDED_LEN(MAX_PACKET_SIZE)];
+        // The caller's buffer must have room for the AES padding which may be written to it
         unsigned char iv[16] = { 0 };
         int dataLength = packet->header.size - sizeof(*rtp);
 
@@ -196,8 +268,9 @@ static void decodeInputData(PQUEUED_AUDIO_PACKET packet) {
                                (unsigned char*)(rtp + 1), dataLength,
                                decryptedOpusData, &dataLength)) {
             Limelog("Failed to decrypt audio packet (sequence number: %u)\n", rtp->sequenceNumber);
+            PltAtomicStore32(&decryptFailures, decryptFailures + 1);
             LC_ASSERT_VT(false);
-            return;
+            return false;
         }
 
 #ifdef LC_DEBUG
@@ -215,7 +288,8 @@ static void decodeInputData(PQUEUED_AUDIO_PACKET packet) {
         }
 #endif
 
-        AudioCallbacks.decodeAndPlaySample((char*)decryptedOpusData, dataLength);
+        sample->sampleData = (char*)decryptedOpusData;
+        sample->sampleLength = dataLength;
     }
     else {
 #ifdef LC_DEBUG
@@ -232,8 +306,66 @@ static void decodeInputData(PQUEUED_AUDIO_PACKET packet) {
         }
 #endif
 
-        AudioCallbacks.decodeAndPlaySample((char*)(rtp + 1), packet->header.size - sizeof(*rtp));
+        sample->sampleData = (char*)(rtp + 1);
+        sample->sampleLength = packet->header.size - sizeof(*rtp);
     }
+
+    return true;
+}
+
+static void decodeInputData(PQUEUED_AUDIO_PACKET packet) {
+    unsigned char decryptedOpusData[ROUND_TO_PKCS7_PADDED_LEN(MAX_PACKET_SIZE)];
+    OPUS_SAMPLE sample;
+    uint64_t startTimeUs;
+
+    if (!getOpusSample(packet, decryptedOpusData, &sample)) {
+        return;
+    }
+
+    mediaClockAudioDelivered(sample.presentationTimeMs);
+
+    startTimeUs = PltGetMicroseconds();
+    if (AudioCallbacks.decodeAndPlaySamples != NULL) {
+        AudioCallbacks.decodeAndPlaySamples(&sample, 1);
+    }
+    else {
+        AudioCallbacks.decodeAndPlaySample(sample.sampleData, sample.sampleLength);
+    }
+    recordCallbackTime(startTimeUs);
+}
+
+// Adds a packet to the batch for decodeAndPlaySamples(), which takes ownership of it
+static void addPacketToAudioBatch(PQUEUED_AUDIO_PACKET packet) {
+    LC_ASSERT(audioBatchCount < MAX_AUDIO_BATCH_PACKETS);
+
+    if (!getOpusSample(packet, audioBatchDecryptedData[audioBatchCount], &audioBatchSamples[audioBatchCount])) {
+        free(packet);
+        return;
+    }
+
+    // The sample may point into the packet, so it's freed after the batch is submitted
+    audioBatchPackets[audioBatchCount++] = packet;
+}
+
+static void submitAudioBatch(void) {
+    uint64_t startTimeUs;
+
+    if (audioBatchCount == 0) {
+        return;
+    }
+
+    for (int i = 0; i < audioBatchCount; i++) {
+        mediaClockAudioDelivered(audioBatchSamples[i].presentationTimeMs);
+    }
+
+    startTimeUs = PltGetMicroseconds();
+    AudioCallbacks.decodeAndPlaySamples(audioBatchSamples, audioBatchCount);
+    recordCallbackTime(startTimeUs);
+
+    for (int i = 0; i < audioBatchCount; i++) {
+        free(audioBatchPackets[i]);
+    }
+    audioBatchCount = 0;
 }
 
 static void AudioReceiveThreadProc(void* context) {
@@ -242,7 +374,7 @@ static void AudioReceiveThreadProc(void* context) {
     int queueStatus;
     bool useSelect;
     uint32_t packetsToDrop;
-    int waitingForAudioMs;
+    uint64_t waitStartMs;
 
     packet = NULL;
     packetsToDrop = 500 / AudioPacketDuration;
@@ -256,7 +388,7 @@ static void AudioReceiveThreadProc(void* context) {
         useSelect = false;
     }
 
-    waitingForAudioMs = 0;
+    waitStartMs = PltGetMillis();
     while (!PltIsThreadInterrupted(&receiveThread)) {
         if (packet == NULL) {
             packet = (PQUEUED_AUDIO_PACKET)malloc(sizeof(*packet));
@@ -267,7 +399,12 @@ static void AudioReceiveThreadProc(void* context) {
             }
         }
 
-        packet->header.size = recvUdpSocket(rtpSocket, &packet->data[0], MAX_PACKET_SIZE, useSelect);
+        // While we're dropping the audio that queued up on the host, a receive timeout
+        // tells us the host has no more of it. Otherwise, we only need to wake up for
+        // packets or interruption.
+        packet->header.size = recvUdpSocket(rtpSocket, &packet->data[0], MAX_PACKET_SIZE, useSelect,
+                                           PltGetThreadInterruptFd(&receiveThread),
+                                           receivedDataFromPeer && packetsToDrop > 0 ? UDP_RECV_POLL_TIMEOUT_MS : -1);
         if (packet->header.size < 0) {
             Limelog("Audio Receive: recvUdpSocket() failed: %d\n", (int)LastSocketError());
             ListenerCallbacks.connectionTerminated(LastSocketFail());
@@ -276,10 +413,7 @@ static void AudioReceiveThreadProc(void* context) {
         else if (packet->header.size == 0) {
             // Receive timed out; try again
             
-            if (!receivedDataFromPeer) {
-                waitingForAudioMs += UDP_RECV_POLL_TIMEOUT_MS;
-            }
-            else {
+            if (receivedDataFromPeer) {
                 // If we hit this path, there are no queued audio packets on the host PC,
                 // so we don't need to drop anything.
                 packetsToDrop = 0;
@@ -296,7 +430,7 @@ static void AudioReceiveThreadProc(void* context) {
 
         if (!receivedDataFromPeer) {
             receivedDataFromPeer = true;
-            Limelog("Received first audio packet after %d ms\n", waitingForAudioMs);
+            Limelog("Received first audio packet after %d ms\n", (int)(PltGetMillis() - waitStartMs));
 
             if (firstReceiveTime != 0) {
                 packetsToDrop += (uint32_t)(PltGetMillis() - firstReceiveTime) / AudioPacketDuration;
@@ -310,6 +444,7 @@ static void AudioReceiveThreadProc(void* context) {
         if (packetsToDrop > 0) {
             // Only count actual audio data (not FEC) in the packets to drop calculation
             if (rtp->packetType == 97) {
+                PltAtomicStore32(&resyncDroppedPackets, resyncDroppedPackets + 1);
                 packetsToDrop--;
             }
             continue;
@@ -320,15 +455,25 @@ static void AudioReceiveThreadProc(void* context) {
         rtp->timestamp = BE32(rtp->timestamp);
         rtp->ssrc = BE32(rtp->ssrc);
 
+        // Audio RTP timestamps are in milliseconds
+        packet->header.presentationTimeMs = rtp->timestamp;
+        if (rtp->packetType == 97) {
+            PltAtomicStore32(&dataPacketsReceived, dataPacketsReceived + 1);
+            mediaClockAddAudioPacket(rtp->timestamp, PltGetMillis());
+        }
+        else if (rtp->packetType == 127) {
+            PltAtomicStore32(&fecPacketsReceived, fecPacketsReceived + 1);
+        }
+
         queueStatus = RtpaAddPacket(&rtpAudioQueue, (PRTP_PACKET)&packet->data[0], (uint16_t)packet->header.size);
         if (RTPQ_HANDLE_NOW(queueStatus)) {
             if ((AudioCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {
-                if (!queuePacketToLbq(&packet)) {
+                if (!queuePacketToSbq(&packet)) {
                     // An exit signal was received
                     break;
                 }
                 else {
-                    // Ownership should have been taken by the LBQ
+                    // Ownership should have been taken by the queue
                     LC_ASSERT(packet == NULL);
                 }
             }
@@ -345,27 +490,38 @@ static void AudioReceiveThreadProc(void* context) {
             if (RTPQ_PACKET_READY(queueStatus)) {
                 // If packets are ready, pull them and send them to the decoder
                 uint16_t length;
+                uint32_t timestamp;
                 PQUEUED_AUDIO_PACKET queuedPacket;
-                while ((queuedPacket = (PQUEUED_AUDIO_PACKET)RtpaGetQueuedPacket(&rtpAudioQueue, sizeof(QUEUED_AUDIO_PACKET_HEADER), &length)) != NULL) {
+                while ((queuedPacket = (PQUEUED_AUDIO_PACKET)RtpaGetQueuedPacket(&rtpAudioQueue, sizeof(QUEUED_AUDIO_PACKET_HEADER), &length, &timestamp)) != NULL) {
                     // Populate header data (not preserved in queued packets)
                     queuedPacket->header.size = length;
+                    queuedPacket->header.presentationTimeMs = timestamp;
 
                     if ((AudioCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {
-                        if (!queuePacketToLbq(&queuedPacket)) {
+                        if (!queuePacketToSbq(&queuedPacket)) {
                             // An exit signal was received
                             free(queuedPacket);
                             break;
                         }
                         else {
-                            // Ownership should have been taken by the LBQ
+                            // Ownership should have been taken by the queue
                             LC_ASSERT(queuedPacket == NULL);
                         }
                     }
+                    else if (AudioCallbacks.decodeAndPlaySamples != NULL) {
+                        // Deliver the packets of this FEC block together
+                        addPacketToAudioBatch(queuedPacket);
+                        if (audioBatchCount == MAX_AUDIO_BATCH_PACKETS) {
+                            submitAudioBatch();
+                        }
+                    }
                     else {
                         decodeInputData(queuedPacket);
                         free(queuedPacket);
                     }
                 }
+
+                submitAudioBatch();
                 
                 // Break on exit
                 if (queuedPacket != NULL) {
@@ -385,15 +541,26 @@ static void AudioDecoderThreadProc(void* context) {
     PQUEUED_AUDIO_PACKET packet;
 
     while (!PltIsThreadInterrupted(&decoderThread)) {
-        err = LbqWaitForQueueElement(&packetQueue, (void**)&packet);
+        err = SbqWaitForQueueElement(&packetQueue, (void**)&packet);
         if (err != LBQ_SUCCESS) {
             // An exit signal was received
             return;
         }
 
-        decodeInputData(packet);
+        if (AudioCallbacks.decodeAndPlaySamples != NULL) {
+            // Deliver this packet along with any others that were queued with it
+            do {
+                addPacketToAudioBatch(packet);
+            } while (audioBatchCount < MAX_AUDIO_BATCH_PACKETS &&
+                     SbqPollQueueElement(&packetQueue, (void**)&packet) == LBQ_SUCCESS);
 
-        free(packet);
+            submitAudioBatch();
+        }
+        else {
+            decodeInputData(packet);
+
+            free(packet);
+        }
     }
 }
 
@@ -406,8 +573,8 @@ void stopAudioStream(void) {
 
     PltInterruptThread(&receiveThread);
     if ((AudioCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {        
-        // Signal threads waiting on the LBQ
-        LbqSignalQueueShutdown(&packetQueue);
+        // Signal threads waiting on the queue
+        SbqSignalQueueShutdown(&packetQueue);
         PltInterruptThread(&decoderThread);
     }
     
@@ -444,7 +611,7 @@ int startAudioStream(void* audioContext, int arFlags) {
 
     AudioCallbacks.start();
 
-    err = PltCreateThread("AudioRecv", AudioReceiveThreadProc, NULL, &receiveThread);
+    err = PltCreateThread("AudioRecv", THREAD_ROLE_AUDIO_RECEIVE, AudioReceiveThreadProc, NULL, &receiveThread);
     if (err != 0) {
         AudioCallbacks.stop();
         closeSocket(rtpSocket);
@@ -453,7 +620,7 @@ int startAudioStream(void* audioContext, int arFlags) {
     }
 
     if ((AudioCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {
-        err = PltCreateThread("AudioDec", AudioDecoderThreadProc, NULL, &decoderThread);
+        err = PltCreateThread("AudioDec", THREAD_ROLE_AUDIO_DECODE, AudioDecoderThreadProc, NULL, &decoderThread);
         if (err != 0) {
             AudioCallbacks.stop();
             PltInterruptThread(&receiveThread);
@@ -468,7 +635,7 @@ int startAudioStream(void* audioContext, int arFlags) {
 }
 
 int LiGetPendingAudioFrames(void) {
-    return LbqGetItemCount(&packetQueue);
+    return SbqGetItemCount(&packetQueue);
 }
 
 int LiGetPendingAudioDuration(void) {
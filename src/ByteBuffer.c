@@ -154,3 +154,27 @@ bool BbPut8(PBYTE_BUFFER buff, uint8_t c) {
 
     return true;
 }
+
+// Get a block of bytes from the byte buffer
+bool BbGetBytes(PBYTE_BUFFER buff, void* data, int length) {
+    if (buff->position + length > buff->length) {
+        return false;
+    }
+
+    memcpy(data, &buff->buffer[buff->position], length);
+    buff->position += length;
+
+    return true;
+}
+
+// Put a block of bytes into the byte buffer
+bool BbPutBytes(PBYTE_BUFFER buff, const void* data, int length) {
+    if (buff->position + length > buff->length) {
+        return false;
+    }
+
+    memcpy(&buff->buffer[buff->position], data, length);
+    buff->position += length;
+
+    return true;
+}
@@ -24,3 +24,112 @@ bool BbPut8(PBYTE_BUFFER buff, uint8_t c);
 bool BbPut16(PBYTE_BUFFER buff, uint16_t s);
 bool BbPut32(PBYTE_BUFFER buff, uint32_t i);
 bool BbPut64(PBYTE_BUFFER buff, uint64_t l);
+
+bool BbGetBytes(PBYTE_BUFFER buff, void* data, int length);
+bool BbPutBytes(PBYTE_BUFFER buff, const void* data, int length);
+
+// Check that the buffer has room for the next length bytes. After this succeeds,
+// the *Unchecked accessors may be used to read or write up to length bytes.
+static inline bool BbReserve(PBYTE_BUFFER buff, int length) {
+    return buff->position + length <= buff->length;
+}
+
+// The unchecked accessors below skip the bounds check and use a byte order
+// fixed at compile time rather than the byte order of the buffer. They are
+// inline since the call would cost more than the access itself.
+
+static inline void BbGet8Unchecked(PBYTE_BUFFER buff, uint8_t* c) {
+    LC_ASSERT(buff->position + sizeof(*c) <= buff->length);
+    memcpy(c, &buff->buffer[buff->position], sizeof(*c));
+    buff->position += sizeof(*c);
+}
+
+static inline void BbGet16LEUnchecked(PBYTE_BUFFER buff, uint16_t* s) {
+    LC_ASSERT(buff->position + sizeof(*s) <= buff->length);
+    memcpy(s, &buff->buffer[buff->position], sizeof(*s));
+    buff->position += sizeof(*s);
+    *s = LE16(*s);
+}
+
+static inline void BbGet16BEUnchecked(PBYTE_BUFFER buff, uint16_t* s) {
+    LC_ASSERT(buff->position + sizeof(*s) <= buff->length);
+    memcpy(s, &buff->buffer[buff->position], sizeof(*s));
+    buff->position += sizeof(*s);
+    *s = BE16(*s);
+}
+
+static inline void BbGet32LEUnchecked(PBYTE_BUFFER buff, uint32_t* i) {
+    LC_ASSERT(buff->position + sizeof(*i) <= buff->length);
+    memcpy(i, &buff->buffer[buff->position], sizeof(*i));
+    buff->position += sizeof(*i);
+    *i = LE32(*i);
+}
+
+static inline void BbGet32BEUnchecked(PBYTE_BUFFER buff, uint32_t* i) {
+    LC_ASSERT(buff->position + sizeof(*i) <= buff->length);
+    memcpy(i, &buff->buffer[buff->position], sizeof(*i));
+    buff->position += sizeof(*i);
+    *i = BE32(*i);
+}
+
+static inline void BbGet64LEUnchecked(PBYTE_BUFFER buff, uint64_t* l) {
+    LC_ASSERT(buff->position + sizeof(*l) <= buff->length);
+    memcpy(l, &buff->buffer[buff->position], sizeof(*l));
+    buff->position += sizeof(*l);
+    *l = LE64(*l);
+}
+
+static inline void BbGet64BEUnchecked(PBYTE_BUFFER buff, uint64_t* l) {
+    LC_ASSERT(buff->position + sizeof(*l) <= buff->length);
+    memcpy(l, &buff->buffer[buff->position], sizeof(*l));
+    buff->position += sizeof(*l);
+    *l = BE64(*l);
+}
+
+static inline void BbPut8Unchecked(PBYTE_BUFFER buff, uint8_t c) {
+    LC_ASSERT(buff->position + sizeof(c) <= buff->length);
+    memcpy(&buff->buffer[buff->position], &c, sizeof(c));
+    buff->position += sizeof(c);
+}
+
+static inline void BbPut16LEUnchecked(PBYTE_BUFFER buff, uint16_t s) {
+    LC_ASSERT(buff->position + sizeof(s) <= buff->length);
+    s = LE16(s);
+    memcpy(&buff->buffer[buff->position], &s, sizeof(s));
+    buff->position += sizeof(s);
+}
+
+static inline void BbPut16BEUnchecked(PBYTE_BUFFER buff, uint16_t s) {
+    LC_ASSERT(buff->position + sizeof(s) <= buff->length);
+    s = BE16(s);
+    memcpy(&buff->buffer[buff->position], &s, sizeof(s));
+    buff->position += sizeof(s);
+}
+
+static inline void BbPut32LEUnchecked(PBYTE_BUFFER buff, uint32_t i) {
+    LC_ASSERT(buff->position + sizeof(i) <= buff->length);
+    i = LE32(i);
+    memcpy(&buff->buffer[buff->position], &i, sizeof(i));
+    buff->position += sizeof(i);
+}
+
+static inline void BbPut32BEUnchecked(PBYTE_BUFFER buff, uint32_t i) {
+    LC_ASSERT(buff->position + sizeof(i) <= buff->length);
+    i = BE32(i);
+    memcpy(&buff->buffer[buff->position], &i, sizeof(i));
+    buff->position += sizeof(i);
+}
+
+static inline void BbPut64LEUnchecked(PBYTE_BUFFER buff, uint64_t l) {
+    LC_ASSERT(buff->position + sizeof(l) <= buff->length);
+    l = LE64(l);
+    memcpy(&buff->buffer[buff->position], &l, sizeof(l));
+    buff->position += sizeof(l);
+}
+
+static inline void BbPut64BEUnchecked(PBYTE_BUFFER buff, uint64_t l) {
+    LC_ASSERT(buff->position + sizeof(l) <= buff->length);
+    l = BE64(l);
+    memcpy(&buff->buffer[buff->position], &l, sizeof(l));
+    buff->position += sizeof(l);
+}
@@ -168,7 +168,7 @@ static void ClInternalConnectionTerminated(int errorCode)
     alreadyTerminated = true;
 
     // Invoke the termination callback on a separate thread
-    err = PltCreateThread("AsyncTerm", terminationCallbackThreadFunc, NULL, &terminationCallbackThread);
+    err = PltCreateThread("AsyncTerm", THREAD_ROLE_DEFAULT, terminationCallbackThreadFunc, NULL, &terminationCallbackThread);
     if (err != 0) {
         // Nothing we can safely do here, so we'll just assert on debug builds
         Limelog("Failed to create termination thread: %d\n", err);
@@ -281,6 +281,7 @@ int LiStartConnection(PSERVER_INFORMATION serverInfo, PSTREAM_CONFIGURATION stre
 
     alreadyTerminated = false;
     ConnectionInterrupted = false;
+    initializeMediaClock();
     
     // Validate the audio configuration
     if (MAGIC_BYTE_FROM_AUDIO_CONFIG(StreamConfig.audioConfiguration) != 0xCA ||
@@ -328,6 +329,13 @@ int LiStartConnection(PSERVER_INFORMATION serverInfo, PSTREAM_CONFIGURATION stre
         Limelog("Disabling reference frame invalidation for 4K streaming with GFE\n");
         VideoCallbacks.capabilities &= ~CAPABILITY_REFERENCE_FRAME_INVALIDATION_AVC;
     }
+
+    // Partial frames are submitted from the receive thread, so they can't be used with a decode unit queue
+    if ((VideoCallbacks.capabilities & CAPABILITY_PARTIAL_FRAME_SUBMIT) &&
+            (!(VideoCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) || VideoCallbacks.submitPartialDecodeUnit == NULL)) {
+        Limelog("Disabling partial frame submission without CAPABILITY_DIRECT_SUBMIT and submitPartialDecodeUnit()\n");
+        VideoCallbacks.capabilities &= ~CAPABILITY_PARTIAL_FRAME_SUBMIT;
+    }
     
     Limelog("Initializing platform...");
     ListenerCallbacks.stageStarting(STAGE_PLATFORM_INIT);
@@ -452,7 +460,12 @@ int LiStartConnection(PSERVER_INFORMATION serverInfo, PSTREAM_CONFIGURATION stre
 
     Limelog("Initializing video stream...");
     ListenerCallbacks.stageStarting(STAGE_VIDEO_STREAM_INIT);
-    initializeVideoStream();
+    err = initializeVideoStream();
+    if (err != 0) {
+        Limelog("failed: %d\n", err);
+        ListenerCallbacks.stageFailed(STAGE_VIDEO_STREAM_INIT, err);
+        goto Cleanup;
+    }
     stage++;
     LC_ASSERT(stage == STAGE_VIDEO_STREAM_INIT);
     ListenerCallbacks.stageComplete(STAGE_VIDEO_STREAM_INIT);
@@ -38,38 +38,30 @@ typedef struct _QUEUED_FRAME_FEC_STATUS {
     LINKED_BLOCKING_QUEUE_ENTRY entry;
 } QUEUED_FRAME_FEC_STATUS, *PQUEUED_FRAME_FEC_STATUS;
 
-typedef struct _QUEUED_ASYNC_CALLBACK {
-    int typeIndex;
-    union {
-        struct {
-            uint16_t controllerNumber;
-            uint16_t lowFreqRumble;
-            uint16_t highFreqRumble;
-        } rumble;
-        struct {
-            uint16_t controllerNumber;
-            uint16_t leftTriggerMotor;
-            uint16_t rightTriggerMotor;
-        } rumbleTriggers;
-        struct {
-            uint16_t controllerNumber;
-            uint16_t reportRateHz;
-            uint8_t motionType;
-        } setMotionEventState;
-        struct {
-            uint16_t controllerNumber;
-            uint8_t r;
-            uint8_t g;
-            uint8_t b;
-        } setControllerLed;
-    } data;
-    LINKED_BLOCKING_QUEUE_ENTRY entry;
-} QUEUED_ASYNC_CALLBACK, *PQUEUED_ASYNC_CALLBACK;
+// Async callbacks are coalesced into a latest-value slot per controller for each
+// callback type. The control receive thread stores the new value into the slot and
+// then sets the controller's pending bit. The callback thread atomically takes all
+// pending bits at once, so it invokes at most one callback per controller per type
+// for each wakeup no matter how many updates the host sends.
+#define ASYNC_CB_RUMBLE 0
+#define ASYNC_CB_RUMBLE_TRIGGERS 1
+#define ASYNC_CB_CONTROLLER_LED 2
+#define ASYNC_CB_MOTION_ACCEL 3
+#define ASYNC_CB_MOTION_GYRO 4
+#define ASYNC_CB_TYPE_COUNT 5
+
+// This matches the size of the active gamepad mask
+#define MAX_ASYNC_CB_CONTROLLERS 16
+
+static uint32_t asyncCallbackValues[ASYNC_CB_TYPE_COUNT][MAX_ASYNC_CB_CONTROLLERS];
+static uint32_t asyncCallbackPendingMasks[ASYNC_CB_TYPE_COUNT];
+static uint32_t asyncHdrCallbackPending;
+static uint32_t asyncCallbackWakePending;
+static PLT_EVENT asyncCallbackEvent;
 
 static SOCKET ctlSock = INVALID_SOCKET;
 static ENetHost* client;
 static ENetPeer* peer;
-static PLT_MUTEX enetMutex;
 static bool usePeriodicPing;
 
 static PLT_THREAD lossStatsThread;
@@ -95,12 +87,151 @@ static uint64_t firstFrameTimeMs;
 
 static LINKED_BLOCKING_QUEUE invalidReferenceFrameTuples;
 static LINKED_BLOCKING_QUEUE frameFecStatusQueue;
-static LINKED_BLOCKING_QUEUE asyncCallbackQueue;
 static PLT_EVENT idrFrameRequiredEvent;
 
 static PPLT_CRYPTO_CONTEXT encryptionCtx;
 static PPLT_CRYPTO_CONTEXT decryptionCtx;
 
+// Outgoing ENet control messages are built directly in buffers from this pool and
+// handed to ENet with ENET_PACKET_FLAG_NO_ALLOCATE. The packet free callback returns
+// the buffer to the pool, so steady-state control traffic doesn't allocate packet data.
+// Larger messages fall back to packet data allocated by ENet.
+#define MAX_CONTROL_PLAINTEXT_LENGTH 256
+#define CONTROL_PACKET_BUFFER_SIZE (sizeof(NVCTL_ENCRYPTED_PACKET_HEADER) + AES_GCM_TAG_LENGTH + MAX_CONTROL_PLAINTEXT_LENGTH)
+#define CONTROL_PACKET_POOL_MAX_FREE 32
+
+typedef union _CONTROL_PACKET_BUFFER {
+    union _CONTROL_PACKET_BUFFER* next;
+    enet_uint8 data[CONTROL_PACKET_BUFFER_SIZE];
+} CONTROL_PACKET_BUFFER, *PCONTROL_PACKET_BUFFER;
+
+static PLT_MUTEX controlPacketPoolMutex;
+static PCONTROL_PACKET_BUFFER controlPacketFreeList;
+static int controlPacketFreeCount;
+
+// Once the control receive thread is started, it exclusively owns the ENet host. Other
+// threads submit outgoing messages through a bounded lock-free ring, where each slot's
+// sequence number tells whether it is free for the sender claiming that position or
+// filled for the control receive thread. Senders wake the control receive thread by
+// sending a datagram to a loopback socket that it waits on along with the ENet socket.
+// Senders that find the ring full block until the control receive thread frees a slot.
+//
+// Without a wake socket (such as on the 3DS, where binding to the wildcard port is broken),
+// the control receive thread can't be woken for submitted messages. In that case, every
+// thread uses the ENet host directly while holding enetMutex instead.
+#define CONTROL_SEND_RING_SIZE 128
+
+// Power of 2 buckets of the time from submitting a message to handing it to ENet
+#define CONTROL_SEND_LATENCY_BUCKETS 24
+
+typedef struct _CONTROL_SEND_COMMAND {
+    uint32_t sequence;
+    ENetPacket* packet;
+    int plaintextLength;
+    uint8_t channelId;
+    bool flush;
+    uint64_t submitTimeUs;
+} CONTROL_SEND_COMMAND, *PCONTROL_SEND_COMMAND;
+
+static CONTROL_SEND_COMMAND controlSendRing[CONTROL_SEND_RING_SIZE];
+static uint32_t controlSendEnqueuePos;
+static uint32_t controlSendDequeuePos;
+static uint32_t controlSendFlushPending;
+static uint32_t controlSendWakePending;
+static uint32_t enetOwnerRunning;
+static SOCKET enetWakeSock = INVALID_SOCKET;
+static PLT_MUTEX enetMutex;
+
+static PLT_MUTEX controlSendSpaceMutex;
+static PLT_COND controlSendSpaceCond;
+static uint32_t controlSendSpaceWaiters;
+
+static uint32_t controlSendLatencyBuckets[CONTROL_SEND_LATENCY_BUCKETS];
+static uint64_t controlSendLatencyMaxUs;
+
+// Peer state published by the owner of the ENet host for other threads. Readers
+// retry if the version is odd or changes while they read, like a seqlock.
+static uint32_t peerSnapshotVersion;
+static uint32_t peerSnapshotConnected;
+static uint32_t peerSnapshotRtt;
+static uint32_t peerSnapshotRttVariance;
+static uint32_t peerSnapshotReliableDataInTransit;
+
+static bool enqueueControlSendCommand(ENetPacket* packet, int plaintextLength, uint8_t channelId, bool flush) {
+    PCONTROL_SEND_COMMAND command;
+    uint32_t pos;
+
+    pos = PltAtomicLoad32(&controlSendEnqueuePos);
+    for (;;) {
+        int32_t diff;
+
+        command = &controlSendRing[pos % CONTROL_SEND_RING_SIZE];
+        diff = (int32_t)(PltAtomicLoad32(&command->sequence) - pos);
+        if (diff == 0) {
+            // This slot is free, so try to claim it
+            if (PltAtomicCompareExchange32(&controlSendEnqueuePos, pos, pos + 1)) {
+                break;
+            }
+        }
+        else if (diff < 0) {
+            // The ring is full
+            return false;
+        }
+
+        // Another sender claimed this position first
+        pos = PltAtomicLoad32(&controlSendEnqueuePos);
+    }
+
+    command->packet = packet;
+    command->plaintextLength = plaintextLength;
+    command->channelId = channelId;
+    command->flush = flush;
+    command->submitTimeUs = PltGetMicroseconds();
+
+    // Publish the filled slot to the owner of the ENet host
+    PltAtomicStore32(&command->sequence, pos + 1);
+    return true;
+}
+
+static bool isControlSendRingFull(void) {
+    uint32_t pos = PltAtomicLoad32(&controlSendEnqueuePos);
+    return (int32_t)(PltAtomicLoad32(&controlSendRing[pos % CONTROL_SEND_RING_SIZE].sequence) - pos) < 0;
+}
+
+static void wakeControlSendSpaceWaiters(void) {
+    // The waiter checks for space with the mutex held, so taking it here
+    // ensures the waiter is either blocked or will see the free slot.
+    if (PltAtomicLoad32(&controlSendSpaceWaiters) != 0) {
+        PltLockMutex(&controlSendSpaceMutex);
+        PltUnlockMutex(&controlSendSpaceMutex);
+        PltSignalConditionVariable(&controlSendSpaceCond);
+    }
+}
+
+// Must only be called by the owner of the ENet host
+static bool dequeueControlSendCommand(PCONTROL_SEND_COMMAND command) {
+    PCONTROL_SEND_COMMAND slot = &controlSendRing[controlSendDequeuePos % CONTROL_SEND_RING_SIZE];
+
+    if (PltAtomicLoad32(&slot->sequence) != controlSendDequeuePos + 1) {
+        return false;
+    }
+
+    *command = *slot;
+
+    // Free the slot for the sender that wraps around to it
+    PltAtomicStore32(&slot->sequence, controlSendDequeuePos + CONTROL_SEND_RING_SIZE);
+    PltAtomicStore32(&controlSendDequeuePos, controlSendDequeuePos + 1);
+    return true;
+}
+
+static void discardControlSendCommands(void) {
+    CONTROL_SEND_COMMAND command;
+
+    while (dequeueControlSendCommand(&command)) {
+        enet_packet_destroy(command.packet);
+    }
+}
+
 #define CONN_IMMEDIATE_POOR_LOSS_RATE 30
 #define CONN_CONSECUTIVE_POOR_LOSS_RATE 15
 #define CONN_OKAY_LOSS_RATE 5
@@ -272,6 +403,7 @@ static char**preconstructedPayloads;
 static bool supportsIdrFrameRequest;
 
 #define LOSS_REPORT_INTERVAL_MS 50
+#define LOSS_STATS_PAYLOAD_LENGTH 32
 #define PERIODIC_PING_INTERVAL_MS 100
 
 // Initializes the control stream
@@ -280,8 +412,33 @@ int initializeControlStream(void) {
     PltCreateEvent(&idrFrameRequiredEvent);
     LbqInitializeLinkedBlockingQueue(&invalidReferenceFrameTuples, 20);
     LbqInitializeLinkedBlockingQueue(&frameFecStatusQueue, 8); // Limits number of frame status reports per periodic ping interval
-    LbqInitializeLinkedBlockingQueue(&asyncCallbackQueue, 30);
+    PltCreateEvent(&asyncCallbackEvent);
+    memset(asyncCallbackValues, 0, sizeof(asyncCallbackValues));
+    memset(asyncCallbackPendingMasks, 0, sizeof(asyncCallbackPendingMasks));
+    asyncHdrCallbackPending = 0;
+    asyncCallbackWakePending = 0;
+    PltCreateMutex(&controlPacketPoolMutex);
     PltCreateMutex(&enetMutex);
+    PltCreateMutex(&controlSendSpaceMutex);
+    PltCreateConditionVariable(&controlSendSpaceCond, &controlSendSpaceMutex);
+    controlSendSpaceWaiters = 0;
+    controlPacketFreeList = NULL;
+    controlPacketFreeCount = 0;
+    for (uint32_t i = 0; i < CONTROL_SEND_RING_SIZE; i++) {
+        controlSendRing[i].sequence = i;
+    }
+    controlSendEnqueuePos = 0;
+    controlSendDequeuePos = 0;
+    controlSendFlushPending = 0;
+    controlSendWakePending = 0;
+    enetOwnerRunning = 0;
+    memset(controlSendLatencyBuckets, 0, sizeof(controlSendLatencyBuckets));
+    controlSendLatencyMaxUs = 0;
+    peerSnapshotVersion = 0;
+    peerSnapshotConnected = 0;
+    peerSnapshotRtt = 0;
+    peerSnapshotRttVariance = 0;
+    peerSnapshotReliableDataInTransit = 0;
 
     encryptedControlStream = APP_VERSION_AT_LEAST(7, 1, 431);
 
@@ -355,8 +512,26 @@ void destroyControlStream(void) {
     PltCloseEvent(&idrFrameRequiredEvent);
     freeBasicLbqList(LbqDestroyLinkedBlockingQueue(&invalidReferenceFrameTuples));
     freeBasicLbqList(LbqDestroyLinkedBlockingQueue(&frameFecStatusQueue));
-    freeBasicLbqList(LbqDestroyLinkedBlockingQueue(&asyncCallbackQueue));
+    PltCloseEvent(&asyncCallbackEvent);
 
+    // Release messages that were never handed to ENet
+    discardControlSendCommands();
+    if (enetWakeSock != INVALID_SOCKET) {
+        closeSocket(enetWakeSock);
+        enetWakeSock = INVALID_SOCKET;
+    }
+
+    // All pooled packets were returned when the ENet host was destroyed
+    while (controlPacketFreeList != NULL) {
+        PCONTROL_PACKET_BUFFER buffer = controlPacketFreeList;
+        controlPacketFreeList = buffer->next;
+        free(buffer);
+    }
+    controlPacketFreeCount = 0;
+
+    PltDeleteMutex(&controlPacketPoolMutex);
+    PltDeleteConditionVariable(&controlSendSpaceCond);
+    PltDeleteMutex(&controlSendSpaceMutex);
     PltDeleteMutex(&enetMutex);
 }
 
@@ -499,18 +674,20 @@ static PNVCTL_TCP_PACKET_HEADER readNvctlPacketTcp(void) {
     return fullPacket;
 }
 
-static bool encryptControlMessage(PNVCTL_ENCRYPTED_PACKET_HEADER encPacket, PNVCTL_ENET_PACKET_HEADER_V2 packet) {
+// The plaintext must already be framed in wire byte-order. encPacket must have room
+// for the encrypted header, GCM tag, and ciphertext.
+static bool encryptControlMessage(PNVCTL_ENCRYPTED_PACKET_HEADER encPacket, uint32_t seq, unsigned char* plaintext, int plaintextLength) {
+    BYTE_BUFFER bb;
     unsigned char iv[16] = { 0 };
     int ivSize;
-    int encryptedSize = sizeof(*packet) + packet->payloadLength;
+    int encryptedSize = plaintextLength;
 
-    // NB: Setting the IV must happen while encPacket->seq is still in native byte-order!
     if (EncryptionFeaturesEnabled & SS_ENC_CONTROL_V2) {
         // Populate the IV in little endian byte order
-        iv[3] = (unsigned char)(encPacket->seq >> 24);
-        iv[2] = (unsigned char)(encPacket->seq >> 16);
-        iv[1] = (unsigned char)(encPacket->seq >> 8);
-        iv[0] = (unsigned char)(encPacket->seq >> 0);
+        iv[3] = (unsigned char)(seq >> 24);
+        iv[2] = (unsigned char)(seq >> 16);
+        iv[1] = (unsigned char)(seq >> 8);
+        iv[0] = (unsigned char)(seq >> 0);
 
         // Set high bytes to something unique to ensure no IV collisions
         iv[10] = (unsigned char)'C'; // Client originated
@@ -521,18 +698,16 @@ static bool encryptControlMessage(PNVCTL_ENCRYPTED_PACKET_HEADER encPacket, PNVC
     }
     else {
         // This is a truncating cast, but it's what Nvidia does, so we have to mimic it.
-        iv[0] = (unsigned char)encPacket->seq;
+        iv[0] = (unsigned char)seq;
 
         // Nvidia's old style encryption uses a 16-byte IV
         ivSize = 16;
     }
 
-    encPacket->encryptedHeaderType = LE16(encPacket->encryptedHeaderType);
-    encPacket->length = LE16(encPacket->length);
-    encPacket->seq = LE32(encPacket->seq);
-
-    packet->type = LE16(packet->type);
-    packet->payloadLength = LE16(packet->payloadLength);
+    BbInitializeWrappedBuffer(&bb, (char*)encPacket, 0, sizeof(*encPacket), BYTE_ORDER_LITTLE);
+    BbPut16LEUnchecked(&bb, 0x0001);
+    BbPut16LEUnchecked(&bb, (uint16_t)(sizeof(encPacket->seq) + AES_GCM_TAG_LENGTH + plaintextLength));
+    BbPut32LEUnchecked(&bb, seq);
 
     LC_ASSERT(ivSize <= (int)sizeof(iv));
     LC_ASSERT(ivSize == 12 || ivSize == 16);
@@ -540,7 +715,7 @@ static bool encryptControlMessage(PNVCTL_ENCRYPTED_PACKET_HEADER encPacket, PNVC
                              (unsigned char*)StreamConfig.remoteInputAesKey, sizeof(StreamConfig.remoteInputAesKey),
                              iv, ivSize,
                              (unsigned char*)(encPacket + 1), AES_GCM_TAG_LENGTH, // Write tag into the space after the encrypted header
-                             (unsigned char*)packet, encryptedSize,
+                             plaintext, plaintextLength,
                              ((unsigned char*)(encPacket + 1)) + AES_GCM_TAG_LENGTH, &encryptedSize); // Write ciphertext after the GCM tag
 }
 
@@ -616,103 +791,277 @@ static bool decryptControlMessageToV1(PNVCTL_ENCRYPTED_PACKET_HEADER encPacket,
     return true;
 }
 
+static PCONTROL_PACKET_BUFFER allocateControlPacketBuffer(void) {
+    PCONTROL_PACKET_BUFFER buffer;
+
+    PltLockMutex(&controlPacketPoolMutex);
+    buffer = controlPacketFreeList;
+    if (buffer != NULL) {
+        controlPacketFreeList = buffer->next;
+        controlPacketFreeCount--;
+    }
+    PltUnlockMutex(&controlPacketPoolMutex);
+
+    // Grow the pool if all buffers are in flight
+    if (buffer == NULL) {
+        buffer = malloc(sizeof(*buffer));
+    }
+
+    return buffer;
+}
+
+static void freeControlPacketBuffer(PCONTROL_PACKET_BUFFER buffer) {
+    PltLockMutex(&controlPacketPoolMutex);
+    if (controlPacketFreeCount < CONTROL_PACKET_POOL_MAX_FREE) {
+        buffer->next = controlPacketFreeList;
+        controlPacketFreeList = buffer;
+        controlPacketFreeCount++;
+        buffer = NULL;
+    }
+    PltUnlockMutex(&controlPacketPoolMutex);
+
+    // Trim the pool after a burst of in-flight packets
+    if (buffer != NULL) {
+        free(buffer);
+    }
+}
+
 static void enetPacketFreeCb(ENetPacket* packet) {
-    if (packet->userData) {
-        // userData contains a bool that we will set when freed
-        *(volatile bool*)packet->userData = true;
+    // ENet doesn't own the data of pooled packets
+    if (packet->flags & ENET_PACKET_FLAG_NO_ALLOCATE) {
+        freeControlPacketBuffer((PCONTROL_PACKET_BUFFER)packet->data);
     }
 }
 
+// Creates a packet for an outgoing control message. Messages that fit in a pooled
+// buffer are built there rather than in data allocated by ENet.
+static ENetPacket* createControlPacket(int length, uint32_t flags) {
+    PCONTROL_PACKET_BUFFER buffer;
+    ENetPacket* packet;
 
-// Must be called with enetMutex held
-static bool isPacketSentWaitingForAck(ENetPacket* packet) {
-    ENetOutgoingCommand* outgoingCommand = NULL;
-    ENetListIterator currentCommand;
+    if (length > (int)sizeof(buffer->data)) {
+        packet = enet_packet_create(NULL, length, flags);
+    }
+    else {
+        buffer = allocateControlPacketBuffer();
+        if (buffer == NULL) {
+            return NULL;
+        }
 
-    // Look for our packet on the sent commands list
-    for (currentCommand = enet_list_begin(&peer->sentReliableCommands);
-         currentCommand != enet_list_end(&peer->sentReliableCommands);
-         currentCommand = enet_list_next(currentCommand))
-    {
-        outgoingCommand = (ENetOutgoingCommand*)currentCommand;
-        if (outgoingCommand->packet == packet) {
-            return true;
+        packet = enet_packet_create(buffer->data, length, flags | ENET_PACKET_FLAG_NO_ALLOCATE);
+        if (packet == NULL) {
+            freeControlPacketBuffer(buffer);
+            return NULL;
         }
     }
 
-    return false;
+    if (packet != NULL) {
+        // The free callback must stay set for the lifetime of the packet
+        packet->freeCallback = enetPacketFreeCb;
+    }
+
+    return packet;
 }
 
-static bool sendMessageEnet(short ptype, short paylen, const void* payload, uint8_t channelId, uint32_t flags, bool moreData) {
-    ENetPacket* enetPacket;
-    int err;
 
-    LC_ASSERT(AppVersionQuad[0] >= 5);
+static SOCKET createWakeSocket(void) {
+#ifdef __3DS__
+    // Binding to the wildcard port is broken on the 3DS
+    return INVALID_SOCKET;
+#else
+    struct sockaddr_in addr;
+    SOCKADDR_LEN addrLen = sizeof(addr);
+    SOCKET s;
 
-    // Only send reliable packets to GFE
-    if (!IS_SUNSHINE()) {
-        flags = ENET_PACKET_FLAG_RELIABLE;
+    s = createSocket(AF_INET, SOCK_DGRAM, IPPROTO_UDP, true);
+    if (s == INVALID_SOCKET) {
+        return INVALID_SOCKET;
     }
 
-    if (encryptedControlStream) {
-        PNVCTL_ENCRYPTED_PACKET_HEADER encPacket;
-        PNVCTL_ENET_PACKET_HEADER_V2 packet;
-        char tempBuffer[256];
+    // Connect the socket to itself on loopback, so any thread can wake the
+    // owner of the ENet host by sending a datagram on it.
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(s, (struct sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR ||
+            getsockname(s, (struct sockaddr*)&addr, &addrLen) == SOCKET_ERROR ||
+            connect(s, (struct sockaddr*)&addr, addrLen) == SOCKET_ERROR) {
+        Limelog("Unable to create control stream wake socket: %d\n", (int)LastSocketError());
+        closeSocket(s);
+        return INVALID_SOCKET;
+    }
 
-        enetPacket = enet_packet_create(NULL,
-                                        sizeof(*encPacket) + AES_GCM_TAG_LENGTH + sizeof(*packet) + paylen,
-                                        flags);
-        if (enetPacket == NULL) {
-            return false;
+    return s;
+#endif
+}
+
+static void wakeEnetOwner(void) {
+    // Only send a wake datagram if the owner hasn't been woken since it last looked
+    if (enetWakeSock != INVALID_SOCKET && PltAtomicExchange32(&controlSendWakePending, 1) == 0) {
+        char wake = 0;
+        send(enetWakeSock, &wake, sizeof(wake), 0);
+    }
+}
+
+// Waits for ENet traffic, a timer, or messages submitted by other threads
+static void waitForEnetOwnerWork(enet_uint32 waitTimeMs) {
+    if (enetWakeSock != INVALID_SOCKET) {
+        struct pollfd pfds[2];
+
+        pfds[0].fd = client->socket;
+        pfds[0].events = POLLIN;
+        pfds[1].fd = enetWakeSock;
+        pfds[1].events = POLLIN;
+        if (pollSockets(pfds, 2, (int)waitTimeMs) > 0 && (pfds[1].revents & POLLIN)) {
+            char buffer[16];
+
+            // Drain the wake datagrams before processControlSendCommands() clears the
+            // wake flag. Clearing it first would let a sender set it again and have its
+            // datagram drained here, leaving the flag set with no datagram to wake us.
+            while (recv(enetWakeSock, buffer, sizeof(buffer), 0) > 0);
         }
+    }
+    else {
+        // Other threads send their messages directly, so there's nothing to wake us for
+        enet_uint32 condition = ENET_SOCKET_WAIT_RECEIVE;
+        enet_socket_wait(client->socket, &condition, waitTimeMs);
+    }
+}
 
-        // We (ab)use the enetMutex to protect currentEnetSequenceNumber and the cipherContext
-        // used inside encryptControlMessage().
+// Without a wake socket, the ENet host is shared by all threads under enetMutex
+static void lockEnetHost(void) {
+    if (enetWakeSock == INVALID_SOCKET) {
         PltLockMutex(&enetMutex);
+    }
+}
 
-        encPacket = (PNVCTL_ENCRYPTED_PACKET_HEADER)enetPacket->data;
-        encPacket->encryptedHeaderType = 0x0001;
-        encPacket->length = sizeof(encPacket->seq) + AES_GCM_TAG_LENGTH + sizeof(*packet) + paylen;
-        encPacket->seq = currentEnetSequenceNumber++;
-
-        // Construct the plaintext data for encryption
-        LC_ASSERT(sizeof(*packet) + paylen < sizeof(tempBuffer));
-        packet = (PNVCTL_ENET_PACKET_HEADER_V2)tempBuffer;
-        packet->type = ptype;
-        packet->payloadLength = paylen;
-        memcpy(&packet[1], payload, paylen);
-
-        // Encrypt the data into the final packet (and byteswap for BE machines)
-        if (!encryptControlMessage(encPacket, packet)) {
-            Limelog("Failed to encrypt control stream message\n");
-            enet_packet_destroy(enetPacket);
-            PltUnlockMutex(&enetMutex);
-            return false;
-        }
+static void unlockEnetHost(void) {
+    if (enetWakeSock == INVALID_SOCKET) {
+        PltUnlockMutex(&enetMutex);
+    }
+}
+
+// Fails sends from other threads once nobody will hand them to ENet
+static void stopEnetOwner(void) {
+    lockEnetHost();
+    PltAtomicStore32(&enetOwnerRunning, 0);
+    unlockEnetHost();
+
+    // Senders waiting for space in the ring must give up now
+    PltLockMutex(&controlSendSpaceMutex);
+    PltUnlockMutex(&controlSendSpaceMutex);
+    PltSignalConditionVariable(&controlSendSpaceCond);
+}
 
-        // enetMutex still locked here
+// Blocks until the owner of the ENet host frees a slot in the ring.
+// Returns false if the owner stopped.
+static bool waitForControlSendSpace(void) {
+    bool running;
+
+    // The owner may be waiting for work, so make sure it drains the ring
+    wakeEnetOwner();
+
+    PltLockMutex(&controlSendSpaceMutex);
+    PltAtomicStore32(&controlSendSpaceWaiters, controlSendSpaceWaiters + 1);
+    while ((running = PltAtomicLoad32(&enetOwnerRunning) != 0) && isControlSendRingFull()) {
+        PltWaitForConditionVariable(&controlSendSpaceCond, &controlSendSpaceMutex);
     }
-    else {
-        PNVCTL_ENET_PACKET_HEADER_V1 packet;
-        enetPacket = enet_packet_create(NULL, sizeof(*packet) + paylen,
-                                        flags);
-        if (enetPacket == NULL) {
-            return false;
-        }
+    PltAtomicStore32(&controlSendSpaceWaiters, controlSendSpaceWaiters - 1);
+    PltUnlockMutex(&controlSendSpaceMutex);
 
-        packet = (PNVCTL_ENET_PACKET_HEADER_V1)enetPacket->data;
-        packet->type = LE16(ptype);
-        memcpy(&packet[1], payload, paylen);
+    // Each signal only wakes one waiter, so pass it on to the next one
+    if (PltAtomicLoad32(&controlSendSpaceWaiters) != 0) {
+        PltSignalConditionVariable(&controlSendSpaceCond);
+    }
 
-        PltLockMutex(&enetMutex);
+    return running;
+}
+
+// Must only be called by the owner of the ENet host
+static void publishPeerSnapshot(void) {
+    bool connected = peer != NULL && peer->state == ENET_PEER_STATE_CONNECTED;
+
+    PltAtomicStore32(&peerSnapshotVersion, peerSnapshotVersion + 1);
+    PltAtomicStore32(&peerSnapshotConnected, connected ? 1 : 0);
+    if (connected) {
+        PltAtomicStore32(&peerSnapshotRtt, peer->roundTripTime);
+        PltAtomicStore32(&peerSnapshotRttVariance, peer->roundTripTimeVariance);
+        PltAtomicStore32(&peerSnapshotReliableDataInTransit, peer->reliableDataInTransit);
     }
+    PltAtomicStore32(&peerSnapshotVersion, peerSnapshotVersion + 1);
+}
+
+// Returns false if the peer isn't connected
+static bool readPeerSnapshot(uint32_t* rtt, uint32_t* rttVariance, uint32_t* reliableDataInTransit) {
+    uint32_t version;
+    bool connected;
+
+    do {
+        version = PltAtomicLoad32(&peerSnapshotVersion);
+        connected = PltAtomicLoad32(&peerSnapshotConnected) != 0;
+        *rtt = PltAtomicLoad32(&peerSnapshotRtt);
+        *rttVariance = PltAtomicLoad32(&peerSnapshotRttVariance);
+        *reliableDataInTransit = PltAtomicLoad32(&peerSnapshotReliableDataInTransit);
+    } while ((version & 1) || version != PltAtomicLoad32(&peerSnapshotVersion));
 
-    volatile bool packetFreed = false;
+    return connected;
+}
+
+static void recordControlSendLatency(uint64_t latencyUs) {
+    int bucket = 0;
 
-    // Set a callback to use to let us know if the packet has been freed.
-    // Freeing can only happen when the packet is acked or send fails.
-    enetPacket->userData = (void*)&packetFreed;
-    enetPacket->freeCallback = enetPacketFreeCb;
+    while (bucket < CONTROL_SEND_LATENCY_BUCKETS - 1 && (1ULL << bucket) <= latencyUs) {
+        bucket++;
+    }
+
+    controlSendLatencyBuckets[bucket]++;
+    if (latencyUs > controlSendLatencyMaxUs) {
+        controlSendLatencyMaxUs = latencyUs;
+    }
+}
+
+static void logControlSendLatency(void) {
+    uint32_t total = 0, count = 0;
+    uint64_t p50Us = 0, p99Us = 0;
+
+    for (int i = 0; i < CONTROL_SEND_LATENCY_BUCKETS; i++) {
+        total += controlSendLatencyBuckets[i];
+    }
+
+    if (total == 0) {
+        return;
+    }
+
+    // Report the upper bound of the buckets containing each percentile
+    for (int i = 0; i < CONTROL_SEND_LATENCY_BUCKETS; i++) {
+        count += controlSendLatencyBuckets[i];
+        if (p50Us == 0 && count * 2 >= total) {
+            p50Us = 1ULL << i;
+        }
+        if (p99Us == 0 && count * 100 >= total * 99ULL) {
+            p99Us = 1ULL << i;
+        }
+    }
+
+    Limelog("Control message send latency: p50 < %u us | p99 < %u us | max %u us (%u messages)\n",
+            (unsigned int)p50Us, (unsigned int)p99Us, (unsigned int)controlSendLatencyMaxUs, total);
+}
+
+// Hands a submitted message to ENet. Must only be called by the owner of the ENet host.
+static bool sendControlSendCommand(PCONTROL_SEND_COMMAND command) {
+    uint8_t channelId = command->channelId;
+
+    if (encryptedControlStream) {
+        PNVCTL_ENCRYPTED_PACKET_HEADER encPacket = (PNVCTL_ENCRYPTED_PACKET_HEADER)command->packet->data;
+        unsigned char* plaintext = ((unsigned char*)(encPacket + 1)) + AES_GCM_TAG_LENGTH;
+
+        // Messages are encrypted here, so sequence numbers follow the order they're sent in
+        if (!encryptControlMessage(encPacket, currentEnetSequenceNumber++, plaintext, command->plaintextLength)) {
+            Limelog("Failed to encrypt control stream message\n");
+            enet_packet_destroy(command->packet);
+            return false;
+        }
+    }
 
     // Always use channel 0 for GFE and if the requested channel exceeds
     // the peer's supported channel count.
@@ -720,56 +1069,134 @@ static bool sendMessageEnet(short ptype, short paylen, const void* payload, uint
         channelId = 0;
     }
 
-    // Queue the packet to be sent
-    err = enet_peer_send(peer, channelId, enetPacket);
-    bool packetQueued = (err == 0);
+    if (enet_peer_send(peer, channelId, command->packet) < 0) {
+        Limelog("Failed to send ENet control packet\n");
+        enet_packet_destroy(command->packet);
+        return false;
+    }
 
-    // If there is no more data coming soon, send the packet now
-    if (!moreData && packetQueued) {
-        err = enet_host_service(client, NULL, 0);
+    recordControlSendLatency(PltGetMicroseconds() - command->submitTimeUs);
+    return true;
+}
 
-        // Wait until the packet is actually sent to provide backpressure on senders
-        if (flags & ENET_PACKET_FLAG_RELIABLE) {
-            // Don't wait longer than 10 milliseconds to avoid blocking callers for too long
-            for (int i = 0; err >= 0 && i < 10; i++) {
-                // Break on disconnected, acked/freed, or sent (pending ack).
-                if (peer->state != ENET_PEER_STATE_CONNECTED || packetFreed || isPacketSentWaitingForAck(enetPacket)) {
-                    break;
-                }
+// Hands all submitted messages to ENet. Must only be called by the owner of the ENet host.
+static void processControlSendCommands(void) {
+    CONTROL_SEND_COMMAND command;
+    bool flush;
 
-                // Release the lock before sleeping to allow another thread to send/receive
-                PltUnlockMutex(&enetMutex);
-                PltSleepMs(1);
-                PltLockMutex(&enetMutex);
+    // Clear the wake flag before looking at the ring, so a sender that submits
+    // after this point will wake us again. A datagram sent by a sender that set
+    // the flag before this point may still arrive, but that only costs us one
+    // extra pass through the loop.
+    if (enetWakeSock != INVALID_SOCKET) {
+        PltAtomicStore32(&controlSendWakePending, 0);
+    }
 
-                // Try to send the packet again
-                err = enet_host_service(client, NULL, 0);
-            }
+    flush = PltAtomicExchange32(&controlSendFlushPending, 0) != 0;
+    while (dequeueControlSendCommand(&command)) {
+        sendControlSendCommand(&command);
+        flush |= command.flush;
 
-            if (err >= 0 && peer->state == ENET_PEER_STATE_CONNECTED && !packetFreed && !isPacketSentWaitingForAck(enetPacket)) {
-                Limelog("Control message took over 10 ms to send (net latency: %u ms | packet loss: %f%%)\n",
-                        peer->roundTripTime, peer->packetLoss / (float)ENET_PEER_PACKET_LOSS_SCALE);
-            }
+        // Let blocked senders fill the slot we just freed
+        wakeControlSendSpaceWaiters();
+    }
+
+    // If there is no more data coming soon, send the queued packets now
+    if (flush) {
+        enet_host_flush(client);
+    }
+}
+
+static bool sendMessageEnet(short ptype, short paylen, const void* payload, uint8_t channelId, uint32_t flags, bool moreData) {
+    ENetPacket* enetPacket;
+    BYTE_BUFFER bb;
+    int plaintextLength;
+
+    LC_ASSERT(AppVersionQuad[0] >= 5);
+
+    // Only send reliable packets to GFE
+    if (!IS_SUNSHINE()) {
+        flags = ENET_PACKET_FLAG_RELIABLE;
+    }
+
+    if (encryptedControlStream) {
+        PNVCTL_ENCRYPTED_PACKET_HEADER encPacket;
+        unsigned char* plaintext;
+
+        enetPacket = createControlPacket(sizeof(*encPacket) + AES_GCM_TAG_LENGTH + sizeof(NVCTL_ENET_PACKET_HEADER_V2) + paylen,
+                                         flags);
+        if (enetPacket == NULL) {
+            return false;
         }
+
+        // Construct the plaintext in wire byte-order where the ciphertext goes (after
+        // the encrypted header and GCM tag). The owner of the ENet host encrypts it
+        // in place when it sends the message.
+        encPacket = (PNVCTL_ENCRYPTED_PACKET_HEADER)enetPacket->data;
+        plaintext = ((unsigned char*)(encPacket + 1)) + AES_GCM_TAG_LENGTH;
+        BbInitializeWrappedBuffer(&bb, (char*)plaintext, 0, sizeof(NVCTL_ENET_PACKET_HEADER_V2) + paylen, BYTE_ORDER_LITTLE);
+        BbPut16LEUnchecked(&bb, ptype);
+        BbPut16LEUnchecked(&bb, paylen);
+        BbPutBytes(&bb, payload, paylen);
+        plaintextLength = bb.position;
     }
+    else {
+        enetPacket = createControlPacket(sizeof(NVCTL_ENET_PACKET_HEADER_V1) + paylen, flags);
+        if (enetPacket == NULL) {
+            return false;
+        }
 
-    // Remove the free callback now that the packet was sent
-    if (!packetFreed) {
-        enetPacket->userData = NULL;
-        enetPacket->freeCallback = NULL;
+        // The packet was allocated with exactly enough space for the message
+        BbInitializeWrappedBuffer(&bb, (char*)enetPacket->data, 0, (int)enetPacket->dataLength, BYTE_ORDER_LITTLE);
+        BbPut16LEUnchecked(&bb, ptype);
+        BbPutBytes(&bb, payload, paylen);
+        plaintextLength = 0;
     }
 
-    PltUnlockMutex(&enetMutex);
+    if (enetWakeSock == INVALID_SOCKET) {
+        CONTROL_SEND_COMMAND command;
+        bool ret = false;
 
-    if (err < 0) {
-        Limelog("Failed to send ENet control packet\n");
-        if (!packetQueued) {
+        command.packet = enetPacket;
+        command.plaintextLength = plaintextLength;
+        command.channelId = channelId;
+        command.flush = !moreData;
+        command.submitTimeUs = PltGetMicroseconds();
+
+        // The owner can't be woken, so send the message ourselves
+        PltLockMutex(&enetMutex);
+        if (PltAtomicLoad32(&enetOwnerRunning) != 0) {
+            ret = sendControlSendCommand(&command);
+            if (ret && !moreData) {
+                enet_host_flush(client);
+            }
+        }
+        else {
             enet_packet_destroy(enetPacket);
         }
-        return false;
+        PltUnlockMutex(&enetMutex);
+
+        return ret;
     }
 
-    return true;
+    // Submit the message to the owner of the ENet host. If the ring is full, the owner
+    // has fallen behind, so wait for it to free a slot to provide backpressure on senders.
+    while (PltAtomicLoad32(&enetOwnerRunning) != 0) {
+        if (enqueueControlSendCommand(enetPacket, plaintextLength, channelId, !moreData)) {
+            // The owner will send queued messages when it next runs
+            if (!moreData) {
+                wakeEnetOwner();
+            }
+            return true;
+        }
+
+        if (!waitForControlSendSpace()) {
+            break;
+        }
+    }
+
+    enet_packet_destroy(enetPacket);
+    return false;
 }
 
 static bool sendMessageTcp(short ptype, short paylen, const void* payload) {
@@ -801,7 +1228,7 @@ static bool sendMessageAndForget(short ptype, short paylen, const void* payload,
     bool ret;
 
     // Unlike regular sockets, ENet sockets aren't safe to invoke from multiple
-    // threads at once. We have to synchronize them with a lock.
+    // threads at once. Messages are handed to the owner of the ENet host to send.
     if (AppVersionQuad[0] >= 5) {
         ret = sendMessageEnet(ptype, paylen, payload, channelId, flags, moreData);
     }
@@ -858,112 +1285,97 @@ static int ignoreDisconnectIntercept(ENetHost* host, ENetEvent* event) {
     return 0;
 }
 
-static void asyncCallbackThreadFunc(void* context) {
-    PQUEUED_ASYNC_CALLBACK queuedCb, nextCb;
-
-    while (LbqWaitForQueueElement(&asyncCallbackQueue, (void**)&queuedCb) == LBQ_SUCCESS) {
-        switch (queuedCb->typeIndex) {
-        case IDX_RUMBLE_DATA:
-            // Look for another rumble packet to batch with
-            while (LbqPeekQueueElement(&asyncCallbackQueue, (void**)&nextCb) == LBQ_SUCCESS) {
-                // Don't batch with the next packet if it is a different type or controller number
-                if (nextCb->typeIndex != queuedCb->typeIndex ||
-                        nextCb->data.rumble.controllerNumber != queuedCb->data.rumble.controllerNumber) {
-                    break;
-                }
+// Invokes the callbacks for all pending slots
+static void deliverAsyncCallbacks(void) {
+    for (int type = 0; type < ASYNC_CB_TYPE_COUNT; type++) {
+        uint32_t pendingMask;
 
-                // This entry is batchable, so pop it off the queue
-                if (LbqPollQueueElement(&asyncCallbackQueue, (void**)&nextCb) != LBQ_SUCCESS) {
-                    break;
-                }
+        // Skip the atomic exchange if nothing is pending for this type
+        if (PltAtomicLoad32(&asyncCallbackPendingMasks[type]) == 0) {
+            continue;
+        }
 
-                // Replace the old entry with the new one
-                free(queuedCb);
-                queuedCb = nextCb;
-            }
+        pendingMask = PltAtomicExchange32(&asyncCallbackPendingMasks[type], 0);
+        for (uint16_t controllerNumber = 0; pendingMask != 0; controllerNumber++, pendingMask >>= 1) {
+            uint32_t value;
 
-            ListenerCallbacks.rumble(queuedCb->data.rumble.controllerNumber,
-                                     queuedCb->data.rumble.lowFreqRumble,
-                                     queuedCb->data.rumble.highFreqRumble);
-            break;
-        case IDX_RUMBLE_TRIGGER_DATA:
-            // Look for another rumble triggers packet to batch with
-            while (LbqPeekQueueElement(&asyncCallbackQueue, (void**)&nextCb) == LBQ_SUCCESS) {
-                // Don't batch with the next packet if it is a different type or controller number
-                if (nextCb->typeIndex != queuedCb->typeIndex ||
-                        nextCb->data.rumbleTriggers.controllerNumber != queuedCb->data.rumbleTriggers.controllerNumber) {
-                    break;
-                }
-
-                // This entry is batchable, so pop it off the queue
-                if (LbqPollQueueElement(&asyncCallbackQueue, (void**)&nextCb) != LBQ_SUCCESS) {
-                    break;
-                }
+            if (!(pendingMask & 1)) {
+                continue;
+            }
 
-                // Replace the old entry with the new one
-                free(queuedCb);
-                queuedCb = nextCb;
+            // If the slot is updated again after we took the pending bit, we'll see
+            // the newer value here and deliver it again on the next wakeup.
+            value = PltAtomicLoad32(&asyncCallbackValues[type][controllerNumber]);
+
+            switch (type) {
+            case ASYNC_CB_RUMBLE:
+                ListenerCallbacks.rumble(controllerNumber, (uint16_t)(value >> 16), (uint16_t)value);
+                break;
+            case ASYNC_CB_RUMBLE_TRIGGERS:
+                ListenerCallbacks.rumbleTriggers(controllerNumber, (uint16_t)(value >> 16), (uint16_t)value);
+                break;
+            case ASYNC_CB_CONTROLLER_LED:
+                ListenerCallbacks.setControllerLED(controllerNumber, (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value);
+                break;
+            case ASYNC_CB_MOTION_ACCEL:
+                ListenerCallbacks.setMotionEventState(controllerNumber, LI_MOTION_TYPE_ACCEL, (uint16_t)value);
+                break;
+            case ASYNC_CB_MOTION_GYRO:
+                ListenerCallbacks.setMotionEventState(controllerNumber, LI_MOTION_TYPE_GYRO, (uint16_t)value);
+                break;
+            default:
+                LC_ASSERT(false);
+                break;
             }
+        }
+    }
 
-            ListenerCallbacks.rumbleTriggers(queuedCb->data.rumbleTriggers.controllerNumber,
-                                             queuedCb->data.rumbleTriggers.leftTriggerMotor,
-                                             queuedCb->data.rumbleTriggers.rightTriggerMotor);
-            break;
-        case IDX_SET_RGB_LED:
-            // Look for another controller LED packet to batch with
-            while (LbqPeekQueueElement(&asyncCallbackQueue, (void**)&nextCb) == LBQ_SUCCESS) {
-                // Don't batch with the next packet if it is a different type or controller number
-                if (nextCb->typeIndex != queuedCb->typeIndex ||
-                        nextCb->data.setControllerLed.controllerNumber != queuedCb->data.setControllerLed.controllerNumber) {
-                    break;
-                }
+    // HDR state is maintained globally, so we just invoke the client callback here
+    if (PltAtomicExchange32(&asyncHdrCallbackPending, 0)) {
+        ListenerCallbacks.setHdrMode(hdrEnabled);
+    }
+}
 
-                // This entry is batchable, so pop it off the queue
-                if (LbqPollQueueElement(&asyncCallbackQueue, (void**)&nextCb) != LBQ_SUCCESS) {
-                    break;
-                }
+static void asyncCallbackThreadFunc(void* context) {
+    for (;;) {
+        bool interrupted;
 
-                // Replace the old entry with the new one
-                free(queuedCb);
-                queuedCb = nextCb;
-            }
+        PltWaitForEvent(&asyncCallbackEvent);
+        PltClearEvent(&asyncCallbackEvent);
 
-            ListenerCallbacks.setControllerLED(queuedCb->data.setControllerLed.controllerNumber,
-                                               queuedCb->data.setControllerLed.r,
-                                               queuedCb->data.setControllerLed.g,
-                                               queuedCb->data.setControllerLed.b);
-            break;
-        case IDX_HDR_INFO:
-            // HDR state is maintained globally, so we just invoke the client callback here.
-            // These events are stateless, so we can consume all of them now.
-            while (LbqPeekQueueElement(&asyncCallbackQueue, (void**)&nextCb) == LBQ_SUCCESS && nextCb->typeIndex == queuedCb->typeIndex) {
-                // This entry is batchable, so pop it off the queue
-                if (LbqPollQueueElement(&asyncCallbackQueue, (void**)&nextCb) != LBQ_SUCCESS) {
-                    break;
-                }
+        // Sample this before delivering, so we drain any callbacks that
+        // were pending when the control stream was stopped.
+        interrupted = PltIsThreadInterrupted(&asyncCallbackThread);
 
-                // Replace the old entry with the new one
-                free(queuedCb);
-                queuedCb = nextCb;
-            }
+        // Producers that observe this cleared will signal the event again
+        PltAtomicStore32(&asyncCallbackWakePending, 0);
 
-            ListenerCallbacks.setHdrMode(hdrEnabled);
-            break;
+        deliverAsyncCallbacks();
 
-        case IDX_SET_MOTION_EVENT:
-            // These events are infrequent and cannot be batched
-            ListenerCallbacks.setMotionEventState(queuedCb->data.setMotionEventState.controllerNumber,
-                                                  queuedCb->data.setMotionEventState.motionType,
-                                                  queuedCb->data.setMotionEventState.reportRateHz);
-            break;
-        default:
-            // Unhandled packet type from queueAsyncCallback()
-            LC_ASSERT(false);
+        if (interrupted) {
             break;
         }
+    }
+}
+
+static void wakeAsyncCallbackThread(void) {
+    // Only signal the event for the first update after each wakeup
+    if (PltAtomicExchange32(&asyncCallbackWakePending, 1) == 0) {
+        PltSetEvent(&asyncCallbackEvent);
+    }
+}
 
-        free(queuedCb);
+// Stores the latest value for a controller's callback and wakes the callback thread
+static void postAsyncCallback(int type, uint16_t controllerNumber, uint32_t value) {
+    if (controllerNumber >= MAX_ASYNC_CB_CONTROLLERS) {
+        return;
     }
+
+    // The value must be visible before the pending bit is set
+    PltAtomicStore32(&asyncCallbackValues[type][controllerNumber], value);
+    PltAtomicOr32(&asyncCallbackPendingMasks[type], 1U << controllerNumber);
+
+    wakeAsyncCallbackThread();
 }
 
 static bool needsAsyncCallback(unsigned short packetType) {
@@ -976,82 +1388,102 @@ static bool needsAsyncCallback(unsigned short packetType) {
 
 static void queueAsyncCallback(PNVCTL_ENET_PACKET_HEADER_V1 ctlHdr, int packetLength) {
     BYTE_BUFFER bb;
-    PQUEUED_ASYNC_CALLBACK queuedCb;
-    int err;
+    uint16_t controllerNumber;
 
     LC_ASSERT(needsAsyncCallback(ctlHdr->type));
 
-    queuedCb = malloc(sizeof(*queuedCb));
-    if (!queuedCb) {
-        return;
-    }
-
     BbInitializeWrappedBuffer(&bb, (char*)ctlHdr, sizeof(*ctlHdr), packetLength - sizeof(*ctlHdr), BYTE_ORDER_LITTLE);
 
+    // Each message is validated for length once, then parsed without per-field checks
     if (ctlHdr->type == packetTypes[IDX_RUMBLE_DATA]) {
+        uint16_t lowFreqRumble, highFreqRumble;
+
+        if (!BbReserve(&bb, 4 + 3 * sizeof(uint16_t))) {
+            return;
+        }
+
         BbAdvanceBuffer(&bb, 4);
 
-        BbGet16(&bb, &queuedCb->data.rumble.controllerNumber);
-        BbGet16(&bb, &queuedCb->data.rumble.lowFreqRumble);
-        BbGet16(&bb, &queuedCb->data.rumble.highFreqRumble);
+        BbGet16LEUnchecked(&bb, &controllerNumber);
+        BbGet16LEUnchecked(&bb, &lowFreqRumble);
+        BbGet16LEUnchecked(&bb, &highFreqRumble);
 
-        queuedCb->typeIndex = IDX_RUMBLE_DATA;
+        postAsyncCallback(ASYNC_CB_RUMBLE, controllerNumber, ((uint32_t)lowFreqRumble << 16) | highFreqRumble);
     }
     else if (ctlHdr->type == packetTypes[IDX_RUMBLE_TRIGGER_DATA]) {
-        BbGet16(&bb, &queuedCb->data.rumbleTriggers.controllerNumber);
-        BbGet16(&bb, &queuedCb->data.rumbleTriggers.leftTriggerMotor);
-        BbGet16(&bb, &queuedCb->data.rumbleTriggers.rightTriggerMotor);
+        uint16_t leftTriggerMotor, rightTriggerMotor;
 
-        queuedCb->typeIndex = IDX_RUMBLE_TRIGGER_DATA;
+        if (!BbReserve(&bb, 3 * sizeof(uint16_t))) {
+            return;
+        }
+
+        BbGet16LEUnchecked(&bb, &controllerNumber);
+        BbGet16LEUnchecked(&bb, &leftTriggerMotor);
+        BbGet16LEUnchecked(&bb, &rightTriggerMotor);
+
+        postAsyncCallback(ASYNC_CB_RUMBLE_TRIGGERS, controllerNumber, ((uint32_t)leftTriggerMotor << 16) | rightTriggerMotor);
     }
     else if (ctlHdr->type == packetTypes[IDX_SET_MOTION_EVENT]) {
-        BbGet16(&bb, &queuedCb->data.setMotionEventState.controllerNumber);
-        BbGet16(&bb, &queuedCb->data.setMotionEventState.reportRateHz);
-        BbGet8(&bb, &queuedCb->data.setMotionEventState.motionType);
+        uint16_t reportRateHz;
+        uint8_t motionType;
+
+        if (!BbReserve(&bb, 2 * sizeof(uint16_t) + sizeof(uint8_t))) {
+            return;
+        }
 
-        queuedCb->typeIndex = IDX_SET_MOTION_EVENT;
+        BbGet16LEUnchecked(&bb, &controllerNumber);
+        BbGet16LEUnchecked(&bb, &reportRateHz);
+        BbGet8Unchecked(&bb, &motionType);
+
+        // Each motion sensor has its own slot, since their states are independent
+        if (motionType == LI_MOTION_TYPE_ACCEL) {
+            postAsyncCallback(ASYNC_CB_MOTION_ACCEL, controllerNumber, reportRateHz);
+        }
+        else if (motionType == LI_MOTION_TYPE_GYRO) {
+            postAsyncCallback(ASYNC_CB_MOTION_GYRO, controllerNumber, reportRateHz);
+        }
     }
     else if (ctlHdr->type == packetTypes[IDX_SET_RGB_LED]) {
-        BbGet16(&bb, &queuedCb->data.setControllerLed.controllerNumber);
-        BbGet8(&bb, &queuedCb->data.setControllerLed.r);
-        BbGet8(&bb, &queuedCb->data.setControllerLed.g);
-        BbGet8(&bb, &queuedCb->data.setControllerLed.b);
+        uint8_t r, g, b;
+
+        if (!BbReserve(&bb, sizeof(uint16_t) + 3 * sizeof(uint8_t))) {
+            return;
+        }
+
+        BbGet16LEUnchecked(&bb, &controllerNumber);
+        BbGet8Unchecked(&bb, &r);
+        BbGet8Unchecked(&bb, &g);
+        BbGet8Unchecked(&bb, &b);
 
-        queuedCb->typeIndex = IDX_SET_RGB_LED;
+        postAsyncCallback(ASYNC_CB_CONTROLLER_LED, controllerNumber, ((uint32_t)r << 16) | ((uint32_t)g << 8) | b);
     }
     else if (ctlHdr->type == packetTypes[IDX_HDR_INFO]) {
-        queuedCb->typeIndex = IDX_HDR_INFO;
+        PltAtomicStore32(&asyncHdrCallbackPending, 1);
+        wakeAsyncCallbackThread();
     }
     else {
         // Unhandled packet type from needsAsyncCallback()
         LC_ASSERT(false);
-        free(queuedCb);
-        return;
-    }
-
-    err = LbqOfferQueueItem(&asyncCallbackQueue, queuedCb, &queuedCb->entry);
-    if (err != LBQ_SUCCESS) {
-        Limelog("Failed to queue async callback: %d\n", err);
-        free(queuedCb);
     }
 }
 
-static void controlReceiveThreadFunc(void* context) {
+// Services the ENet host until the connection ends. This thread is its exclusive
+// owner unless there is no wake socket, in which case it shares it under enetMutex.
+static void serviceControlStreamEnet(void) {
     int err;
 
-    // This is only used for ENet
-    if (AppVersionQuad[0] < 5) {
-        return;
-    }
-
     while (!PltIsThreadInterrupted(&controlReceiveThread)) {
         ENetEvent event;
         enet_uint32 waitTimeMs;
 
-        PltLockMutex(&enetMutex);
+        lockEnetHost();
+
+        // Hand messages submitted by other threads to ENet
+        processControlSendCommands();
 
         // Poll for new packets and process retransmissions
         err = serviceEnetHost(client, &event, 0);
+        publishPeerSnapshot();
 
         // Compute the next time we need to wake up to handle
         // the RTO timer or a ping.
@@ -1070,13 +1502,13 @@ static void controlReceiveThreadFunc(void* context) {
             }
         }
 
-        PltUnlockMutex(&enetMutex);
+        unlockEnetHost();
 
         if (err == 0) {
             // Handle a pending disconnect after unsuccessfully polling
             // for new events to handle.
             if (disconnectPending) {
-                PltLockMutex(&enetMutex);
+                lockEnetHost();
                 // Wait 100 ms for pending receives after a disconnect and
                 // 1 second for the pending disconnect to be processed after
                 // removing the intercept callback.
@@ -1089,27 +1521,27 @@ static void controlReceiveThreadFunc(void* context) {
                         // 1 second for this disconnect to be processed before
                         // we tear down the connection anyway.
                         client->intercept = NULL;
-                        PltUnlockMutex(&enetMutex);
+                        unlockEnetHost();
                         continue;
                     }
                     else {
                         // The 1 second timeout has expired with no disconnect event
                         // retransmission after the first notification. We can only
                         // assume the server died tragically, so go ahead and tear down.
-                        PltUnlockMutex(&enetMutex);
+                        unlockEnetHost();
                         Limelog("Disconnect event timeout expired\n");
                         ListenerCallbacks.connectionTerminated(-1);
                         return;
                     }
                 }
                 else {
-                    PltUnlockMutex(&enetMutex);
+                    unlockEnetHost();
                 }
             }
             else {
-                // No events ready - wait for readability or a local RTO timer to expire
-                enet_uint32 condition = ENET_SOCKET_WAIT_RECEIVE;
-                enet_socket_wait(client->socket, &condition, waitTimeMs);
+                // No events ready - wait for readability, a local RTO timer to expire,
+                // or another thread to submit a message.
+                waitForEnetOwnerWork(waitTimeMs);
                 continue;
             }
         }
@@ -1288,9 +1720,9 @@ static void controlReceiveThreadFunc(void* context) {
                 // message once it sends this message, so we mark the peer as fully
                 // disconnected now to avoid delays waiting for an ack that will
                 // never arrive.
-                PltLockMutex(&enetMutex);
+                lockEnetHost();
                 enet_peer_disconnect_now(peer, 0);
-                PltUnlockMutex(&enetMutex);
+                unlockEnetHost();
                 ListenerCallbacks.connectionTerminated((int)terminationErrorCode);
                 free(ctlHdr);
                 return;
@@ -1306,6 +1738,16 @@ static void controlReceiveThreadFunc(void* context) {
     }
 }
 
+static void controlReceiveThreadFunc(void* context) {
+    // This is only used for ENet
+    if (AppVersionQuad[0] < 5) {
+        return;
+    }
+
+    serviceControlStreamEnet();
+    stopEnetOwner();
+}
+
 static void lossStatsThreadFunc(void* context) {
     BYTE_BUFFER byteBuffer;
 
@@ -1313,8 +1755,9 @@ static void lossStatsThreadFunc(void* context) {
         char periodicPingPayload[8];
 
         BbInitializeWrappedBuffer(&byteBuffer, periodicPingPayload, 0, sizeof(periodicPingPayload), BYTE_ORDER_LITTLE);
-        BbPut16(&byteBuffer, 4); // Length of payload
-        BbPut32(&byteBuffer, 0); // Timestamp?
+        LC_ASSERT(BbReserve(&byteBuffer, sizeof(uint16_t) + sizeof(uint32_t)));
+        BbPut16LEUnchecked(&byteBuffer, 4); // Length of payload
+        BbPut32LEUnchecked(&byteBuffer, 0); // Timestamp?
 
         while (!PltIsThreadInterrupted(&lossStatsThread)) {
             // For Sunshine servers, send the more detailed per-frame FEC messages
@@ -1369,6 +1812,8 @@ static void lossStatsThreadFunc(void* context) {
         // Sunshine should use the newer codepath above
         LC_ASSERT(!IS_SUNSHINE());
 
+        // The payload is sized for the fields we write below
+        LC_ASSERT(payloadLengths[IDX_LOSS_STATS] >= LOSS_STATS_PAYLOAD_LENGTH);
         lossStatsPayload = malloc(payloadLengths[IDX_LOSS_STATS]);
         if (lossStatsPayload == NULL) {
             Limelog("Loss Stats: malloc() failed\n");
@@ -1379,13 +1824,13 @@ static void lossStatsThreadFunc(void* context) {
         while (!PltIsThreadInterrupted(&lossStatsThread)) {
             // Construct the payload
             BbInitializeWrappedBuffer(&byteBuffer, lossStatsPayload, 0, payloadLengths[IDX_LOSS_STATS], BYTE_ORDER_LITTLE);
-            BbPut32(&byteBuffer, 0);
-            BbPut32(&byteBuffer, LOSS_REPORT_INTERVAL_MS);
-            BbPut32(&byteBuffer, 1000);
-            BbPut64(&byteBuffer, lastGoodFrame);
-            BbPut32(&byteBuffer, 0);
-            BbPut32(&byteBuffer, 0);
-            BbPut32(&byteBuffer, 0x14);
+            BbPut32LEUnchecked(&byteBuffer, 0);
+            BbPut32LEUnchecked(&byteBuffer, LOSS_REPORT_INTERVAL_MS);
+            BbPut32LEUnchecked(&byteBuffer, 1000);
+            BbPut64LEUnchecked(&byteBuffer, lastGoodFrame);
+            BbPut32LEUnchecked(&byteBuffer, 0);
+            BbPut32LEUnchecked(&byteBuffer, 0);
+            BbPut32LEUnchecked(&byteBuffer, 0x14);
 
             // Send the message (and don't expect a response)
             if (!sendMessageAndForget(packetTypes[IDX_LOSS_STATS],
@@ -1532,7 +1977,6 @@ int stopControlStream(void) {
     stopping = true;
     LbqSignalQueueShutdown(&invalidReferenceFrameTuples);
     LbqSignalQueueShutdown(&frameFecStatusQueue);
-    LbqSignalQueueDrain(&asyncCallbackQueue);
     PltSetEvent(&idrFrameRequiredEvent);
 
     // This must be set to stop in a timely manner
@@ -1546,6 +1990,7 @@ int stopControlStream(void) {
     PltInterruptThread(&requestIdrFrameThread);
     PltInterruptThread(&controlReceiveThread);
     PltInterruptThread(&asyncCallbackThread);
+    PltSetEvent(&asyncCallbackEvent);
 
     PltJoinThread(&lossStatsThread);
     PltJoinThread(&requestIdrFrameThread);
@@ -1558,17 +2003,26 @@ int stopControlStream(void) {
         PltJoinThread(&invalidateRefFramesThread);
     }
 
+    // This thread owns the ENet host now that the control receive thread has stopped
+    stopEnetOwner();
+
     if (peer != NULL) {
+        // Hand over any messages that were submitted after the control receive thread stopped
+        processControlSendCommands();
+
         // Gracefully disconnect to ensure the remote host receives all of our final
         // outbound traffic, including any key up events that might be sent.
         gracefullyDisconnectEnetPeer(client, peer, CONTROL_STREAM_LINGER_TIMEOUT_SEC * 1000);
         peer = NULL;
+        publishPeerSnapshot();
     }
     if (client != NULL) {
         enet_host_destroy(client);
         client = NULL;
     }
 
+    logControlSendLatency();
+
     if (ctlSock != INVALID_SOCKET) {
         closeSocket(ctlSock);
         ctlSock = INVALID_SOCKET;
@@ -1592,44 +2046,48 @@ int sendInputPacketOnControlStream(unsigned char* data, int length, uint8_t chan
 // Called by the input stream to flush queued packets before a batching wait
 void flushInputOnControlStream(void) {
     if (AppVersionQuad[0] >= 5) {
-        PltLockMutex(&enetMutex);
-        enet_host_flush(client);
-        PltUnlockMutex(&enetMutex);
+        if (enetWakeSock == INVALID_SOCKET) {
+            PltLockMutex(&enetMutex);
+            if (PltAtomicLoad32(&enetOwnerRunning) != 0) {
+                enet_host_flush(client);
+            }
+            PltUnlockMutex(&enetMutex);
+        }
+        else {
+            PltAtomicStore32(&controlSendFlushPending, 1);
+            wakeEnetOwner();
+        }
     }
 }
 
 bool isControlDataInTransit(void) {
-    bool ret = false;
+    uint32_t rtt, rttVariance, reliableDataInTransit;
 
-    PltLockMutex(&enetMutex);
-    if (peer != NULL && peer->state == ENET_PEER_STATE_CONNECTED) {
-        if (peer->reliableDataInTransit != 0) {
-            ret = true;
-        }
+    if (!readPeerSnapshot(&rtt, &rttVariance, &reliableDataInTransit)) {
+        return false;
     }
-    PltUnlockMutex(&enetMutex);
 
-    return ret;
+    // Messages still waiting to be handed to ENet are in transit too
+    return reliableDataInTransit != 0 ||
+        PltAtomicLoad32(&controlSendEnqueuePos) != PltAtomicLoad32(&controlSendDequeuePos);
 }
 
 bool LiGetEstimatedRttInfo(uint32_t* estimatedRtt, uint32_t* estimatedRttVariance) {
-    bool ret = false;
+    uint32_t rtt, rttVariance, reliableDataInTransit;
 
-    PltLockMutex(&enetMutex);
-    if (peer != NULL && peer->state == ENET_PEER_STATE_CONNECTED) {
-        if (estimatedRtt != NULL) {
-            *estimatedRtt = peer->roundTripTime;
-        }
+    if (!readPeerSnapshot(&rtt, &rttVariance, &reliableDataInTransit)) {
+        return false;
+    }
 
-        if (estimatedRttVariance != NULL) {
-            *estimatedRttVariance = peer->roundTripTimeVariance;
-        }
+    if (estimatedRtt != NULL) {
+        *estimatedRtt = rtt;
+    }
 
-        ret = true;
+    if (estimatedRttVariance != NULL) {
+        *estimatedRttVariance = rttVariance;
     }
-    PltUnlockMutex(&enetMutex);
 
-    return ret;
+    return true;
 }
 
 // Starts the control stream
@@ -1722,6 +2180,13 @@ int startControlStream(void) {
         // Set the peer timeout to 10 seconds and limit backoff to 2x RTT
         enet_peer_timeout(peer, 2, 10000, 10000);
 #endif
+
+        publishPeerSnapshot();
+
+        // Other threads submit messages to the control receive thread once it owns
+        // the ENet host. If we can't wake it, they use the ENet host under enetMutex.
+        enetWakeSock = createWakeSocket();
+        PltAtomicStore32(&enetOwnerRunning, 1);
     }
     else {
         // NB: Do NOT use ControlPortNumber here. 47995 is correct for these old versions.
@@ -1736,9 +2201,10 @@ int startControlStream(void) {
         enableNoDelay(ctlSock);
     }
 
-    err = PltCreateThread("ControlRecv", controlReceiveThreadFunc, NULL, &controlReceiveThread);
+    err = PltCreateThread("ControlRecv", THREAD_ROLE_CONTROL, controlReceiveThreadFunc, NULL, &controlReceiveThread);
     if (err != 0) {
         stopping = true;
+        PltAtomicStore32(&enetOwnerRunning, 0);
         if (ctlSock != INVALID_SOCKET) {
             closeSocket(ctlSock);
             ctlSock = INVALID_SOCKET;
@@ -1820,7 +2286,7 @@ int startControlStream(void) {
         return err;
     }
 
-    err = PltCreateThread("LossStats", lossStatsThreadFunc, NULL, &lossStatsThread);
+    err = PltCreateThread("LossStats", THREAD_ROLE_CONTROL, lossStatsThreadFunc, NULL, &lossStatsThread);
     if (err != 0) {
         stopping = true;
 
@@ -1847,7 +2313,7 @@ int startControlStream(void) {
         return err;
     }
 
-    err = PltCreateThread("ReqIdrFrame", requestIdrFrameFunc, NULL, &requestIdrFrameThread);
+    err = PltCreateThread("ReqIdrFrame", THREAD_ROLE_CONTROL, requestIdrFrameFunc, NULL, &requestIdrFrameThread);
     if (err != 0) {
         stopping = true;
 
@@ -1878,7 +2344,7 @@ int startControlStream(void) {
         return err;
     }
 
-    err = PltCreateThread("CtrlAsyncCb", asyncCallbackThreadFunc, NULL, &asyncCallbackThread);
+    err = PltCreateThread("CtrlAsyncCb", THREAD_ROLE_CONTROL, asyncCallbackThreadFunc, NULL, &asyncCallbackThread);
     if (err != 0) {
         stopping = true;
         PltSetEvent(&idrFrameRequiredEvent);
@@ -1915,11 +2381,10 @@ int startControlStream(void) {
 
     // Only create the reference frame invalidation thread if RFI is enabled
     if (isReferenceFrameInvalidationEnabled()) {
-        err = PltCreateThread("InvRefFrames", invalidateRefFramesFunc, NULL, &invalidateRefFramesThread);
+        err = PltCreateThread("InvRefFrames", THREAD_ROLE_CONTROL, invalidateRefFramesFunc, NULL, &invalidateRefFramesThread);
         if (err != 0) {
             stopping = true;
             PltSetEvent(&idrFrameRequiredEvent);
-            LbqSignalQueueShutdown(&asyncCallbackQueue);
 
             if (ctlSock != INVALID_SOCKET) {
                 shutdownTcpSocket(ctlSock);
@@ -1938,6 +2403,7 @@ int startControlStream(void) {
             PltJoinThread(&requestIdrFrameThread);
 
             PltInterruptThread(&asyncCallbackThread);
+            PltSetEvent(&asyncCallbackEvent);
             PltJoinThread(&asyncCallbackThread);
 
             if (ctlSock != INVALID_SOCKET) {
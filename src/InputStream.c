@@ -12,6 +12,10 @@ static LINKED_BLOCKING_QUEUE packetQueue;
 static LINKED_BLOCKING_QUEUE packetHolderFreeList;
 static PLT_THREAD inputSendThread;
 
+// Packets dequeued from packetQueue as a batch that haven't
+// been processed by the input send thread yet
+static PLINKED_BLOCKING_QUEUE_ENTRY pendingPacketHolders;
+
 static float absCurrentPosX;
 static float absCurrentPosY;
 
@@ -45,6 +49,10 @@ static struct {
 
 #define MAX_QUEUED_INPUT_PACKETS 150
 
+// The maximum number of packets the input send thread dequeues at once. This bounds
+// how far past MAX_QUEUED_INPUT_PACKETS the queue and the pending batch can grow.
+#define INPUT_PACKET_BATCH_SIZE 16
+
 #define PAYLOAD_SIZE(x) BE32((x)->packet.header.size)
 #define PACKET_SIZE(x) (PAYLOAD_SIZE(x) + sizeof(uint32_t))
 
@@ -100,6 +108,7 @@ int initializeInputStream(void) {
     // while the input send thread is blocked for short periods.
     LbqInitializeLinkedBlockingQueue(&packetQueue, MAX_QUEUED_INPUT_PACKETS);
     LbqInitializeLinkedBlockingQueue(&packetHolderFreeList, MAX_QUEUED_INPUT_PACKETS);
+    pendingPacketHolders = NULL;
 
     cryptoContext = PltCreateCryptoContext();
     encryptedControlStream = APP_VERSION_AT_LEAST(7, 1, 431);
@@ -143,6 +152,19 @@ void destroyInputStream(void) {
         entry = nextEntry;
     }
 
+    // Free any packets left over in the input send thread's batch
+    entry = pendingPacketHolders;
+    pendingPacketHolders = NULL;
+
+    while (entry != NULL) {
+        nextEntry = entry->flink;
+
+        // The entry is stored in the data buffer
+        free(entry->data);
+
+        entry = nextEntry;
+    }
+
     entry = LbqDestroyLinkedBlockingQueue(&packetHolderFreeList);
 
     while (entry != NULL) {
@@ -232,6 +254,37 @@ static PPACKET_HOLDER allocatePacketHolder(int extraLength) {
     }
 }
 
+// Takes the next packet for the input send thread, waiting for new packets if the
+// current batch is empty. Up to INPUT_PACKET_BATCH_SIZE packets are dequeued in a single
+// lock acquisition.
+static int waitForNextPacketHolder(PPACKET_HOLDER* holder) {
+    if (pendingPacketHolders == NULL) {
+        int err = LbqWaitForQueueElements(&packetQueue, INPUT_PACKET_BATCH_SIZE, &pendingPacketHolders);
+        if (err != LBQ_SUCCESS) {
+            return err;
+        }
+    }
+
+    *holder = (PPACKET_HOLDER)pendingPacketHolders->data;
+    pendingPacketHolders = pendingPacketHolders->flink;
+    return LBQ_SUCCESS;
+}
+
+// Returns the next packet for the input send thread without removing it, or NULL if
+// no packets are pending. Use popNextPacketHolder() to remove the returned packet.
+static PPACKET_HOLDER peekNextPacketHolder(void) {
+    if (pendingPacketHolders == NULL && LbqDrainQueueItems(&packetQueue, INPUT_PACKET_BATCH_SIZE, &pendingPacketHolders) != LBQ_SUCCESS) {
+        return NULL;
+    }
+
+    return (PPACKET_HOLDER)pendingPacketHolders->data;
+}
+
+static void popNextPacketHolder(void) {
+    LC_ASSERT(pendingPacketHolders != NULL);
+    pendingPacketHolders = pendingPacketHolders->flink;
+}
+
 static bool sendInputPacket(PPACKET_HOLDER holder, bool moreData) {
     SOCK_RET err;
 
@@ -340,7 +393,7 @@ static void inputSendThreadProc(void* context) {
     uint64_t lastPenPacketTime = 0;
 
     while (!PltIsThreadInterrupted(&inputSendThread)) {
-        err = LbqWaitForQueueElement(&packetQueue, (void**)&holder);
+        err = waitForNextPacketHolder(&holder);
         if (err != LBQ_SUCCESS) {
             return;
         }
@@ -366,7 +419,8 @@ static void inputSendThreadProc(void* context) {
                 PNV_MULTI_CONTROLLER_PACKET newPkt;
 
                 // Peek at the next packet
-                if (LbqPeekQueueElement(&packetQueue, (void**)&controllerBatchHolder) != LBQ_SUCCESS) {
+                controllerBatchHolder = peekNextPacketHolder();
+                if (controllerBatchHolder == NULL) {
                     break;
                 }
 
@@ -390,9 +444,7 @@ static void inputSendThreadProc(void* context) {
                 }
 
                 // Remove the batchable controller packet
-                if (LbqPollQueueElement(&packetQueue, (void**)&controllerBatchHolder) != LBQ_SUCCESS) {
-                    break;
-                }
+                popNextPacketHolder();
 
                 // Update the original packet
                 origPkt->leftTrigger = newPkt->leftTrigger;
@@ -526,7 +578,8 @@ static void inputSendThreadProc(void* context) {
                 PPACKET_HOLDER penBatchHolder;
 
                 // Peek at the next packet
-                if (LbqPeekQueueElement(&packetQueue, (void**)&penBatchHolder) != LBQ_SUCCESS) {
+                penBatchHolder = peekNextPacketHolder();
+                if (penBatchHolder == NULL) {
                     break;
                 }
 
@@ -542,9 +595,7 @@ static void inputSendThreadProc(void* context) {
                 }
 
                 // Remove the next packet
-                if (LbqPollQueueElement(&packetQueue, (void**)&penBatchHolder) != LBQ_SUCCESS) {
-                    break;
-                }
+                popNextPacketHolder();
 
                 // Replace the current packet with the new one
                 freePacketHolder(holder);
@@ -652,7 +703,7 @@ static void inputSendThreadProc(void* context) {
         }
 
         // Encrypt and send the input packet
-        if (!sendInputPacket(holder, LbqGetItemCount(&packetQueue) > 0)) {
+        if (!sendInputPacket(holder, pendingPacketHolders != NULL || LbqGetItemCount(&packetQueue) > 0)) {
             freePacketHolder(holder);
             return;
         }
@@ -708,7 +759,7 @@ int startInputStream(void) {
         enableNoDelay(inputSock);
     }
 
-    err = PltCreateThread("InputSend", inputSendThreadProc, NULL, &inputSendThread);
+    err = PltCreateThread("InputSend", THREAD_ROLE_INPUT_SEND, inputSendThreadProc, NULL, &inputSendThread);
     if (err != 0) {
         if (inputSock != INVALID_SOCKET) {
             closeSocket(inputSock);
@@ -128,24 +128,31 @@ bool isControlDataInTransit(void);
 
 int performRtspHandshake(PSERVER_INFORMATION serverInfo);
 
-void initializeVideoDepacketizer(int pktSize);
+int initializeVideoDepacketizer(int pktSize);
 void destroyVideoDepacketizer(void);
 void queueRtpPacket(PRTPV_QUEUE_ENTRY queueEntry);
 void stopVideoDepacketizer(void);
 void requestDecoderRefresh(void);
 void notifyFrameLost(unsigned int frameNumber, bool speculative);
 
-void initializeVideoStream(void);
+int initializeVideoStream(void);
 void destroyVideoStream(void);
 void notifyKeyFrameReceived(void);
 int startVideoStream(void* rendererContext, int drFlags);
 void stopVideoStream(void);
+void getVideoReorderStats(PRTP_REORDER_STATS stats);
 
 int initializeAudioStream(void);
 int notifyAudioPortNegotiationComplete(void);
 void destroyAudioStream(void);
 int startAudioStream(void* audioContext, int arFlags);
 void stopAudioStream(void);
+void getAudioReorderStats(PRTP_REORDER_STATS stats);
+
+void initializeMediaClock(void);
+void mediaClockAddAudioPacket(uint32_t presentationTimeMs, uint64_t receiveTimeMs);
+void mediaClockAddVideoFrame(uint32_t presentationTimeMs, uint64_t receiveTimeMs);
+void mediaClockAudioDelivered(uint32_t presentationTimeMs);
 
 int initializeInputStream(void);
 void destroyInputStream(void);
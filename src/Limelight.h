@@ -100,6 +100,26 @@ typedef struct _STREAM_CONFIGURATION {
     // in /launch and /resume requests.
     char remoteInputAesKey[16];
     char remoteInputAesIv[16];
+
+    // If non-zero, these cap the latency of the video decode unit queue when
+    // CAPABILITY_DIRECT_SUBMIT is not set for the video renderer. The cap is
+    // exceeded once the queue holds maxQueuedVideoFrames frames or the oldest
+    // queued frame has waited longer than maxQueuedVideoLatencyMs. When a new
+    // frame arrives while the cap is exceeded:
+    // - If the new frame is an IDR frame, every queued frame is dropped.
+    // - Otherwise, if an IDR frame is queued behind the oldest frame, the
+    //   frames before the newest queued IDR frame are dropped.
+    // - Otherwise, every queued frame and the new frame are dropped. Reference
+    //   frame invalidation is requested for the dropped frames when possible,
+    //   otherwise an IDR frame is requested.
+    int maxQueuedVideoFrames;
+    int maxQueuedVideoLatencyMs;
+
+    // Specifies the number of video FEC blocks (each frame has between 1 and 4)
+    // that may be reassembled at once. A larger window tolerates more packet
+    // reordering across frame boundaries, at the cost of slower detection of
+    // lost frames. If 0, a default of 2 is used. The maximum is 8.
+    int videoReassemblyWindow;
 } STREAM_CONFIGURATION, *PSTREAM_CONFIGURATION;
 
 // Use this function to zero the stream configuration when allocated on the stack or heap
@@ -173,7 +193,7 @@ typedef struct _DECODE_UNIT {
     // Length of the entire buffer chain in bytes
     int fullLength;
 
-    // Head of the buffer chain (never NULL)
+    // Head of the buffer chain (never NULL, except with PARTIAL_DU_FLAG_ABORT_FRAME)
     PLENTRY bufferList;
 
     // Determines if this frame is SDR or HDR
@@ -272,6 +292,14 @@ typedef struct _DECODE_UNIT {
 // supports reference frame invalidation for AV1 streams. This flag is only valid on video renderers.
 #define CAPABILITY_REFERENCE_FRAME_INVALIDATION_AV1 0x40
 
+// If set in the video renderer capabilities field, this flag opts the renderer into receiving
+// each frame in pieces through the submitPartialDecodeUnit() callback as soon as complete NALUs
+// are available, rather than waiting for the entire frame to arrive. Combined with
+// CAPABILITY_SLICES_PER_FRAME(), this allows decoding of each slice to begin while the rest of
+// the frame is still being received. This is only supported for H.264 and HEVC streams (other
+// codecs are delivered as a single piece) and requires CAPABILITY_DIRECT_SUBMIT.
+#define CAPABILITY_PARTIAL_FRAME_SUBMIT 0x80
+
 // If set in the video renderer capabilities field, this macro specifies that the renderer
 // supports slicing to increase decoding performance. The parameter specifies the desired
 // number of slices per frame. This capability is only valid on video renderers.
@@ -298,6 +326,25 @@ typedef void(*DecoderRendererCleanup)(void);
 #define DR_NEED_IDR -1
 typedef int(*DecoderRendererSubmitDecodeUnit)(PDECODE_UNIT decodeUnit);
 
+// This callback is used instead of submitDecodeUnit() if CAPABILITY_PARTIAL_FRAME_SUBMIT is set.
+// Each call provides the next complete NALUs of the frame in bitstream order. The buffer list is
+// only valid for the duration of the callback, so the decoder must consume or copy the data before
+// returning. Fields other than bufferList and fullLength describe the whole frame and are the same
+// in each call for a given frame.
+//
+// PARTIAL_DU_FLAG_END_OF_FRAME is set on the final call for a frame. A frame is only considered
+// complete (for the purposes of IDR frame tracking and frame loss recovery) after this call.
+//
+// PARTIAL_DU_FLAG_ABORT_FRAME is set if the rest of the frame was lost after some of it was already
+// submitted. The decoder must discard all data submitted for the frame. The buffer list is NULL
+// and fullLength is 0 in this case. The return value is ignored.
+//
+// Like submitDecodeUnit(), this must return DR_NEED_IDR if the decoder is unable to process the
+// submitted data. The rest of the frame will be discarded and a keyframe will be requested.
+#define PARTIAL_DU_FLAG_END_OF_FRAME 0x1
+#define PARTIAL_DU_FLAG_ABORT_FRAME  0x2
+typedef int(*DecoderRendererSubmitPartialDecodeUnit)(PDECODE_UNIT decodeUnit, int flags);
+
 typedef struct _DECODER_RENDERER_CALLBACKS {
     DecoderRendererSetup setup;
     DecoderRendererStart start;
@@ -305,6 +352,7 @@ typedef struct _DECODER_RENDERER_CALLBACKS {
     DecoderRendererCleanup cleanup;
     DecoderRendererSubmitDecodeUnit submitDecodeUnit;
     int capabilities;
+    DecoderRendererSubmitPartialDecodeUnit submitPartialDecodeUnit;
 } DECODER_RENDERER_CALLBACKS, *PDECODER_RENDERER_CALLBACKS;
 
 // Use this function to zero the video callbacks when allocated on the stack or heap
@@ -352,6 +400,25 @@ typedef void(*AudioRendererCleanup)(void);
 // This callback provides Opus audio data to be decoded and played. sampleLength is in bytes.
 typedef void(*AudioRendererDecodeAndPlaySample)(char* sampleData, int sampleLength);
 
+// A single Opus packet within a batch passed to decodeAndPlaySamples(). sampleData is NULL
+// and sampleLength is 0 for a lost packet, which should be concealed by the decoder just
+// like a call to decodeAndPlaySample(NULL, 0).
+//
+// presentationTimeMs is the audio RTP timestamp of the packet in milliseconds. It uses a different
+// epoch than video presentation times, so use LiMapAudioPresentationTime() and
+// LiMapVideoPresentationTime() to synchronize audio with video.
+typedef struct _OPUS_SAMPLE {
+    char* sampleData;
+    int sampleLength;
+    unsigned int presentationTimeMs;
+} OPUS_SAMPLE, *POPUS_SAMPLE;
+
+// This optional callback is used instead of decodeAndPlaySample() if provided. Each call provides
+// one or more consecutive Opus packets in playback order, so packets that become available
+// together (such as an FEC block that was just recovered) can be decoded and written to the
+// audio device in a single operation. The samples are only valid for the duration of the callback.
+typedef void(*AudioRendererDecodeAndPlaySamples)(POPUS_SAMPLE samples, int sampleCount);
+
 typedef struct _AUDIO_RENDERER_CALLBACKS {
     AudioRendererInit init;
     AudioRendererStart start;
@@ -359,6 +426,7 @@ typedef struct _AUDIO_RENDERER_CALLBACKS {
     AudioRendererCleanup cleanup;
     AudioRendererDecodeAndPlaySample decodeAndPlaySample;
     int capabilities;
+    AudioRendererDecodeAndPlaySamples decodeAndPlaySamples;
 } AUDIO_RENDERER_CALLBACKS, *PAUDIO_RENDERER_CALLBACKS;
 
 // Use this function to zero the audio callbacks when allocated on the stack or heap
@@ -838,6 +906,149 @@ int LiFindExternalAddressIP4(const char* stunServer, unsigned short stunPort, un
 // if CAPABILITY_DIRECT_SUBMIT is not set for the video renderer.
 int LiGetPendingVideoFrames(void);
 
+typedef struct _VIDEO_QUEUE_DROP_STATS {
+    // Total number of frames dropped from the video decode unit queue, either
+    // to enforce the latency cap in STREAM_CONFIGURATION or due to overflow
+    uint32_t droppedFrames;
+
+    // Number of times frames were dropped from the queue
+    uint32_t dropEvents;
+
+    // How each drop was recovered from. Drops are recovered by skipping ahead
+    // to an IDR frame that was already received, by reference frame
+    // invalidation, or by requesting a new IDR frame (in order of preference).
+    uint32_t idrSkipRecoveries;
+    uint32_t refInvalRecoveries;
+    uint32_t idrRequestRecoveries;
+} VIDEO_QUEUE_DROP_STATS, *PVIDEO_QUEUE_DROP_STATS;
+
+// Returns statistics on frames dropped from the video decode unit queue. Only
+// relevant if CAPABILITY_DIRECT_SUBMIT is not set for the video renderer.
+void LiGetVideoQueueDropStats(PVIDEO_QUEUE_DROP_STATS stats);
+
+typedef struct _RTP_REORDER_STATS {
+    // Number of audio and video packets received out of order
+    uint32_t audioReorderedPackets;
+    uint32_t videoReorderedPackets;
+
+    // Time that the audio queue waits for out of order packets before giving up
+    // on an FEC block, chosen from the measured audio reorder delay
+    uint32_t audioOosWaitTimeMs;
+
+    // Reorder distance (in packets) that the video queue expects before treating
+    // missing packets as lost, chosen from the measured video reorder distance
+    uint32_t videoReorderTolerancePackets;
+
+    // Number of audio data and video packets rejected as duplicates of packets
+    // that were already received (or too far behind to tell)
+    uint32_t audioDuplicatePackets;
+    uint32_t videoDuplicatePackets;
+} RTP_REORDER_STATS, *PRTP_REORDER_STATS;
+
+// Returns statistics on packet reordering and duplication in the audio and video
+// streams and the wait times that were adapted to it
+void LiGetRtpReorderStats(PRTP_REORDER_STATS stats);
+
+typedef struct _VIDEO_PACING_STATS {
+    // Number of frames whose packet arrival times were analyzed
+    uint32_t framesAnalyzed;
+
+    // Time between the arrival of the first and last packet of a frame
+    uint32_t avgFrameSpreadUs;
+    uint32_t maxFrameSpreadUs;
+
+    // Largest gap between two consecutive packets of a frame
+    uint32_t avgMaxPacketGapUs;
+
+    // Largest number of consecutive packets of a frame that arrived back to back.
+    // Large bursts from the host can overflow buffers along the network path.
+    uint32_t avgMaxBurstPackets;
+    uint32_t maxBurstPackets;
+
+    // Difference between the arrival interval of the first packets of consecutive
+    // frames and the interval between their presentation timestamps. A large value
+    // with a small frame spread points at variable host encode time rather than
+    // host send pacing or the network.
+    uint32_t avgArrivalJitterUs;
+
+    // Number of frames that needed FEC recovery and their average largest burst,
+    // for comparison with avgMaxBurstPackets
+    uint32_t fecRecoveredFrames;
+    uint32_t fecRecoveredAvgMaxBurstPackets;
+} VIDEO_PACING_STATS, *PVIDEO_PACING_STATS;
+
+// Returns statistics on the arrival timing of video packets within each frame.
+// Averages cover recent frames and maximums cover the entire stream.
+void LiGetVideoPacingStats(PVIDEO_PACING_STATS stats);
+
+// These functions map the presentation time of an audio sample (from OPUS_SAMPLE) or a video
+// frame (from DECODE_UNIT) onto the LiGetMillis() timeline shared by both streams. The result
+// is the time that the media would have been received if it saw the lowest delay recently
+// observed on its stream, so audio and video with the same mapped time should be played
+// together. The mapping follows clock drift between the host and client over time.
+// These return 0 if no media has been received on that stream yet.
+uint64_t LiMapAudioPresentationTime(unsigned int presentationTimeMs);
+uint64_t LiMapVideoPresentationTime(unsigned int presentationTimeMs);
+
+typedef struct _AV_SYNC_STATS {
+    // Number of audio packets (including concealed lost packets) passed to the audio renderer
+    uint32_t audioPacketsDelivered;
+
+    // Time from the mapped presentation time of each audio packet until it was passed to the
+    // audio renderer. This includes network jitter, waiting for FEC recovery, and time spent
+    // in the audio decoder queue. The average covers recent packets.
+    uint32_t avgAudioQueueLatencyMs;
+    uint32_t maxAudioQueueLatencyMs;
+
+    // Change in the arrival of audio relative to video since the start of the stream. This
+    // is positive if audio now arrives later relative to video than it did at the start.
+    // Only valid if avDriftAvailable is set.
+    bool avDriftAvailable;
+    int32_t avDriftMs;
+} AV_SYNC_STATS, *PAV_SYNC_STATS;
+
+// Returns statistics for synchronizing audio and video playback
+void LiGetAvSyncStats(PAV_SYNC_STATS stats);
+
+// Number of buckets in AUDIO_STREAM_STATS.callbackTimeBuckets
+#define AUDIO_CALLBACK_TIME_BUCKETS 16
+
+typedef struct _AUDIO_STREAM_STATS {
+    // Audio data and FEC packets received from the host, excluding
+    // those dropped during the initial resync period
+    uint32_t dataPacketsReceived;
+    uint32_t fecPacketsReceived;
+
+    // Lost audio data packets that were rebuilt from FEC data
+    uint32_t packetsRecovered;
+
+    // Lost audio data packets that were passed to the audio renderer
+    // as NULL samples for packet loss concealment
+    uint32_t packetsConcealed;
+
+    // Audio data packets that arrived after a later FEC block was already queued
+    uint32_t oosEvents;
+
+    // FEC blocks that were given up on with missing data
+    uint32_t abandonedFecBlocks;
+
+    // Audio packets dropped at the start of the stream to catch
+    // up with audio that the host queued before we were ready
+    uint32_t resyncDroppedPackets;
+
+    // Audio packets dropped because they couldn't be decrypted
+    uint32_t decryptFailures;
+
+    // Histogram of the execution time of the decodeAndPlaySample() or decodeAndPlaySamples()
+    // callback. Bucket 0 counts calls taking less than 1 us and bucket N counts calls taking
+    // from 2^(N-1) us up to 2^N us. The last bucket also counts all longer calls.
+    uint32_t callbackTimeBuckets[AUDIO_CALLBACK_TIME_BUCKETS];
+    uint32_t maxCallbackTimeUs;
+} AUDIO_STREAM_STATS, *PAUDIO_STREAM_STATS;
+
+// Returns statistics on packet loss, recovery and delivery in the audio stream
+void LiGetAudioStreamStats(PAUDIO_STREAM_STATS stats);
+
 // Returns the number of queued audio frames ready for delivery. Only relevant
 // if CAPABILITY_DIRECT_SUBMIT is not set for the audio renderer. For most uses,
 // LiGetPendingAudioDuration() is probably a better option than this function.
@@ -913,6 +1124,16 @@ bool LiPeekNextVideoFrame(PDECODE_UNIT* decodeUnit);
 void LiWakeWaitForVideoFrame(void);
 void LiCompleteVideoFrame(VIDEO_FRAME_HANDLE handle, int drStatus);
 
+// Returns a file descriptor that pull-based video renderers can wait on in their own event loop
+// with poll() or similar. It becomes readable when a frame is queued, when LiWakeWaitForVideoFrame()
+// is called, or when the stream is stopping. The renderer must not read from it. Instead, it should
+// call LiPollNextVideoFrame() until that returns false, which clears the fd once the queue is empty
+// and consumes a pending LiWakeWaitForVideoFrame(). The fd may be spuriously readable after the last
+// frame is dequeued. It is valid from LiStartConnection() until LiStopConnection() returns.
+//
+// This returns -1 if CAPABILITY_PULL_RENDERER is not set or the platform has no pollable fds (Windows).
+int LiGetVideoFrameReadyFd(void);
+
 // This function returns the last reported HDR mode from the host PC.
 // See ConnListenerSetHdrMode() for more details.
 bool LiGetCurrentHostDisplayHdrMode(void);
@@ -957,6 +1178,58 @@ void LiRequestIdrFrame(void);
 #define LI_FF_CONTROLLER_TOUCH_EVENTS 0x02 // LiSendControllerTouchEvent() supported
 uint32_t LiGetHostFeatureFlags(void);
 
+// Thread roles for use with LiSetThreadSchedulingConfig(). Each thread created by
+// moonlight-common-c is assigned one of these roles at creation time.
+#define THREAD_ROLE_DEFAULT       0 // Ping threads and other threads not listed below
+#define THREAD_ROLE_VIDEO_RECEIVE 1 // Video RTP receive thread
+#define THREAD_ROLE_VIDEO_DECODE  2 // Video decoder thread (not created with CAPABILITY_DIRECT_SUBMIT or CAPABILITY_PULL_RENDERER)
+#define THREAD_ROLE_AUDIO_RECEIVE 3 // Audio RTP receive thread
+#define THREAD_ROLE_AUDIO_DECODE  4 // Audio decoder thread (not created with CAPABILITY_DIRECT_SUBMIT)
+#define THREAD_ROLE_INPUT_SEND    5 // Input batching and send thread
+#define THREAD_ROLE_CONTROL       6 // Control stream receive, loss stats, IDR/RFI requests, and async callbacks
+#define THREAD_ROLE_VIDEO_FEC     7 // Video FEC recovery worker threads
+#define THREAD_ROLE_COUNT         8
+
+// Values for the 'policy' field below
+#define THREAD_SCHED_POLICY_DEFAULT 0 // Inherit the scheduling class and priority of the creating thread
+#define THREAD_SCHED_POLICY_NORMAL  1 // Time-sharing scheduling class using 'niceValue'
+#define THREAD_SCHED_POLICY_FIFO    2 // Real-time FIFO scheduling class using 'realtimePriority'
+#define THREAD_SCHED_POLICY_RR      3 // Real-time round-robin scheduling class using 'realtimePriority'
+
+typedef struct _THREAD_SCHEDULING_CONFIG {
+    // One of the THREAD_SCHED_POLICY_* values above
+    int policy;
+
+    // The nice value (-20 to 19) for THREAD_SCHED_POLICY_NORMAL. Negative values usually
+    // require elevated privileges. On Windows, this is mapped to the closest thread priority.
+    int niceValue;
+
+    // The real-time priority (1 to 99 on Linux) for THREAD_SCHED_POLICY_FIFO and
+    // THREAD_SCHED_POLICY_RR. The value is clamped to the range supported by the OS.
+    // On Windows, real-time policies are mapped to THREAD_PRIORITY_TIME_CRITICAL.
+    int realtimePriority;
+
+    // Bitmask of logical CPUs that this thread may run on, or 0 to leave the CPU affinity
+    // unchanged. This is supported on Linux (including Android) and Windows.
+    uint64_t cpuAffinityMask;
+} THREAD_SCHEDULING_CONFIG, *PTHREAD_SCHEDULING_CONFIG;
+
+// Use this function to zero the thread scheduling config when allocated on the stack or heap.
+// A zeroed config leaves the thread scheduling parameters unmodified.
+void LiInitializeThreadSchedulingConfig(PTHREAD_SCHEDULING_CONFIG config);
+
+// This function sets the scheduling parameters applied to threads with the specified THREAD_ROLE_*
+// value. Passing NULL for config restores the default behavior for that role. The configuration is
+// applied when each thread is created, so it must be called before LiStartConnection() to take effect.
+//
+// Scheduling parameters that cannot be applied (typically due to insufficient privileges) are logged
+// and the thread falls back to the next best option. A real-time policy that is not permitted falls
+// back to THREAD_SCHED_POLICY_NORMAL using 'niceValue', and a nice value that is not permitted is
+// left at the inherited value. These failures never prevent the thread from being created.
+//
+// Returns 0 on success or -1 if the role or config is invalid.
+int LiSetThreadSchedulingConfig(int role, PTHREAD_SCHEDULING_CONFIG config);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,5 +1,39 @@
 #include "LinkedBlockingQueue.h"
 
+#if defined(__linux__) && (defined(__GNUC__) || defined(__clang__))
+// The number of times a waiter will check for new data before blocking on the
+// condition variable (which is a futex wait on Linux). This avoids the futex
+// sleep and wakeup for producers that hand off data within a few microseconds.
+// Benchmarks override it to compare against not spinning.
+#ifndef LBQ_SPIN_COUNT
+#define LBQ_SPIN_COUNT 256
+#endif
+
+#if defined(__i386__) || defined(__x86_64__)
+#define LBQ_CPU_RELAX() __builtin_ia32_pause()
+#elif defined(__aarch64__) || defined(__arm__)
+#define LBQ_CPU_RELAX() __asm__ __volatile__("yield")
+#else
+#define LBQ_CPU_RELAX() __asm__ __volatile__("" ::: "memory")
+#endif
+
+static void spinForQueueElement(PLINKED_BLOCKING_QUEUE queueHead) {
+    for (int i = 0; i < queueHead->spinCount; i++) {
+        // These unlocked reads are only a hint. The caller rechecks them under the lock.
+        if (PltAtomicLoadPtr(&queueHead->head) != NULL ||
+                PltAtomicLoad32(&queueHead->shutdown) ||
+                PltAtomicLoad32(&queueHead->draining) ||
+                PltAtomicLoad32(&queueHead->pendingUserWake)) {
+            break;
+        }
+
+        LBQ_CPU_RELAX();
+    }
+}
+#else
+#define spinForQueueElement(queueHead)
+#endif
+
 // Destroy the linked blocking queue and associated mutex and event
 PLINKED_BLOCKING_QUEUE_ENTRY LbqDestroyLinkedBlockingQueue(PLINKED_BLOCKING_QUEUE queueHead) {
     LC_ASSERT(queueHead->shutdown || queueHead->draining || queueHead->lifetimeSize == 0);
@@ -54,26 +88,33 @@ int LbqInitializeLinkedBlockingQueue(PLINKED_BLOCKING_QUEUE queueHead, int sizeB
 
     queueHead->sizeBound = sizeBound;
 
+#ifdef LBQ_SPIN_COUNT
+    // Spinning only helps if the producer can run while we spin
+    if (sysconf(_SC_NPROCESSORS_ONLN) > 1) {
+        queueHead->spinCount = LBQ_SPIN_COUNT;
+    }
+#endif
+
     return 0;
 }
 
 void LbqSignalQueueShutdown(PLINKED_BLOCKING_QUEUE queueHead) {
     PltLockMutex(&queueHead->mutex);
-    queueHead->shutdown = true;
+    PltAtomicStore32(&queueHead->shutdown, 1);
     PltUnlockMutex(&queueHead->mutex);
     PltSignalConditionVariable(&queueHead->cond);
 }
 
 void LbqSignalQueueDrain(PLINKED_BLOCKING_QUEUE queueHead) {
     PltLockMutex(&queueHead->mutex);
-    queueHead->draining = true;
+    PltAtomicStore32(&queueHead->draining, 1);
     PltUnlockMutex(&queueHead->mutex);
     PltSignalConditionVariable(&queueHead->cond);
 }
 
 void LbqSignalQueueUserWake(PLINKED_BLOCKING_QUEUE queueHead) {
     PltLockMutex(&queueHead->mutex);
-    queueHead->pendingUserWake = true;
+    PltAtomicStore32(&queueHead->pendingUserWake, 1);
     PltUnlockMutex(&queueHead->mutex);
     PltSignalConditionVariable(&queueHead->cond);
 }
@@ -200,6 +241,8 @@ int LbqPollQueueElement(PLINKED_BLOCKING_QUEUE queueHead, void** data) {
 int LbqWaitForQueueElement(PLINKED_BLOCKING_QUEUE queueHead, void** data) {
     PLINKED_BLOCKING_QUEUE_ENTRY entry;
 
+    spinForQueueElement(queueHead);
+
     PltLockMutex(&queueHead->mutex);
 
     // Wait for a waking condition: either data available or rundown
@@ -215,7 +258,7 @@ int LbqWaitForQueueElement(PLINKED_BLOCKING_QUEUE queueHead, void** data) {
 
     // If this is a user requested wake, process it now
     if (queueHead->pendingUserWake) {
-        queueHead->pendingUserWake = false;
+        PltAtomicStore32(&queueHead->pendingUserWake, 0);
         PltUnlockMutex(&queueHead->mutex);
         return LBQ_USER_WAKE;
     }
@@ -247,3 +290,100 @@ int LbqWaitForQueueElement(PLINKED_BLOCKING_QUEUE queueHead, void** data) {
 
     return LBQ_SUCCESS;
 }
+
+// Detaches up to maxItems entries (or all entries if maxItems <= 0) from the head of
+// the queue. The queue mutex must be held and the queue must not be empty.
+static PLINKED_BLOCKING_QUEUE_ENTRY detachQueueEntries(PLINKED_BLOCKING_QUEUE queueHead, int maxItems) {
+    PLINKED_BLOCKING_QUEUE_ENTRY head, last;
+
+    head = queueHead->head;
+    LC_ASSERT(head != NULL);
+
+    if (maxItems <= 0 || maxItems >= queueHead->currentSize) {
+        // Take the entire chain
+        queueHead->head = NULL;
+        queueHead->tail = NULL;
+        queueHead->currentSize = 0;
+        return head;
+    }
+
+    last = head;
+    for (int i = 1; i < maxItems; i++) {
+        last = last->flink;
+    }
+
+    queueHead->head = last->flink;
+    queueHead->head->blink = NULL;
+    queueHead->currentSize -= maxItems;
+    LC_ASSERT(queueHead->currentSize != 0);
+
+    last->flink = NULL;
+    return head;
+}
+
+// Dequeues up to maxItems entries (or all entries if maxItems <= 0) in a single lock
+// acquisition without blocking. On success, the entries are returned as a NULL-terminated
+// chain linked by flink in FIFO order. Return values match LbqPollQueueElement().
+int LbqDrainQueueItems(PLINKED_BLOCKING_QUEUE queueHead, int maxItems, PLINKED_BLOCKING_QUEUE_ENTRY* entries) {
+    PltLockMutex(&queueHead->mutex);
+
+    if (queueHead->shutdown) {
+        PltUnlockMutex(&queueHead->mutex);
+        return LBQ_INTERRUPTED;
+    }
+
+    if (queueHead->head == NULL) {
+        if (queueHead->draining) {
+            PltUnlockMutex(&queueHead->mutex);
+            return LBQ_INTERRUPTED;
+        }
+        else {
+            PltUnlockMutex(&queueHead->mutex);
+            return LBQ_NO_ELEMENT;
+        }
+    }
+
+    *entries = detachQueueEntries(queueHead, maxItems);
+
+    PltUnlockMutex(&queueHead->mutex);
+
+    return LBQ_SUCCESS;
+}
+
+// Same as LbqDrainQueueItems() except it waits for at least one entry to be available.
+// Return values match LbqWaitForQueueElement().
+int LbqWaitForQueueElements(PLINKED_BLOCKING_QUEUE queueHead, int maxItems, PLINKED_BLOCKING_QUEUE_ENTRY* entries) {
+    spinForQueueElement(queueHead);
+
+    PltLockMutex(&queueHead->mutex);
+
+    // Wait for a waking condition: either data available or rundown
+    while (queueHead->head == NULL && !queueHead->draining && !queueHead->shutdown && !queueHead->pendingUserWake) {
+        PltWaitForConditionVariable(&queueHead->cond, &queueHead->mutex);
+    }
+
+    // If we're shutting down, abort immediately, even if there's data available
+    if (queueHead->shutdown) {
+        PltUnlockMutex(&queueHead->mutex);
+        return LBQ_INTERRUPTED;
+    }
+
+    // If this is a user requested wake, process it now
+    if (queueHead->pendingUserWake) {
+        PltAtomicStore32(&queueHead->pendingUserWake, 0);
+        PltUnlockMutex(&queueHead->mutex);
+        return LBQ_USER_WAKE;
+    }
+
+    // If we're draining, only abort if we have no data available
+    if (queueHead->draining && queueHead->head == NULL) {
+        PltUnlockMutex(&queueHead->mutex);
+        return LBQ_INTERRUPTED;
+    }
+
+    *entries = detachQueueEntries(queueHead, maxItems);
+
+    PltUnlockMutex(&queueHead->mutex);
+
+    return LBQ_SUCCESS;
+}
@@ -23,9 +23,11 @@ typedef struct _LINKED_BLOCKING_QUEUE {
     int sizeBound;
     int currentSize;
     int lifetimeSize;
-    bool shutdown;
-    bool draining;
-    bool pendingUserWake;
+    int spinCount;
+    // These are read without the mutex by waiters spinning for an element
+    uint32_t shutdown;
+    uint32_t draining;
+    uint32_t pendingUserWake;
 } LINKED_BLOCKING_QUEUE, *PLINKED_BLOCKING_QUEUE;
 
 int LbqInitializeLinkedBlockingQueue(PLINKED_BLOCKING_QUEUE queueHead, int sizeBound);
@@ -33,6 +35,8 @@ int LbqOfferQueueItem(PLINKED_BLOCKING_QUEUE queueHead, void* data, PLINKED_BLOC
 int LbqWaitForQueueElement(PLINKED_BLOCKING_QUEUE queueHead, void** data);
 int LbqPollQueueElement(PLINKED_BLOCKING_QUEUE queueHead, void** data);
 int LbqPeekQueueElement(PLINKED_BLOCKING_QUEUE queueHead, void** data);
+int LbqWaitForQueueElements(PLINKED_BLOCKING_QUEUE queueHead, int maxItems, PLINKED_BLOCKING_QUEUE_ENTRY* entries);
+int LbqDrainQueueItems(PLINKED_BLOCKING_QUEUE queueHead, int maxItems, PLINKED_BLOCKING_QUEUE_ENTRY* entries);
 PLINKED_BLOCKING_QUEUE_ENTRY LbqDestroyLinkedBlockingQueue(PLINKED_BLOCKING_QUEUE queueHead);
 PLINKED_BLOCKING_QUEUE_ENTRY LbqFlushQueueItems(PLINKED_BLOCKING_QUEUE queueHead);
 void LbqSignalQueueShutdown(PLINKED_BLOCKING_QUEUE queueHead);
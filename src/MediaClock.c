@@ -0,0 +1,167 @@
+#include "Limelight-internal.h"
+
+// The media clock maps the presentation times of audio packets and video frames onto
+// the local LiGetMillis() timeline, so renderers can line them up with each other.
+//
+// Audio RTP timestamps and video presentation times use unrelated epochs on the host,
+// so each stream gets its own offset from presentation time to local time. The offset
+// is the lowest (receive time - presentation time) seen recently, which corresponds to
+// a packet that saw the least delay in the network and the host. Using the lowest
+// offset of the current and previous window lets the offset follow clock drift
+// between the host and client while staying stable against network jitter.
+//
+// Each stream's offset is written only by its receive thread and read from any thread.
+
+// Length of the windows that the lowest offset is taken from
+#define MEDIA_CLOCK_WINDOW_MS 10000
+
+// Audio queue latency sums are halved after this many packets, so the
+// published average follows changing network conditions
+#define AUDIO_LATENCY_DECAY_SAMPLES 1024
+
+typedef struct _MEDIA_CLOCK_STREAM {
+    // Written only by the receive thread of the stream
+    uint64_t windowStartMs;
+    int32_t windowMinOffset;
+    int32_t previousWindowMinOffset;
+    uint32_t completedWindows;
+
+    // Published for other threads
+    uint32_t offset;
+    uint32_t offsetValid;
+} MEDIA_CLOCK_STREAM, *PMEDIA_CLOCK_STREAM;
+
+static uint64_t clockBaseMs;
+static MEDIA_CLOCK_STREAM audioClock;
+static MEDIA_CLOCK_STREAM videoClock;
+
+// The difference between the audio and video offsets when they were first established.
+// This is written by the audio receive thread before avBaselineValid is set.
+static uint32_t avBaseline;
+static uint32_t avBaselineValid;
+
+// Written only by the thread delivering audio to the renderer
+static uint64_t audioLatencySumMs;
+static uint32_t audioLatencySamples;
+static uint32_t audioPacketsDelivered;
+static uint32_t avgAudioQueueLatencyMs;
+static uint32_t maxAudioQueueLatencyMs;
+
+void initializeMediaClock(void) {
+    clockBaseMs = PltGetMillis();
+    memset(&audioClock, 0, sizeof(audioClock));
+    memset(&videoClock, 0, sizeof(videoClock));
+    avBaseline = 0;
+    avBaselineValid = 0;
+    audioLatencySumMs = 0;
+    audioLatencySamples = 0;
+    audioPacketsDelivered = 0;
+    avgAudioQueueLatencyMs = 0;
+    maxAudioQueueLatencyMs = 0;
+}
+
+static void addClockSample(PMEDIA_CLOCK_STREAM clock, uint32_t presentationTimeMs, uint64_t receiveTimeMs) {
+    // The offset is relative to the start of the stream, so it fits in 32 bits
+    int32_t offset = (int32_t)(uint32_t)(receiveTimeMs - clockBaseMs) - (int32_t)presentationTimeMs;
+
+    if (!clock->offsetValid) {
+        clock->windowStartMs = receiveTimeMs;
+        clock->windowMinOffset = offset;
+        clock->previousWindowMinOffset = offset;
+    }
+    else if (receiveTimeMs - clock->windowStartMs >= MEDIA_CLOCK_WINDOW_MS) {
+        // Start a new window, but keep the last one's lowest offset until this one is complete
+        clock->previousWindowMinOffset = clock->windowMinOffset;
+        clock->windowStartMs = receiveTimeMs;
+        clock->windowMinOffset = offset;
+        clock->completedWindows++;
+    }
+    else if (offset < clock->windowMinOffset) {
+        clock->windowMinOffset = offset;
+    }
+    else {
+        // The published offset can't have changed
+        return;
+    }
+
+    offset = clock->windowMinOffset < clock->previousWindowMinOffset ?
+        clock->windowMinOffset : clock->previousWindowMinOffset;
+    PltAtomicStore32(&clock->offset, (uint32_t)offset);
+    PltAtomicStore32(&clock->offsetValid, 1);
+}
+
+static uint64_t mapPresentationTime(PMEDIA_CLOCK_STREAM clock, uint32_t presentationTimeMs) {
+    if (!PltAtomicLoad32(&clock->offsetValid)) {
+        return 0;
+    }
+
+    return clockBaseMs + (uint64_t)((int64_t)presentationTimeMs + (int32_t)PltAtomicLoad32(&clock->offset));
+}
+
+void mediaClockAddAudioPacket(uint32_t presentationTimeMs, uint64_t receiveTimeMs) {
+    addClockSample(&audioClock, presentationTimeMs, receiveTimeMs);
+
+    // Once the audio offset has settled over a full window, remember how it
+    // relates to the video offset to measure how the two drift apart.
+    if (!avBaselineValid && audioClock.completedWindows != 0 && PltAtomicLoad32(&videoClock.offsetValid)) {
+        avBaseline = PltAtomicLoad32(&audioClock.offset) - PltAtomicLoad32(&videoClock.offset);
+        PltAtomicStore32(&avBaselineValid, 1);
+    }
+}
+
+void mediaClockAddVideoFrame(uint32_t presentationTimeMs, uint64_t receiveTimeMs) {
+    // GFE doesn't provide presentation times for video frames
+    if (presentationTimeMs == 0) {
+        return;
+    }
+
+    addClockSample(&videoClock, presentationTimeMs, receiveTimeMs);
+}
+
+void mediaClockAudioDelivered(uint32_t presentationTimeMs) {
+    uint64_t expectedTimeMs = mapPresentationTime(&audioClock, presentationTimeMs);
+    uint64_t now = PltGetMillis();
+    uint32_t latencyMs;
+
+    PltAtomicStore32(&audioPacketsDelivered, audioPacketsDelivered + 1);
+
+    if (expectedTimeMs == 0 || now < expectedTimeMs) {
+        return;
+    }
+
+    latencyMs = (uint32_t)(now - expectedTimeMs);
+    if (audioLatencySamples >= AUDIO_LATENCY_DECAY_SAMPLES) {
+        audioLatencySumMs /= 2;
+        audioLatencySamples /= 2;
+    }
+    audioLatencySumMs += latencyMs;
+    audioLatencySamples++;
+
+    PltAtomicStore32(&avgAudioQueueLatencyMs, (uint32_t)(audioLatencySumMs / audioLatencySamples));
+    if (latencyMs > maxAudioQueueLatencyMs) {
+        PltAtomicStore32(&maxAudioQueueLatencyMs, latencyMs);
+    }
+}
+
+uint64_t LiMapAudioPresentationTime(unsigned int presentationTimeMs) {
+    return mapPresentationTime(&audioClock, presentationTimeMs);
+}
+
+uint64_t LiMapVideoPresentationTime(unsigned int presentationTimeMs) {
+    return mapPresentationTime(&videoClock, presentationTimeMs);
+}
+
+void LiGetAvSyncStats(PAV_SYNC_STATS stats) {
+    memset(stats, 0, sizeof(*stats));
+
+    stats->audioPacketsDelivered = PltAtomicLoad32(&audioPacketsDelivered);
+    stats->avgAudioQueueLatencyMs = PltAtomicLoad32(&avgAudioQueueLatencyMs);
+    stats->maxAudioQueueLatencyMs = PltAtomicLoad32(&maxAudioQueueLatencyMs);
+
+    if (PltAtomicLoad32(&avBaselineValid)) {
+        uint32_t difference = PltAtomicLoad32(&audioClock.offset) - PltAtomicLoad32(&videoClock.offset);
+
+        stats->avDriftAvailable = true;
+        stats->avDriftMs = (int32_t)(difference - avBaseline);
+    }
+}
@@ -144,10 +144,19 @@ void LiInitializeServerInformation(PSERVER_INFORMATION serverInfo) {
     memset(serverInfo, 0, sizeof(*serverInfo));
 }
 
+void LiInitializeThreadSchedulingConfig(PTHREAD_SCHEDULING_CONFIG config) {
+    memset(config, 0, sizeof(*config));
+}
+
 uint64_t LiGetMillis(void) {
     return PltGetMillis();
 }
 
+void LiGetRtpReorderStats(PRTP_REORDER_STATS stats) {
+    getAudioReorderStats(stats);
+    getVideoReorderStats(stats);
+}
+
 uint32_t LiGetHostFeatureFlags(void) {
     return SunshineFeatureFlags;
 }
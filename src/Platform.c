@@ -1,19 +1,31 @@
 #define _GNU_SOURCE
 #include "Limelight-internal.h"
 
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+#endif
+
 // The maximum amount of time before observing an interrupt
-// in PltSleepMsInterruptible().
+// in PltSleepMsInterruptible() on platforms without a thread
+// interrupt primitive to wait on.
 #define INTERRUPT_PERIOD_MS 50
 
 struct thread_context {
     ThreadEntry entry;
     void* context;
     const char* name;
+    THREAD_SCHEDULING_CONFIG schedConfig;
 #if defined(__vita__)
     PLT_THREAD* thread;
 #endif
 };
 
+// Scheduling parameters for each THREAD_ROLE_* value
+static THREAD_SCHEDULING_CONFIG threadSchedConfigs[THREAD_ROLE_COUNT];
+
 static int activeThreads = 0;
 static int activeMutexes = 0;
 static int activeEvents = 0;
@@ -65,6 +77,101 @@ void setThreadNameWin32(const char* name) {
 #endif
 }
 
+static int niceValueToWin32Priority(int niceValue) {
+    if (niceValue <= -10) {
+        return THREAD_PRIORITY_HIGHEST;
+    }
+    else if (niceValue < 0) {
+        return THREAD_PRIORITY_ABOVE_NORMAL;
+    }
+    else if (niceValue == 0) {
+        return THREAD_PRIORITY_NORMAL;
+    }
+    else if (niceValue < 10) {
+        return THREAD_PRIORITY_BELOW_NORMAL;
+    }
+    else {
+        return THREAD_PRIORITY_LOWEST;
+    }
+}
+
+#endif
+
+// Applies the scheduling parameters to the calling thread. Failures are not fatal,
+// since the thread can still function (with worse latency) at the default priority.
+static void applyThreadSchedulingConfig(const char* name, PTHREAD_SCHEDULING_CONFIG config) {
+#if defined(LC_WINDOWS)
+    if (config->policy == THREAD_SCHED_POLICY_FIFO || config->policy == THREAD_SCHED_POLICY_RR) {
+        if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL)) {
+            Limelog("%s: SetThreadPriority(THREAD_PRIORITY_TIME_CRITICAL) failed: %d\n", name, (int)GetLastError());
+        }
+    }
+    else if (config->policy == THREAD_SCHED_POLICY_NORMAL) {
+        if (!SetThreadPriority(GetCurrentThread(), niceValueToWin32Priority(config->niceValue))) {
+            Limelog("%s: SetThreadPriority() failed: %d\n", name, (int)GetLastError());
+        }
+    }
+
+    if (config->cpuAffinityMask != 0) {
+        if (!SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)config->cpuAffinityMask)) {
+            Limelog("%s: SetThreadAffinityMask() failed: %d\n", name, (int)GetLastError());
+        }
+    }
+#elif defined(LC_POSIX) && !defined(__vita__) && !defined(__WIIU__) && !defined(__3DS__)
+    int policy = config->policy;
+
+    if (policy == THREAD_SCHED_POLICY_FIFO || policy == THREAD_SCHED_POLICY_RR) {
+        struct sched_param param;
+        int schedPolicy = policy == THREAD_SCHED_POLICY_FIFO ? SCHED_FIFO : SCHED_RR;
+        int minPriority = sched_get_priority_min(schedPolicy);
+        int maxPriority = sched_get_priority_max(schedPolicy);
+        int err;
+
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = config->realtimePriority;
+        if (param.sched_priority < minPriority) {
+            param.sched_priority = minPriority;
+        }
+        else if (param.sched_priority > maxPriority) {
+            param.sched_priority = maxPriority;
+        }
+
+        err = pthread_setschedparam(pthread_self(), schedPolicy, &param);
+        if (err != 0) {
+            // This is expected when running without CAP_SYS_NICE or an RLIMIT_RTPRIO allowance
+            Limelog("%s: Unable to set real-time scheduling policy (error %d). Falling back to nice value.\n", name, err);
+            policy = THREAD_SCHED_POLICY_NORMAL;
+        }
+    }
+
+#if defined(__linux__)
+    if (policy == THREAD_SCHED_POLICY_NORMAL) {
+        // On Linux, the nice value is a per-thread attribute when set by TID
+        if (setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), config->niceValue) < 0) {
+            Limelog("%s: Unable to set nice value %d (error %d)\n", name, config->niceValue, errno);
+        }
+    }
+
+    if (config->cpuAffinityMask != 0) {
+        cpu_set_t cpuSet;
+
+        CPU_ZERO(&cpuSet);
+        for (int i = 0; i < 64 && i < CPU_SETSIZE; i++) {
+            if (config->cpuAffinityMask & (1ULL << i)) {
+                CPU_SET(i, &cpuSet);
+            }
+        }
+
+        // A PID of 0 refers to the calling thread
+        if (sched_setaffinity(0, sizeof(cpuSet), &cpuSet) < 0) {
+            Limelog("%s: Unable to set CPU affinity mask 0x%llx (error %d)\n", name, (unsigned long long)config->cpuAffinityMask, errno);
+        }
+    }
+#endif
+#endif
+}
+
+#if defined(LC_WINDOWS)
 DWORD WINAPI ThreadProc(LPVOID lpParameter) {
     struct thread_context* ctx = (struct thread_context*)lpParameter;
 #elif defined(__vita__)
@@ -86,6 +193,10 @@ void* ThreadProc(void* context) {
     pthread_setname_np(ctx->name);
 #endif
 
+    if (ctx->schedConfig.policy != THREAD_SCHED_POLICY_DEFAULT || ctx->schedConfig.cpuAffinityMask != 0) {
+        applyThreadSchedulingConfig(ctx->name, &ctx->schedConfig);
+    }
+
     ctx->entry(ctx->context);
 
 #if defined(__vita__)
@@ -122,11 +233,38 @@ void PltSleepMs(int ms) {
 }
 
 void PltSleepMsInterruptible(PLT_THREAD* thread, int ms) {
+#if defined(LC_WINDOWS)
+    if (!PltIsThreadInterrupted(thread)) {
+        WaitForSingleObjectEx(thread->interruptEvent, ms, FALSE);
+    }
+#elif defined(__vita__) || defined(__WIIU__) || defined(__3DS__)
     while (ms > 0 && !PltIsThreadInterrupted(thread)) {
         int msToSleep = ms < INTERRUPT_PERIOD_MS ? ms : INTERRUPT_PERIOD_MS;
         PltSleepMs(msToSleep);
         ms -= msToSleep;
     }
+#else
+    uint64_t deadline = PltGetMillis() + ms;
+
+    while (!PltIsThreadInterrupted(thread)) {
+        struct pollfd pfd;
+        uint64_t now = PltGetMillis();
+        int err;
+
+        if (now >= deadline) {
+            break;
+        }
+
+        // The interrupt fd remains readable once signalled, so this will
+        // return immediately for all waits after PltInterruptThread().
+        pfd.fd = thread->interruptReadFd;
+        pfd.events = POLLIN;
+        err = poll(&pfd, 1, (int)(deadline - now));
+        if (err > 0 || (err < 0 && errno != EINTR)) {
+            break;
+        }
+    }
+#endif
 }
 
 int PltCreateMutex(PLT_MUTEX* mutex) {
@@ -193,6 +331,101 @@ void PltUnlockMutex(PLT_MUTEX* mutex) {
 #endif
 }
 
+int PltCreateWakeFd(int* readFd, int* writeFd) {
+#if defined(LC_WINDOWS) || defined(__vita__) || defined(__WIIU__) || defined(__3DS__)
+    *readFd = *writeFd = -1;
+    return -1;
+#elif defined(__linux__)
+    *readFd = *writeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (*readFd < 0) {
+        return errno;
+    }
+
+    return 0;
+#else
+    int fds[2];
+
+    if (pipe(fds) < 0) {
+        *readFd = *writeFd = -1;
+        return errno;
+    }
+
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+
+    *readFd = fds[0];
+    *writeFd = fds[1];
+    return 0;
+#endif
+}
+
+void PltCloseWakeFd(int readFd, int writeFd) {
+#if !defined(LC_WINDOWS) && !defined(__vita__) && !defined(__WIIU__) && !defined(__3DS__)
+    close(readFd);
+    if (writeFd != readFd) {
+        close(writeFd);
+    }
+#endif
+}
+
+void PltSignalWakeFd(int writeFd) {
+#if !defined(LC_WINDOWS) && !defined(__vita__) && !defined(__WIIU__) && !defined(__3DS__)
+    uint64_t val = 1;
+    if (write(writeFd, &val, sizeof(val)) < 0) {
+        // The wake fd is already signalled
+        LC_ASSERT(errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+#endif
+}
+
+void PltClearWakeFd(int readFd) {
+#if defined(__linux__)
+    uint64_t val;
+
+    // Reading an eventfd resets its counter
+    if (read(readFd, &val, sizeof(val)) < 0) {
+        LC_ASSERT(errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+#elif !defined(LC_WINDOWS) && !defined(__vita__) && !defined(__WIIU__) && !defined(__3DS__)
+    uint64_t val[8];
+
+    // Empty the pipe, since it may have been signalled more than once
+    while (read(readFd, val, sizeof(val)) > 0);
+#endif
+}
+
+static int createThreadInterruptPrimitive(PLT_THREAD* thread) {
+#if defined(LC_WINDOWS)
+    thread->interruptEvent = CreateEventEx(NULL, NULL, CREATE_EVENT_MANUAL_RESET, EVENT_ALL_ACCESS);
+    if (thread->interruptEvent == NULL) {
+        return -1;
+    }
+#elif defined(__vita__) || defined(__WIIU__) || defined(__3DS__)
+    // These platforms poll for interruption in PltSleepMsInterruptible()
+#else
+    int err = PltCreateWakeFd(&thread->interruptReadFd, &thread->interruptWriteFd);
+    if (err != 0) {
+        return err;
+    }
+#endif
+
+    return 0;
+}
+
+static void destroyThreadInterruptPrimitive(PLT_THREAD* thread) {
+#if defined(LC_WINDOWS)
+    CloseHandle(thread->interruptEvent);
+    thread->interruptEvent = NULL;
+#elif defined(__vita__) || defined(__WIIU__) || defined(__3DS__)
+    // Nothing to do
+#else
+    PltCloseWakeFd(thread->interruptReadFd, thread->interruptWriteFd);
+    thread->interruptReadFd = thread->interruptWriteFd = -1;
+#endif
+}
+
 void PltJoinThread(PLT_THREAD* thread) {
     LC_ASSERT(activeThreads > 0);
     activeThreads--;
@@ -212,6 +445,8 @@ void PltJoinThread(PLT_THREAD* thread) {
 #else
     pthread_join(thread->thread, NULL);
 #endif
+
+    destroyThreadInterruptPrimitive(thread);
 }
 
 void PltDetachThread(PLT_THREAD* thread) {
@@ -232,14 +467,36 @@ void PltDetachThread(PLT_THREAD* thread) {
 #else
     pthread_detach(thread->thread);
 #endif
+
+    // Detached threads can no longer be interrupted, so we can
+    // release the interrupt primitive now.
+    destroyThreadInterruptPrimitive(thread);
 }
 
 bool PltIsThreadInterrupted(PLT_THREAD* thread) {
     return thread->cancelled;
 }
 
+int PltGetThreadInterruptFd(PLT_THREAD* thread) {
+#if defined(LC_WINDOWS) || defined(__vita__) || defined(__WIIU__) || defined(__3DS__)
+    return -1;
+#else
+    return thread->interruptReadFd;
+#endif
+}
+
 void PltInterruptThread(PLT_THREAD* thread) {
     thread->cancelled = true;
+
+    // Wake the thread if it's waiting in PltSleepMsInterruptible()
+    // or waiting on a socket along with the interrupt fd.
+#if defined(LC_WINDOWS)
+    SetEvent(thread->interruptEvent);
+#elif defined(__vita__) || defined(__WIIU__) || defined(__3DS__)
+    // The thread will notice the interruption on its next poll
+#else
+    PltSignalWakeFd(thread->interruptWriteFd);
+#endif
 }
 
 #ifdef __WIIU__
@@ -248,9 +505,29 @@ static void thread_deallocator(OSThread *thread, void *stack) {
 }
 #endif
 
-int PltCreateThread(const char* name, ThreadEntry entry, void* context, PLT_THREAD* thread) {
+int LiSetThreadSchedulingConfig(int role, PTHREAD_SCHEDULING_CONFIG config) {
+    if (role < 0 || role >= THREAD_ROLE_COUNT) {
+        return -1;
+    }
+
+    if (config == NULL) {
+        memset(&threadSchedConfigs[role], 0, sizeof(threadSchedConfigs[role]));
+        return 0;
+    }
+
+    if (config->policy < THREAD_SCHED_POLICY_DEFAULT || config->policy > THREAD_SCHED_POLICY_RR) {
+        return -1;
+    }
+
+    threadSchedConfigs[role] = *config;
+    return 0;
+}
+
+int PltCreateThread(const char* name, int role, ThreadEntry entry, void* context, PLT_THREAD* thread) {
     struct thread_context* ctx;
 
+    LC_ASSERT(role >= 0 && role < THREAD_ROLE_COUNT);
+
     ctx = (struct thread_context*)malloc(sizeof(*ctx));
     if (ctx == NULL) {
         return -1;
@@ -259,13 +536,23 @@ int PltCreateThread(const char* name, ThreadEntry entry, void* context, PLT_THRE
     ctx->entry = entry;
     ctx->context = context;
     ctx->name = name;
+    ctx->schedConfig = threadSchedConfigs[role];
 
     thread->cancelled = false;
 
+    {
+        int err = createThreadInterruptPrimitive(thread);
+        if (err != 0) {
+            free(ctx);
+            return err;
+        }
+    }
+
 #if defined(LC_WINDOWS)
     {
         thread->handle = CreateThread(NULL, 0, ThreadProc, ctx, 0, NULL);
         if (thread->handle == NULL) {
+            destroyThreadInterruptPrimitive(thread);
             free(ctx);
             return -1;
         }
@@ -328,6 +615,7 @@ int PltCreateThread(const char* name, ThreadEntry entry, void* context, PLT_THRE
     {
         int err = pthread_create(&thread->thread, NULL, ThreadProc, ctx);
         if (err != 0) {
+            destroyThreadInterruptPrimitive(thread);
             free(ctx);
             return err;
         }
@@ -482,6 +770,35 @@ uint64_t PltGetMillis(void) {
 #endif
 }
 
+uint64_t PltGetMicroseconds(void) {
+#if defined(LC_WINDOWS)
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+
+    QueryPerformanceCounter(&counter);
+
+    // Split the division to avoid overflowing the multiplication
+    return ((uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000) +
+           ((uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart);
+#elif defined(CLOCK_MONOTONIC) && !defined(NO_CLOCK_GETTIME)
+    struct timespec tv;
+
+    clock_gettime(CLOCK_MONOTONIC, &tv);
+
+    return ((uint64_t)tv.tv_sec * 1000000) + (tv.tv_nsec / 1000);
+#else
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+
+    return ((uint64_t)tv.tv_sec * 1000000) + tv.tv_usec;
+#endif
+}
+
 bool PltSafeStrcpy(char* dest, size_t dest_size, const char* src) {
     LC_ASSERT(dest_size > 0);
 
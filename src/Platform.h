@@ -144,8 +144,30 @@
 #define IS_LITTLE_ENDIAN() (true)
 #endif
 
+// Sequentially consistent atomic operations on 32-bit values. The pointer loads and
+// stores are untorn but unordered, so they must be ordered by the 32-bit operations.
+#ifdef _MSC_VER
+#define PltAtomicLoad32(ptr) ((uint32_t)InterlockedCompareExchange((volatile LONG*)(ptr), 0, 0))
+#define PltAtomicStore32(ptr, value) ((void)InterlockedExchange((volatile LONG*)(ptr), (LONG)(value)))
+#define PltAtomicExchange32(ptr, value) ((uint32_t)InterlockedExchange((volatile LONG*)(ptr), (LONG)(value)))
+#define PltAtomicOr32(ptr, value) ((uint32_t)InterlockedOr((volatile LONG*)(ptr), (LONG)(value)))
+#define PltAtomicCompareExchange32(ptr, expected, desired) \
+    (InterlockedCompareExchange((volatile LONG*)(ptr), (LONG)(desired), (LONG)(expected)) == (LONG)(expected))
+#define PltAtomicLoadPtr(ptr) (*(void* volatile*)(ptr))
+#define PltAtomicStorePtr(ptr, value) ((void)(*(void* volatile*)(ptr) = (value)))
+#else
+#define PltAtomicLoad32(ptr) __atomic_load_n((ptr), __ATOMIC_SEQ_CST)
+#define PltAtomicStore32(ptr, value) __atomic_store_n((ptr), (value), __ATOMIC_SEQ_CST)
+#define PltAtomicExchange32(ptr, value) __atomic_exchange_n((ptr), (value), __ATOMIC_SEQ_CST)
+#define PltAtomicOr32(ptr, value) __atomic_fetch_or((ptr), (value), __ATOMIC_SEQ_CST)
+#define PltAtomicCompareExchange32(ptr, expected, desired) __sync_bool_compare_and_swap((ptr), (expected), (desired))
+#define PltAtomicLoadPtr(ptr) __atomic_load_n((ptr), __ATOMIC_RELAXED)
+#define PltAtomicStorePtr(ptr, value) __atomic_store_n((ptr), (value), __ATOMIC_RELAXED)
+#endif
+
 int initializePlatform(void);
 void cleanupPlatform(void);
 
 uint64_t PltGetMillis(void);
+uint64_t PltGetMicroseconds(void);
 bool PltSafeStrcpy(char* dest, size_t dest_size, const char* src);
@@ -30,6 +30,7 @@ static int addPkcs7PaddingInPlace(unsigned char* plaintext, int plaintextLen) {
 // When CIPHER_FLAG_PAD_TO_BLOCK_SIZE is used, inputData buffer must be allocated such that
 // the buffer length is at least ROUND_TO_PKCS7_PADDED_LEN(inputDataLength) and inputData
 // buffer may be modified!
+// For GCM, outputData may be the same as inputData to encrypt in place.
 // For GCM, the IV can change from message to message without CIPHER_FLAG_RESET_IV.
 // CIPHER_FLAG_RESET_IV is only required for GCM when the IV length changes.
 // Changing the key between encrypt/decrypt calls on a single context is not supported.
@@ -71,7 +72,28 @@ bool PltEncryptMessage(PPLT_CRYPTO_CONTEXT ctx, int algorithm, int flags,
         ctx->initialized = true;
     }
 
-    if (tag != NULL) {
+    if (tag != NULL && outputData == inputData) {
+        // For in-place encryption, use the streaming API which allows the output
+        // to exactly overlap the input and writes the tag separately.
+        if (mbedtls_cipher_set_iv(&ctx->ctx, iv, ivLength) != 0) {
+            return false;
+        }
+
+        mbedtls_cipher_reset(&ctx->ctx);
+
+        if (mbedtls_cipher_update_ad(&ctx->ctx, NULL, 0) != 0) {
+            return false;
+        }
+
+        if (mbedtls_cipher_update(&ctx->ctx, inputData, inputDataLength, outputData, &outLength) != 0) {
+            return false;
+        }
+
+        if (mbedtls_cipher_write_tag(&ctx->ctx, tag, tagLength) != 0) {
+            return false;
+        }
+    }
+    else if (tag != NULL) {
 #ifdef USE_MBEDTLS_CRYPTO_EXT
         // In mbedTLS, tag is always after ciphertext, while we need to put tag BEFORE ciphertext here
         // To avoid frequent heap allocation, we will use some evil tricks...
@@ -230,6 +252,7 @@ bool PltEncryptMessage(PPLT_CRYPTO_CONTEXT ctx, int algorithm, int flags,
 
 // When CBC is used, outputData buffer must be allocated such that the buffer length is
 // at least ROUND_TO_PKCS7_PADDED_LEN(inputDataLength) to allow room for PKCS7 padding.
+// For GCM, outputData may be the same as inputData to decrypt in place.
 // For GCM, the IV can change from message to message without CIPHER_FLAG_RESET_IV.
 // CIPHER_FLAG_RESET_IV is only required for GCM when the IV length changes.
 // Changing the key between encrypt/decrypt calls on a single context is not supported.
@@ -271,7 +294,29 @@ bool PltDecryptMessage(PPLT_CRYPTO_CONTEXT ctx, int algorithm, int flags,
         ctx->initialized = true;
     }
 
-    if (tag != NULL) {
+    if (tag != NULL && outputData == inputData) {
+        // For in-place decryption, use the streaming API which allows the output
+        // to exactly overlap the input and doesn't require moving the tag around.
+        // The plaintext is garbage if the tag check fails, so callers must drop it.
+        if (mbedtls_cipher_set_iv(&ctx->ctx, iv, ivLength) != 0) {
+            return false;
+        }
+
+        mbedtls_cipher_reset(&ctx->ctx);
+
+        if (mbedtls_cipher_update_ad(&ctx->ctx, NULL, 0) != 0) {
+            return false;
+        }
+
+        if (mbedtls_cipher_update(&ctx->ctx, inputData, inputDataLength, outputData, &outLength) != 0) {
+            return false;
+        }
+
+        if (mbedtls_cipher_check_tag(&ctx->ctx, tag, tagLength) != 0) {
+            return false;
+        }
+    }
+    else if (tag != NULL) {
 #ifdef USE_MBEDTLS_CRYPTO_EXT
         // We only support 16 bytes sized tag
         LC_ASSERT(tagLength == 16);
@@ -178,17 +178,56 @@ bool isSocketReadable(SOCKET s) {
     return true;
 }
 
-int recvUdpSocket(SOCKET s, char* buffer, int size, bool useSelect) {
+// Waits up to timeoutMs (or forever if negative) for a datagram. If interruptFd is -1,
+// the wait can't be interrupted, so it returns 0 after at most UDP_RECV_POLL_TIMEOUT_MS
+// to let the caller check whether it was interrupted.
+int recvUdpSocket(SOCKET s, char* buffer, int size, bool useSelect, int interruptFd, int timeoutMs) {
     int err;
 
     do {
+#ifdef MSG_DONTWAIT
+        if (interruptFd >= 0) {
+            // Try a non-blocking receive first, so we only pay for the extra
+            // poll() syscall when no data is already waiting on the socket.
+            err = (int)recvfrom(s, buffer, size, MSG_DONTWAIT, NULL, NULL);
+            if (err < 0 && (LastSocketError() == EWOULDBLOCK || LastSocketError() == EAGAIN)) {
+                struct pollfd pfds[2];
+
+                // Wait for the socket to be readable or the interrupt fd to be
+                // signalled by PltInterruptThread().
+                pfds[0].fd = s;
+                pfds[0].events = POLLIN;
+                pfds[1].fd = interruptFd;
+                pfds[1].events = POLLIN;
+                err = pollSockets(pfds, 2, timeoutMs);
+                if (err <= 0) {
+                    // Return if an error or timeout occurs
+                    return err;
+                }
+                else if (pfds[1].revents != 0) {
+                    // Return 0 like a timeout if we were interrupted. The caller
+                    // is expected to check for interruption after a timeout.
+                    return 0;
+                }
+
+                // The socket is readable, but the datagram may still be discarded
+                // (due to a bad checksum, for example) so we can't block here.
+                err = (int)recvfrom(s, buffer, size, MSG_DONTWAIT, NULL, NULL);
+                if (err < 0 && (LastSocketError() == EWOULDBLOCK || LastSocketError() == EAGAIN)) {
+                    return 0;
+                }
+            }
+        }
+        else
+#endif
         if (useSelect) {
             struct pollfd pfd;
 
             // Wait up to 100 ms for the socket to be readable
             pfd.fd = s;
             pfd.events = POLLIN;
-            err = pollSockets(&pfd, 1, UDP_RECV_POLL_TIMEOUT_MS);
+            err = pollSockets(&pfd, 1, timeoutMs >= 0 && timeoutMs < UDP_RECV_POLL_TIMEOUT_MS ?
+                                           timeoutMs : UDP_RECV_POLL_TIMEOUT_MS);
             if (err <= 0) {
                 // Return if an error or timeout occurs
                 return err;
@@ -230,6 +269,26 @@ int recvUdpSocket(SOCKET s, char* buffer, int size, bool useSelect) {
     return err;
 }
 
+// Receives a datagram only if one is already waiting on the socket. This returns 0
+// if no data is available or if the platform can't perform a non-blocking receive
+// on a blocking socket, so callers must treat it as an opportunistic fast path.
+int recvUdpSocketNoWait(SOCKET s, char* buffer, int size) {
+#ifdef MSG_DONTWAIT
+    int err;
+
+    do {
+        err = (int)recvfrom(s, buffer, size, MSG_DONTWAIT, NULL, NULL);
+        if (err < 0 && (LastSocketError() == EWOULDBLOCK || LastSocketError() == EAGAIN)) {
+            return 0;
+        }
+    } while (err < 0 && LastSocketError() == ECONNREFUSED);
+
+    return err;
+#else
+    return 0;
+#endif
+}
+
 void closeSocket(SOCKET s) {
 #if defined(LC_WINDOWS)
     closesocket(s);
@@ -105,7 +105,8 @@ int sendMtuSafe(SOCKET s, char* buffer, int size);
 SOCKET bindUdpSocket(int addressFamily, struct sockaddr_storage* localAddr, SOCKADDR_LEN addrLen, int bufferSize, int socketQosType);
 int enableNoDelay(SOCKET s);
 int setSocketNonBlocking(SOCKET s, bool enabled);
-int recvUdpSocket(SOCKET s, char* buffer, int size, bool useSelect);
+int recvUdpSocket(SOCKET s, char* buffer, int size, bool useSelect, int interruptFd, int timeoutMs);
+int recvUdpSocketNoWait(SOCKET s, char* buffer, int size);
 void shutdownTcpSocket(SOCKET s);
 int setNonFatalRecvTimeoutMs(SOCKET s, int timeoutMs);
 void closeSocket(SOCKET s);
@@ -10,6 +10,7 @@ typedef SRWLOCK PLT_MUTEX;
 typedef CONDITION_VARIABLE PLT_COND;
 typedef struct _PLT_THREAD {
     HANDLE handle;
+    HANDLE interruptEvent;
     bool cancelled;
 } PLT_THREAD;
 #elif defined(__vita__)
@@ -40,6 +41,10 @@ typedef pthread_mutex_t PLT_MUTEX;
 typedef pthread_cond_t PLT_COND;
 typedef struct _PLT_THREAD {
     pthread_t thread;
+    // Becomes readable when the thread is interrupted. These
+    // are the same eventfd on Linux and a pipe elsewhere.
+    int interruptReadFd;
+    int interruptWriteFd;
     bool cancelled;
 } PLT_THREAD;
 #else
@@ -61,12 +66,21 @@ void PltDeleteMutex(PLT_MUTEX* mutex);
 void PltLockMutex(PLT_MUTEX* mutex);
 void PltUnlockMutex(PLT_MUTEX* mutex);
 
-int PltCreateThread(const char* name, ThreadEntry entry, void* context, PLT_THREAD* thread);
+int PltCreateThread(const char* name, int role, ThreadEntry entry, void* context, PLT_THREAD* thread);
 void PltInterruptThread(PLT_THREAD* thread);
 bool PltIsThreadInterrupted(PLT_THREAD* thread);
+int PltGetThreadInterruptFd(PLT_THREAD* thread);
 void PltJoinThread(PLT_THREAD* thread);
 void PltDetachThread(PLT_THREAD* thread);
 
+// A wake fd becomes readable when signalled and stays readable until cleared. The read
+// and write fds are the same eventfd on Linux and a pipe elsewhere. Creation fails on
+// platforms without pollable fds.
+int PltCreateWakeFd(int* readFd, int* writeFd);
+void PltCloseWakeFd(int readFd, int writeFd);
+void PltSignalWakeFd(int writeFd);
+void PltClearWakeFd(int readFd);
+
 int PltCreateEvent(PLT_EVENT* event);
 void PltCloseEvent(PLT_EVENT* event);
 void PltSetEvent(PLT_EVENT* event);
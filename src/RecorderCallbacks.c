@@ -51,6 +51,19 @@ static int recDrSubmitDecodeUnit(PDECODE_UNIT decodeUnit)
     return realDrCallbacks.submitDecodeUnit(decodeUnit);
 }
 
+static int recDrSubmitPartialDecodeUnit(PDECODE_UNIT decodeUnit, int flags)
+{
+    if (videoFile != NULL) {
+        PLENTRY entry = decodeUnit->bufferList;
+        while (entry != NULL) {
+            fwrite(entry->data, 1, entry->length, videoFile);
+            entry = entry->next;
+        }
+    }
+
+    return realDrCallbacks.submitPartialDecodeUnit(decodeUnit, flags);
+}
+
 static int recArInit(int audioConfiguration, POPUS_MULTISTREAM_CONFIGURATION opusConfig, void* context, int arFlags)
 {
     const char* path = context;
@@ -87,6 +100,19 @@ static void recArDecodeAndPlaySample(char* sampleData, int sampleLength)
     realArCallbacks.decodeAndPlaySample(sampleData, sampleLength);
 }
 
+static void recArDecodeAndPlaySamples(POPUS_SAMPLE samples, int sampleCount)
+{
+    if (audioFile != NULL) {
+        for (int i = 0; i < sampleCount; i++) {
+            if (samples[i].sampleData != NULL) {
+                fwrite(samples[i].sampleData, 1, samples[i].sampleLength, audioFile);
+            }
+        }
+    }
+
+    realArCallbacks.decodeAndPlaySamples(samples, sampleCount);
+}
+
 void setRecorderCallbacks(PDECODER_RENDERER_CALLBACKS drCallbacks, PAUDIO_RENDERER_CALLBACKS arCallbacks)
 {
     realDrCallbacks = *drCallbacks;
@@ -95,8 +121,14 @@ void setRecorderCallbacks(PDECODER_RENDERER_CALLBACKS drCallbacks, PAUDIO_RENDER
     drCallbacks->setup = recDrSetup;
     drCallbacks->cleanup = recDrCleanup;
     drCallbacks->submitDecodeUnit = recDrSubmitDecodeUnit;
+    if (drCallbacks->submitPartialDecodeUnit != NULL) {
+        drCallbacks->submitPartialDecodeUnit = recDrSubmitPartialDecodeUnit;
+    }
 
     arCallbacks->init = recArInit;
     arCallbacks->cleanup = recArCleanup;
     arCallbacks->decodeAndPlaySample = recArDecodeAndPlaySample;
+    if (arCallbacks->decodeAndPlaySamples != NULL) {
+        arCallbacks->decodeAndPlaySamples = recArDecodeAndPlaySamples;
+    }
 }
@@ -15,9 +15,75 @@
 #define FEC_VERBOSE
 #endif
 
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 #define RTP_PAYLOAD_TYPE_AUDIO   97
 #define RTP_PAYLOAD_TYPE_FEC     127
 
+static void precomputeFecRecovery(PRTP_AUDIO_QUEUE queue, reed_solomon* rs) {
+    int patternCount = 0;
+
+    // Missing shards are indexed by a bitmask of the marks array. We recover
+    // from the first RTPA_DATA_SHARDS shards present, just like reed_solomon_reconstruct(),
+    // so all masks with the same inputs share a single decode matrix.
+    for (int missingMask = 0; missingMask < (1 << RTPA_TOTAL_SHARDS); missingMask++) {
+        uint8_t inputShards[RTPA_DATA_SHARDS];
+        int inputCount = 0;
+        int pattern;
+
+        for (int i = 0; i < RTPA_TOTAL_SHARDS && inputCount < RTPA_DATA_SHARDS; i++) {
+            if (!(missingMask & (1 << i))) {
+                inputShards[inputCount++] = (uint8_t)i;
+            }
+        }
+
+        if (inputCount < RTPA_DATA_SHARDS) {
+            queue->fecRecoveryIndex[missingMask] = -1;
+            continue;
+        }
+
+        for (pattern = 0; pattern < patternCount; pattern++) {
+            if (memcmp(queue->fecRecovery[pattern].inputShards, inputShards, sizeof(inputShards)) == 0) {
+                break;
+            }
+        }
+
+        if (pattern == patternCount) {
+            PRTPA_FEC_RECOVERY recovery = &queue->fecRecovery[pattern];
+            unsigned char decodeMatrix[RTPA_DATA_SHARDS * RTPA_DATA_SHARDS];
+
+            LC_ASSERT(patternCount < RTPA_FEC_RECOVERY_PATTERNS);
+            if (reed_solomon_decode_matrix(rs, inputShards, decodeMatrix) != 0) {
+                LC_ASSERT(false);
+                queue->fecRecoveryIndex[missingMask] = -1;
+                continue;
+            }
+
+            memcpy(recovery->inputShards, inputShards, sizeof(inputShards));
+            for (int i = 0; i < RTPA_DATA_SHARDS; i++) {
+                for (int j = 0; j < RTPA_DATA_SHARDS; j++) {
+                    unsigned char coeff = decodeMatrix[i * RTPA_DATA_SHARDS + j];
+
+                    for (int n = 0; n < 16; n++) {
+                        recovery->mulLo[i][j][n] = reed_solomon_gf_mul(coeff, (unsigned char)n);
+                        recovery->mulHi[i][j][n] = reed_solomon_gf_mul(coeff, (unsigned char)(n << 4));
+                    }
+                }
+            }
+
+            patternCount++;
+        }
+
+        queue->fecRecoveryIndex[missingMask] = (int8_t)pattern;
+    }
+
+    LC_ASSERT(patternCount == RTPA_FEC_RECOVERY_PATTERNS);
+}
+
 void RtpaInitializeQueue(PRTP_AUDIO_QUEUE queue) {
     memset(queue, 0, sizeof(*queue));
 
@@ -25,6 +91,10 @@ void RtpaInitializeQueue(PRTP_AUDIO_QUEUE queue) {
     // full FEC block before reporting losses, out of order packets, etc.
     queue->synchronizing = true;
 
+    RtprInitialize(&queue->reorderEstimator);
+    RtpwInitialize(&queue->replayWindow);
+    queue->oosWaitTimeMs = RTPQ_OOS_WAIT_TIME_MS;
+
     // Older versions of GFE violate some invariants that our FEC code requires, so we turn it off for
     // anything older than GFE 3.19 just to be safe. GFE seems to have changed to the "modern" behavior
     // between GFE 3.18 and 3.19.
@@ -47,7 +117,7 @@ void RtpaInitializeQueue(PRTP_AUDIO_QUEUE queue) {
 
     // The number of data and parity shards is constant, so we can reuse
     // the same RS matrices for all traffic.
-    queue->rs = reed_solomon_new(RTPA_DATA_SHARDS, RTPA_FEC_SHARDS);
+    reed_solomon* rs = reed_solomon_new(RTPA_DATA_SHARDS, RTPA_FEC_SHARDS);
 
     // For unknown reasons, the RS parity matrix computed by our RS implementation
     // doesn't match the one Nvidia uses for audio data. I'm not exactly sure why,
@@ -55,8 +125,11 @@ void RtpaInitializeQueue(PRTP_AUDIO_QUEUE queue) {
     // works correctly. This is possible because the data and FEC shard count is
     // constant and known in advance.
     const unsigned char parity[] = { 0x77, 0x40, 0x38, 0x0e, 0xc7, 0xa7, 0x0d, 0x6c };
-    memcpy(&queue->rs->m[16], parity, sizeof(parity));
-    memcpy(queue->rs->parity, parity, sizeof(parity));
+    memcpy(&rs->m[16], parity, sizeof(parity));
+    memcpy(rs->parity, parity, sizeof(parity));
+
+    precomputeFecRecovery(queue, rs);
+    reed_solomon_release(rs);
 }
 
 static void validateFecBlockState(PRTP_AUDIO_QUEUE queue) {
@@ -188,9 +261,6 @@ void RtpaCleanupQueue(PRTP_AUDIO_QUEUE queue) {
     }
 
     LC_ASSERT(queue->freeBlockCount == 0);
-
-    reed_solomon_release(queue->rs);
-    queue->rs = NULL;
 }
 
 static PRTPA_FEC_BLOCK getFecBlockForRtpPacket(PRTP_AUDIO_QUEUE queue, PRTP_PACKET packet, uint16_t length) {
@@ -209,9 +279,21 @@ static PRTPA_FEC_BLOCK getFecBlockForRtpPacket(PRTP_AUDIO_QUEUE queue, PRTP_PACK
             return NULL;
         }
 
+        // Wait long enough for most of the reordered packets we've seen to arrive
+        if (RtprAddPacket(&queue->reorderEstimator, packet->sequenceNumber, PltGetMillis()) != 0) {
+            uint32_t oosWaitTimeMs = RtprGetDelayPercentile(&queue->reorderEstimator, RTPR_TARGET_PERCENTILE, RTPQ_OOS_WAIT_TIME_MS - 1) + 1;
+            if (oosWaitTimeMs > RTPQ_MAX_OOS_WAIT_TIME_MS) {
+                oosWaitTimeMs = RTPQ_MAX_OOS_WAIT_TIME_MS;
+            }
+
+            // This is read by other threads for stats
+            PltAtomicStore32(&queue->oosWaitTimeMs, oosWaitTimeMs);
+        }
+
         // Remember if we've received out-of-sequence packets lately. We can use
         // this knowledge to more quickly give up on FEC blocks.
         if (!queue->synchronizing && isBefore16(packet->sequenceNumber, queue->oldestRtpBaseSequenceNumber)) {
+            PltAtomicStore32(&queue->oosEvents, queue->oosEvents + 1);
             queue->lastOosSequenceNumber = packet->sequenceNumber;
             if (!queue->receivedOosData) {
                 Limelog("Leaving fast audio recovery mode after OOS audio data (%u < %u)\n",
@@ -387,6 +469,63 @@ static PRTPA_FEC_BLOCK getFecBlockForRtpPacket(PRTP_AUDIO_QUEUE queue, PRTP_PACK
     return block;
 }
 
+// Computes output = sum(coeff[i] * inputs[i]) over GF(2^8) using the nibble tables for each coefficient
+static void recoverDataShard(uint8_t mulLo[RTPA_DATA_SHARDS][16], uint8_t mulHi[RTPA_DATA_SHARDS][16],
+                             const uint8_t* inputs[RTPA_DATA_SHARDS], uint8_t* output, uint16_t size) {
+    uint16_t i = 0;
+
+#if defined(__SSSE3__)
+    const __m128i nibbleMask = _mm_set1_epi8(0x0F);
+    __m128i lo[RTPA_DATA_SHARDS], hi[RTPA_DATA_SHARDS];
+
+    for (int j = 0; j < RTPA_DATA_SHARDS; j++) {
+        lo[j] = _mm_loadu_si128((const __m128i*)mulLo[j]);
+        hi[j] = _mm_loadu_si128((const __m128i*)mulHi[j]);
+    }
+
+    for (; i + 16 <= size; i += 16) {
+        __m128i acc = _mm_setzero_si128();
+
+        for (int j = 0; j < RTPA_DATA_SHARDS; j++) {
+            __m128i x = _mm_loadu_si128((const __m128i*)&inputs[j][i]);
+            acc = _mm_xor_si128(acc, _mm_shuffle_epi8(lo[j], _mm_and_si128(x, nibbleMask)));
+            acc = _mm_xor_si128(acc, _mm_shuffle_epi8(hi[j], _mm_and_si128(_mm_srli_epi64(x, 4), nibbleMask)));
+        }
+
+        _mm_storeu_si128((__m128i*)&output[i], acc);
+    }
+#elif defined(__aarch64__)
+    const uint8x16_t nibbleMask = vdupq_n_u8(0x0F);
+    uint8x16_t lo[RTPA_DATA_SHARDS], hi[RTPA_DATA_SHARDS];
+
+    for (int j = 0; j < RTPA_DATA_SHARDS; j++) {
+        lo[j] = vld1q_u8(mulLo[j]);
+        hi[j] = vld1q_u8(mulHi[j]);
+    }
+
+    for (; i + 16 <= size; i += 16) {
+        uint8x16_t acc = vdupq_n_u8(0);
+
+        for (int j = 0; j < RTPA_DATA_SHARDS; j++) {
+            uint8x16_t x = vld1q_u8(&inputs[j][i]);
+            acc = veorq_u8(acc, vqtbl1q_u8(lo[j], vandq_u8(x, nibbleMask)));
+            acc = veorq_u8(acc, vqtbl1q_u8(hi[j], vshrq_n_u8(x, 4)));
+        }
+
+        vst1q_u8(&output[i], acc);
+    }
+#endif
+
+    for (; i < size; i++) {
+        uint8_t x0 = inputs[0][i], x1 = inputs[1][i], x2 = inputs[2][i], x3 = inputs[3][i];
+
+        output[i] = mulLo[0][x0 & 0xF] ^ mulHi[0][x0 >> 4] ^
+                    mulLo[1][x1 & 0xF] ^ mulHi[1][x1 >> 4] ^
+                    mulLo[2][x2 & 0xF] ^ mulHi[2][x2 >> 4] ^
+                    mulLo[3][x3 & 0xF] ^ mulHi[3][x3 >> 4];
+    }
+}
+
 static bool completeFecBlock(PRTP_AUDIO_QUEUE queue, PRTPA_FEC_BLOCK block) {
     uint8_t* shards[RTPA_TOTAL_SHARDS];
 
@@ -434,13 +573,32 @@ static bool completeFecBlock(PRTP_AUDIO_QUEUE queue, PRTPA_FEC_BLOCK block) {
     memset(block->dataPackets[dropIndex], 0, sizeof(RTP_PACKET) + block->blockSize);
 #endif
 
-    int res = reed_solomon_reconstruct(queue->rs, shards, block->marks, RTPA_TOTAL_SHARDS, block->blockSize);
-    if (res != 0) {
+    uint8_t missingMask = 0;
+    for (int i = 0; i < RTPA_TOTAL_SHARDS; i++) {
+        if (block->marks[i]) {
+            missingMask |= 1 << i;
+        }
+    }
+
+    int pattern = queue->fecRecoveryIndex[missingMask];
+    if (pattern < 0) {
         // We should always have enough data to recover the entire block since we checked above.
-        LC_ASSERT(res == 0);
+        LC_ASSERT(pattern >= 0);
         return false;
     }
 
+    PRTPA_FEC_RECOVERY recovery = &queue->fecRecovery[pattern];
+    const uint8_t* inputs[RTPA_DATA_SHARDS];
+    for (int i = 0; i < RTPA_DATA_SHARDS; i++) {
+        inputs[i] = shards[recovery->inputShards[i]];
+    }
+
+    for (int i = 0; i < RTPA_DATA_SHARDS; i++) {
+        if (block->marks[i]) {
+            recoverDataShard(recovery->mulLo[i], recovery->mulHi[i], inputs, shards[i], block->blockSize);
+        }
+    }
+
     // We will need to recover the RTP packet using the FEC header
     for (int i = 0; i < RTPA_DATA_SHARDS; i++) {
         if (block->marks[i]) {
@@ -451,6 +609,7 @@ static bool completeFecBlock(PRTP_AUDIO_QUEUE queue, PRTPA_FEC_BLOCK block) {
             block->dataPackets[i]->ssrc = block->fecHeader.ssrc;
 
             block->marks[i] = 0;
+            PltAtomicStore32(&queue->recoveredPackets, queue->recoveredPackets + 1);
         }
     }
 
@@ -531,7 +690,7 @@ static void handleMissingPackets(PRTP_AUDIO_QUEUE queue) {
     // At this point, we know we've got a second FEC block queued up waiting on the first one to complete.
     // If we've never seen OOS data from this host, we'll assume the first one is lost and skip forward.
     // If we have seen OOS data, we'll wait for a little while longer to see if OOS packets arrive before giving up.
-    if (!queue->receivedOosData || PltGetMillis() - queue->blockHead->queueTimeMs > (uint32_t)(AudioPacketDuration * RTPA_DATA_SHARDS) + RTPQ_OOS_WAIT_TIME_MS) {
+    if (!queue->receivedOosData || PltGetMillis() - queue->blockHead->queueTimeMs > (uint32_t)(AudioPacketDuration * RTPA_DATA_SHARDS) + queue->oosWaitTimeMs) {
         LC_ASSERT(!isBefore16(queue->nextRtpSequenceNumber, queue->blockHead->fecHeader.baseSequenceNumber));
 
         Limelog("Unable to recover audio data block %u to %u (%u+%u=%u received < %u needed)\n",
@@ -541,6 +700,7 @@ static void handleMissingPackets(PRTP_AUDIO_QUEUE queue) {
                 queue->blockHead->fecShardsReceived,
                 queue->blockHead->dataShardsReceived + queue->blockHead->fecShardsReceived,
                 RTPA_DATA_SHARDS);
+        PltAtomicStore32(&queue->abandonedBlocks, queue->abandonedBlocks + 1);
 
         // Return all available audio data even if there are discontinuities
         queue->blockHead->allowDiscontinuity = true;
@@ -550,10 +710,15 @@ static void handleMissingPackets(PRTP_AUDIO_QUEUE queue) {
 }
 
 int RtpaAddPacket(PRTP_AUDIO_QUEUE queue, PRTP_PACKET packet, uint16_t length) {
+    // Reject duplicated audio data, even if it's for an FEC block that we've already freed
+    if (packet->packetType == RTP_PAYLOAD_TYPE_AUDIO && !RtpwAddPacket(&queue->replayWindow, packet->sequenceNumber)) {
+        return 0;
+    }
+
     if (queue->incompatibleServer) {
         // Just feed audio data straight through to the decoder. We lose handling of out-of-order
-        // and duplicated packets in this mode, but it shouldn't be a problem for the very small
-        // portion of users that are running an ancient GFE or Sunshine version.
+        // packets in this mode, but it shouldn't be a problem for the very small portion of
+        // users that are running an ancient GFE or Sunshine version.
         if (packet->packetType == RTP_PAYLOAD_TYPE_AUDIO) {
             return RTPQ_RET_HANDLE_NOW;
         }
@@ -645,7 +810,7 @@ int RtpaAddPacket(PRTP_AUDIO_QUEUE queue, PRTP_PACKET packet, uint16_t length) {
     return queueHasPacketReady(queue) ? RTPQ_RET_PACKET_READY : 0;
 }
 
-PRTP_PACKET RtpaGetQueuedPacket(PRTP_AUDIO_QUEUE queue, uint16_t customHeaderLength, uint16_t* length) {
+PRTP_PACKET RtpaGetQueuedPacket(PRTP_AUDIO_QUEUE queue, uint16_t customHeaderLength, uint16_t* length, uint32_t* timestamp) {
     validateFecBlockState(queue);
 
     // If we're returning audio data even with discontinuities, we'll fill in blank entries
@@ -663,8 +828,10 @@ PRTP_PACKET RtpaGetQueuedPacket(PRTP_AUDIO_QUEUE queue, uint16_t customHeaderLen
                 return NULL;
             }
 
-            // Lost packet placeholder entries have no associated data
+            // Lost packet placeholder entries have no associated data, but
+            // still have a timestamp for the audio they are replacing.
             *length = 0;
+            *timestamp = nextBlock->fecHeader.baseTimestamp + (nextBlock->nextDataPacketIndex * AudioPacketDuration);
 
             // Move on to the next data shard
             nextBlock->nextDataPacketIndex++;
@@ -697,6 +864,7 @@ PRTP_PACKET RtpaGetQueuedPacket(PRTP_AUDIO_QUEUE queue, uint16_t customHeaderLen
         }
 
         *length = nextBlock->blockSize + sizeof(RTP_PACKET);
+        *timestamp = nextBlock->dataPackets[nextBlock->nextDataPacketIndex]->timestamp;
         memcpy((uint8_t*)packet + customHeaderLength, nextBlock->dataPackets[nextBlock->nextDataPacketIndex], *length);
         nextBlock->nextDataPacketIndex++;
 
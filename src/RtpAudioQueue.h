@@ -4,9 +4,14 @@
 
 #include "rs.h"
 
-// Maximum time to wait for an OOS data/FEC shard
-// after the entire FEC block should have been received
+#include "RtpReorderEstimator.h"
+#include "RtpReplayWindow.h"
+
+// Time to wait for an OOS data/FEC shard after the entire FEC block
+// should have been received. This is adapted to the measured reorder
+// delay once enough OOS data has been received.
 #define RTPQ_OOS_WAIT_TIME_MS 10
+#define RTPQ_MAX_OOS_WAIT_TIME_MS 50
 
 #define RTPA_DATA_SHARDS 4
 #define RTPA_FEC_SHARDS 2
@@ -15,6 +20,9 @@
 // Maximum number of FEC block entries to cache
 #define RTPA_CACHED_FEC_BLOCK_LIMIT 4
 
+// Number of distinct sets of RTPA_DATA_SHARDS shards we can recover from (6 choose 4)
+#define RTPA_FEC_RECOVERY_PATTERNS 15
+
 typedef struct _AUDIO_FEC_HEADER {
     uint8_t fecShardIndex;
     uint8_t payloadType;
@@ -47,11 +55,23 @@ typedef struct _RTPA_FEC_BLOCK {
     // Data for shards comes here
 } RTPA_FEC_BLOCK, *PRTPA_FEC_BLOCK;
 
+// Precomputed recovery for a single set of surviving shards. Each data shard
+// is a GF(2^8) linear combination of the input shards, with each coefficient
+// stored as low and high nibble multiplication tables.
+typedef struct _RTPA_FEC_RECOVERY {
+    uint8_t inputShards[RTPA_DATA_SHARDS];
+    uint8_t mulLo[RTPA_DATA_SHARDS][RTPA_DATA_SHARDS][16];
+    uint8_t mulHi[RTPA_DATA_SHARDS][RTPA_DATA_SHARDS][16];
+} RTPA_FEC_RECOVERY, *PRTPA_FEC_RECOVERY;
+
 typedef struct _RTP_AUDIO_QUEUE {
     PRTPA_FEC_BLOCK blockHead;
     PRTPA_FEC_BLOCK blockTail;
 
-    reed_solomon* rs;
+    // The shard counts and matrix are constant, so the decode matrix for
+    // every possible loss pattern is inverted once at initialization.
+    RTPA_FEC_RECOVERY fecRecovery[RTPA_FEC_RECOVERY_PATTERNS];
+    int8_t fecRecoveryIndex[1 << RTPA_TOTAL_SHARDS];
 
     PRTPA_FEC_BLOCK freeBlockHead;
     uint16_t freeBlockCount;
@@ -59,6 +79,18 @@ typedef struct _RTP_AUDIO_QUEUE {
     uint16_t nextRtpSequenceNumber;
     uint16_t oldestRtpBaseSequenceNumber;
 
+    RTP_REORDER_ESTIMATOR reorderEstimator;
+    uint32_t oosWaitTimeMs;
+
+    // Duplicate detection for audio data packets. FEC shards are checked
+    // against the marks of their FEC block instead.
+    RTP_REPLAY_WINDOW replayWindow;
+
+    // These are read by other threads for stats
+    uint32_t recoveredPackets;
+    uint32_t oosEvents;
+    uint32_t abandonedBlocks;
+
     uint16_t lastOosSequenceNumber;
     bool receivedOosData;
     bool synchronizing;
@@ -76,4 +108,4 @@ typedef struct _RTP_AUDIO_QUEUE {
 void RtpaInitializeQueue(PRTP_AUDIO_QUEUE queue);
 void RtpaCleanupQueue(PRTP_AUDIO_QUEUE queue);
 int RtpaAddPacket(PRTP_AUDIO_QUEUE queue, PRTP_PACKET packet, uint16_t length);
-PRTP_PACKET RtpaGetQueuedPacket(PRTP_AUDIO_QUEUE queue, uint16_t customHeaderLength, uint16_t* length);
+PRTP_PACKET RtpaGetQueuedPacket(PRTP_AUDIO_QUEUE queue, uint16_t customHeaderLength, uint16_t* length, uint32_t* timestamp);
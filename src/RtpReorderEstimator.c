@@ -0,0 +1,119 @@
+#include "Limelight-internal.h"
+
+// This measures how far (in sequence numbers) and how long (in milliseconds) packets
+// are delayed behind packets that were sent after them. The RTP queues use this to
+// size their waits for reordered packets to what the network actually does, rather
+// than using a fixed wait that is too long on wired networks and too short on Wi-Fi.
+//
+// The delay of a late packet is measured from the arrival of the first packet that
+// overtook it. This requires receive times for recently received packets, so callers
+// that don't provide receive times only get reorder distance measurements.
+
+void RtprInitialize(PRTP_REORDER_ESTIMATOR estimator) {
+    memset(estimator, 0, sizeof(*estimator));
+}
+
+static void addSample(uint32_t* histogram, uint32_t buckets, uint32_t* samples, uint32_t value) {
+    if (*samples >= RTPR_DECAY_SAMPLES) {
+        *samples = 0;
+        for (uint32_t i = 0; i < buckets; i++) {
+            histogram[i] /= 2;
+            *samples += histogram[i];
+        }
+    }
+
+    histogram[value < buckets ? value : buckets - 1]++;
+    (*samples)++;
+}
+
+static uint32_t getPercentile(uint32_t* histogram, uint32_t buckets, uint32_t samples, uint32_t percentile, uint32_t defaultValue) {
+    uint32_t target;
+    uint32_t count;
+
+    LC_ASSERT(percentile <= 100);
+
+    if (samples < RTPR_MIN_SAMPLES) {
+        return defaultValue;
+    }
+
+    // Round up so a percentile above 0 always includes at least one sample
+    target = (samples * percentile + 99) / 100;
+    count = 0;
+    for (uint32_t i = 0; i < buckets; i++) {
+        count += histogram[i];
+        if (count >= target) {
+            return i;
+        }
+    }
+
+    return buckets - 1;
+}
+
+// Returns the reorder distance of this packet, or 0 if it was received in order.
+// Duplicates of recently received packets are ignored. If receiveTimeMs is 0,
+// no reorder delay is measured.
+uint32_t RtprAddPacket(PRTP_REORDER_ESTIMATOR estimator, uint16_t sequenceNumber, uint64_t receiveTimeMs) {
+    uint32_t distance;
+
+    if (!estimator->initialized) {
+        estimator->initialized = true;
+        estimator->highestSequenceNumber = sequenceNumber;
+    }
+    else if (isBefore16(estimator->highestSequenceNumber, sequenceNumber)) {
+        estimator->highestSequenceNumber = sequenceNumber;
+    }
+    else if (sequenceNumber != estimator->highestSequenceNumber) {
+        uint32_t oldestIndex = (estimator->historyIndex - estimator->historyCount) % RTPR_HISTORY_SIZE;
+        uint64_t overtakenTimeMs = 0;
+
+        // Find the earliest received packet that was sent after this one
+        for (uint32_t i = 0; i < estimator->historyCount; i++) {
+            uint32_t index = (oldestIndex + i) % RTPR_HISTORY_SIZE;
+
+            if (estimator->historySequenceNumbers[index] == sequenceNumber) {
+                // This is a duplicate, not a reordered packet
+                return 0;
+            }
+            else if (overtakenTimeMs == 0 && isBefore16(sequenceNumber, estimator->historySequenceNumbers[index])) {
+                overtakenTimeMs = estimator->historyReceiveTimes[index];
+            }
+        }
+
+        distance = U16(estimator->highestSequenceNumber - sequenceNumber);
+        addSample(estimator->distanceHistogram, RTPR_DISTANCE_BUCKETS, &estimator->distanceSamples, distance);
+
+        // If the overtaking packet has fallen out of our history, this is a lower bound
+        if (receiveTimeMs != 0 && overtakenTimeMs != 0) {
+            addSample(estimator->delayHistogram, RTPR_DELAY_BUCKETS, &estimator->delaySamples,
+                      receiveTimeMs > overtakenTimeMs ? (uint32_t)(receiveTimeMs - overtakenTimeMs) : 0);
+        }
+
+        // This is read by other threads for stats
+        PltAtomicStore32(&estimator->reorderedPackets, estimator->reorderedPackets + 1);
+    }
+    else {
+        // A duplicate of the highest packet
+        return 0;
+    }
+
+    estimator->historySequenceNumbers[estimator->historyIndex % RTPR_HISTORY_SIZE] = sequenceNumber;
+    estimator->historyReceiveTimes[estimator->historyIndex % RTPR_HISTORY_SIZE] = receiveTimeMs;
+    estimator->historyIndex++;
+    if (estimator->historyCount < RTPR_HISTORY_SIZE) {
+        estimator->historyCount++;
+    }
+
+    return U16(estimator->highestSequenceNumber - sequenceNumber);
+}
+
+// Returns the reorder delay in ms that the given percentage of reordered packets
+// arrived within, or defaultDelayMs if there isn't enough data yet
+uint32_t RtprGetDelayPercentile(PRTP_REORDER_ESTIMATOR estimator, uint32_t percentile, uint32_t defaultDelayMs) {
+    return getPercentile(estimator->delayHistogram, RTPR_DELAY_BUCKETS, estimator->delaySamples, percentile, defaultDelayMs);
+}
+
+// Returns the reorder distance in packets that the given percentage of reordered
+// packets arrived within, or defaultDistance if there isn't enough data yet
+uint32_t RtprGetDistancePercentile(PRTP_REORDER_ESTIMATOR estimator, uint32_t percentile, uint32_t defaultDistance) {
+    return getPercentile(estimator->distanceHistogram, RTPR_DISTANCE_BUCKETS, estimator->distanceSamples, percentile, defaultDistance);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Platform.h"
+
+// Number of recently received packets remembered to measure how long a late packet was delayed
+#define RTPR_HISTORY_SIZE 64
+
+// Reorder delay (in ms) and distance (in packets) histogram sizes. The last
+// bucket of each histogram collects all samples beyond the range.
+#define RTPR_DELAY_BUCKETS 64
+#define RTPR_DISTANCE_BUCKETS 64
+
+// The histograms are halved once they reach this many samples, so the
+// estimates follow changing network conditions.
+#define RTPR_DECAY_SAMPLES 512
+
+// Percentiles aren't reported until this many reordered packets were seen
+#define RTPR_MIN_SAMPLES 8
+
+// The percentage of reordered packets that the RTP queues try to wait for
+#define RTPR_TARGET_PERCENTILE 99
+
+typedef struct _RTP_REORDER_ESTIMATOR {
+    uint16_t historySequenceNumbers[RTPR_HISTORY_SIZE];
+    uint64_t historyReceiveTimes[RTPR_HISTORY_SIZE];
+    uint32_t historyIndex;
+    uint32_t historyCount;
+
+    uint16_t highestSequenceNumber;
+    bool initialized;
+
+    uint32_t delayHistogram[RTPR_DELAY_BUCKETS];
+    uint32_t delaySamples;
+    uint32_t distanceHistogram[RTPR_DISTANCE_BUCKETS];
+    uint32_t distanceSamples;
+
+    uint32_t reorderedPackets;
+} RTP_REORDER_ESTIMATOR, *PRTP_REORDER_ESTIMATOR;
+
+void RtprInitialize(PRTP_REORDER_ESTIMATOR estimator);
+uint32_t RtprAddPacket(PRTP_REORDER_ESTIMATOR estimator, uint16_t sequenceNumber, uint64_t receiveTimeMs);
+uint32_t RtprGetDelayPercentile(PRTP_REORDER_ESTIMATOR estimator, uint32_t percentile, uint32_t defaultDelayMs);
+uint32_t RtprGetDistancePercentile(PRTP_REORDER_ESTIMATOR estimator, uint32_t percentile, uint32_t defaultDistance);
@@ -0,0 +1,80 @@
+#include "Limelight-internal.h"
+
+// This is a sliding window of received RTP sequence numbers, like the anti-replay
+// window used by IPsec. It rejects duplicated packets in constant time no matter how
+// many packets the RTP queues are holding, whether they were duplicated by the network
+// or resent by the host.
+//
+// The bitmap is a ring indexed by sequence number. When the window advances, the
+// words we move into are cleared, since they hold bits for sequence numbers that
+// are a full window behind. Sequence numbers in the oldest word may already have
+// been recycled, so we only accept packets that are less than a full window
+// (minus one word) behind the highest sequence number.
+
+void RtpwInitialize(PRTP_REPLAY_WINDOW window) {
+    memset(window, 0, sizeof(*window));
+}
+
+// Returns true if this sequence number was already received or is too far behind
+// the highest received sequence number to tell. The window isn't changed, so the
+// caller can validate the rest of the packet before recording it.
+bool RtpwIsDuplicate(PRTP_REPLAY_WINDOW window, uint16_t sequenceNumber) {
+    uint32_t bit = sequenceNumber % RTPW_WINDOW_BITS;
+
+    if (!window->initialized || isBefore16(window->highestSequenceNumber, sequenceNumber)) {
+        return false;
+    }
+
+    if (U16(window->highestSequenceNumber - sequenceNumber) >= RTPW_WINDOW_BITS - 64 ||
+            (window->bitmap[bit / 64] & (1ULL << (bit % 64)))) {
+        // This is read by other threads for stats
+        PltAtomicStore32(&window->rejectedPackets, window->rejectedPackets + 1);
+        return true;
+    }
+
+    return false;
+}
+
+// Records a sequence number that RtpwIsDuplicate() accepted
+void RtpwRecordPacket(PRTP_REPLAY_WINDOW window, uint16_t sequenceNumber) {
+    uint32_t bit = sequenceNumber % RTPW_WINDOW_BITS;
+
+    if (!window->initialized) {
+        window->initialized = true;
+        window->highestSequenceNumber = sequenceNumber;
+    }
+    else if (isBefore16(window->highestSequenceNumber, sequenceNumber)) {
+        // If the new highest sequence number lands in the same word as the old one
+        // after wrapping around the ring, the loop below would clear nothing, so
+        // clear everything for jumps that come within a word of a full window.
+        if (U16(sequenceNumber - window->highestSequenceNumber) >= RTPW_WINDOW_BITS - 64) {
+            memset(window->bitmap, 0, sizeof(window->bitmap));
+        }
+        else {
+            uint32_t word = (window->highestSequenceNumber % RTPW_WINDOW_BITS) / 64;
+
+            // Clear all words up to and including the one for the new highest sequence number
+            while (word != bit / 64) {
+                word = (word + 1) % RTPW_WINDOW_WORDS;
+                window->bitmap[word] = 0;
+            }
+        }
+
+        window->highestSequenceNumber = sequenceNumber;
+    }
+
+    LC_ASSERT(!(window->bitmap[bit / 64] & (1ULL << (bit % 64))));
+    window->bitmap[bit / 64] |= 1ULL << (bit % 64);
+}
+
+// Returns false if this sequence number was already received or is too far behind
+// the highest received sequence number to tell. Otherwise, the sequence number is
+// recorded and true is returned.
+bool RtpwAddPacket(PRTP_REPLAY_WINDOW window, uint16_t sequenceNumber) {
+    if (RtpwIsDuplicate(window, sequenceNumber)) {
+        return false;
+    }
+
+    RtpwRecordPacket(window, sequenceNumber);
+    return true;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Platform.h"
+
+// Number of sequence numbers behind the highest received packet that are
+// tracked. This must divide 65536 evenly so that the bitmap position of a
+// sequence number doesn't change when it wraps around.
+#define RTPW_WINDOW_BITS 2048
+#define RTPW_WINDOW_WORDS (RTPW_WINDOW_BITS / 64)
+
+typedef struct _RTP_REPLAY_WINDOW {
+    uint64_t bitmap[RTPW_WINDOW_WORDS];
+    uint16_t highestSequenceNumber;
+    bool initialized;
+
+    uint32_t rejectedPackets;
+} RTP_REPLAY_WINDOW, *PRTP_REPLAY_WINDOW;
+
+void RtpwInitialize(PRTP_REPLAY_WINDOW window);
+bool RtpwAddPacket(PRTP_REPLAY_WINDOW window, uint16_t sequenceNumber);
+bool RtpwIsDuplicate(PRTP_REPLAY_WINDOW window, uint16_t sequenceNumber);
+void RtpwRecordPacket(PRTP_REPLAY_WINDOW window, uint16_t sequenceNumber);
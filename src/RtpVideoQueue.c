@@ -9,26 +9,57 @@
 #define FEC_VERBOSE
 #endif
 
-// Don't try speculative RFI for 5 minutes after seeing
-// an out of order packet or incorrect prediction
-#define SPECULATIVE_RFI_COOLDOWN_PERIOD_MS 300000
+// Don't try speculative RFI for up to 5 minutes after seeing
+// an out of order packet or incorrect prediction. The actual
+// period scales with the loss prediction false positive rate.
+#define SPECULATIVE_RFI_MIN_COOLDOWN_PERIOD_MS 10000
+#define SPECULATIVE_RFI_MAX_COOLDOWN_PERIOD_MS 300000
+
+// Loss prediction counts are halved after this many predictions
+// to let the false positive rate follow changing network conditions
+#define LOSS_PREDICTION_DECAY_COUNT 256
 
 // RTP packets use a 90 KHz presentation timestamp clock
 #define PTS_DIVISOR 90
 
+// Packets of a frame that arrive within this time of the previous
+// one are considered part of the same burst
+#define PACING_BURST_GAP_US 100
+
+// Pacing sums are halved after this many frames, so the published
+// averages follow changing host and network conditions
+#define PACING_DECAY_SAMPLES 1024
+
+// Limits the FEC blocks being recovered by the FEC worker threads at once.
+// Blocks beyond this are recovered on the receive thread.
+#define MAX_PENDING_FEC_RECOVERIES (RTPV_MAX_FEC_BLOCK_WINDOW * 2)
+
 void RtpvInitializeQueue(PRTP_VIDEO_QUEUE queue) {
     reed_solomon_init();
     memset(queue, 0, sizeof(*queue));
 
     queue->currentFrameNumber = 1;
     queue->multiFecCapable = APP_VERSION_AT_LEAST(7, 1, 431);
+    queue->speculativeRfiCooldownMs = SPECULATIVE_RFI_MAX_COOLDOWN_PERIOD_MS;
+    RtprInitialize(&queue->reorderEstimator);
+    RtpwInitialize(&queue->replayWindow);
+
+    if (StreamConfig.videoReassemblyWindow <= 0) {
+        queue->fecBlockWindow = RTPV_DEFAULT_FEC_BLOCK_WINDOW;
+    }
+    else if (StreamConfig.videoReassemblyWindow > RTPV_MAX_FEC_BLOCK_WINDOW) {
+        queue->fecBlockWindow = RTPV_MAX_FEC_BLOCK_WINDOW;
+    }
+    else {
+        queue->fecBlockWindow = (uint32_t)StreamConfig.videoReassemblyWindow;
+    }
 }
 
 static void purgeListEntries(PRTPV_QUEUE_LIST list) {
     while (list->head != NULL) {
         PRTPV_QUEUE_ENTRY entry = list->head;
         list->head = entry->next;
-        free(entry->packet);
+        free(entry->allocPtr);
     }
 
     list->tail = NULL;
@@ -36,8 +67,16 @@ static void purgeListEntries(PRTPV_QUEUE_LIST list) {
 }
 
 void RtpvCleanupQueue(PRTP_VIDEO_QUEUE queue) {
-    purgeListEntries(&queue->pendingFecBlockList);
+    for (uint32_t i = 0; i < queue->activeFecBlocks; i++) {
+        purgeListEntries(&queue->fecBlocks[i].packetList);
+    }
+    queue->activeFecBlocks = 0;
+
     purgeListEntries(&queue->completedFecBlockList);
+
+    if (queue->reorderedFecBlocksCompleted != 0) {
+        Limelog("Reassembly window recovered %u reordered FEC blocks\n", queue->reorderedFecBlocksCompleted);
+    }
 }
 
 static void insertEntryIntoList(PRTPV_QUEUE_LIST list, PRTPV_QUEUE_ENTRY entry) {
@@ -89,67 +128,187 @@ static void removeEntryFromList(PRTPV_QUEUE_LIST list, PRTPV_QUEUE_ENTRY entry)
     list->count--;
 }
 
-static void reportFinalFrameFecStatus(PRTP_VIDEO_QUEUE queue) {
+static void reportFinalFrameFecStatus(PRTPV_FEC_BLOCK block) {
     SS_FRAME_FEC_STATUS fecStatus;
     
-    fecStatus.frameIndex = BE32(queue->currentFrameNumber);
-    fecStatus.highestReceivedSequenceNumber = BE16(queue->receivedHighestSequenceNumber);
-    fecStatus.nextContiguousSequenceNumber = BE16(queue->nextContiguousSequenceNumber);
-    fecStatus.missingPacketsBeforeHighestReceived = BE16(queue->missingPackets);
-    fecStatus.totalDataPackets = BE16(queue->bufferDataPackets);
-    fecStatus.totalParityPackets = BE16(queue->bufferParityPackets);
-    fecStatus.receivedDataPackets = BE16(queue->receivedDataPackets);
-    fecStatus.receivedParityPackets = BE16(queue->receivedParityPackets);
-    fecStatus.fecPercentage = (uint8_t)queue->fecPercentage;
-    fecStatus.multiFecBlockIndex = (uint8_t)queue->multiFecCurrentBlockNumber;
-    fecStatus.multiFecBlockCount = (uint8_t)(queue->multiFecLastBlockNumber + 1);
+    fecStatus.frameIndex = BE32(block->frameNumber);
+    fecStatus.highestReceivedSequenceNumber = BE16(block->receivedHighestSequenceNumber);
+    fecStatus.nextContiguousSequenceNumber = BE16(block->nextContiguousSequenceNumber);
+    fecStatus.missingPacketsBeforeHighestReceived = BE16(block->missingPackets);
+    fecStatus.totalDataPackets = BE16(block->dataPackets);
+    fecStatus.totalParityPackets = BE16(block->parityPackets);
+    fecStatus.receivedDataPackets = BE16(block->receivedDataPackets);
+    fecStatus.receivedParityPackets = BE16(block->receivedParityPackets);
+    fecStatus.fecPercentage = (uint8_t)block->fecPercentage;
+    fecStatus.multiFecBlockIndex = block->blockNumber;
+    fecStatus.multiFecBlockCount = (uint8_t)(block->lastBlockNumber + 1);
     
     connectionSendFrameFecStatus(&fecStatus);
 }
 
-// newEntry is contained within the packet buffer so we free the whole entry by freeing entry->packet
-static bool queuePacket(PRTP_VIDEO_QUEUE queue, PRTPV_QUEUE_ENTRY newEntry, PRTP_PACKET packet, int length, bool isParity, bool isFecRecovery) {
-    PRTPV_QUEUE_ENTRY entry;
+static uint32_t pacingAverage(uint64_t sum, uint32_t samples) {
+    return samples != 0 ? (uint32_t)(sum / samples) : 0;
+}
+
+// Folds the arrival timing of a frame that we've stopped receiving packets for into the pacing stats
+static void finishFrameArrival(PRTP_VIDEO_QUEUE queue) {
+    PRTPV_FRAME_ARRIVAL arrival = &queue->frameArrival;
+    PRTPV_FRAME_ARRIVAL lastArrival = &queue->lastFrameArrival;
+    PVIDEO_PACING_STATS stats = &queue->pacingStats;
+    uint64_t spreadUs = arrival->lastPacketTimeUs - arrival->firstPacketTimeUs;
+
+    LC_ASSERT(arrival->packets != 0);
+
+    if (queue->pacingSamples >= PACING_DECAY_SAMPLES) {
+        queue->pacingSamples /= 2;
+        queue->pacingSpreadSumUs /= 2;
+        queue->pacingMaxGapSumUs /= 2;
+        queue->pacingMaxBurstSum /= 2;
+    }
+    queue->pacingSamples++;
+    queue->pacingSpreadSumUs += spreadUs;
+    queue->pacingMaxGapSumUs += arrival->maxPacketGapUs;
+    queue->pacingMaxBurstSum += arrival->maxBurstPackets;
+
+    // Compare the arrival interval against the presentation interval of the previous frame
+    if (lastArrival->packets != 0 && arrival->presentationTimeMs > lastArrival->presentationTimeMs) {
+        int64_t arrivalIntervalUs = (int64_t)(arrival->firstPacketTimeUs - lastArrival->firstPacketTimeUs);
+        int64_t presentationIntervalUs = (int64_t)(arrival->presentationTimeMs - lastArrival->presentationTimeMs) * 1000;
+        int64_t jitterUs = arrivalIntervalUs - presentationIntervalUs;
+
+        if (queue->pacingJitterSamples >= PACING_DECAY_SAMPLES) {
+            queue->pacingJitterSamples /= 2;
+            queue->pacingJitterSumUs /= 2;
+        }
+        queue->pacingJitterSamples++;
+        queue->pacingJitterSumUs += (uint64_t)(jitterUs < 0 ? -jitterUs : jitterUs);
+    }
+
+    // These are read by other threads for stats
+    PltAtomicStore32(&stats->framesAnalyzed, stats->framesAnalyzed + 1);
+    PltAtomicStore32(&stats->avgFrameSpreadUs, pacingAverage(queue->pacingSpreadSumUs, queue->pacingSamples));
+    if (spreadUs > stats->maxFrameSpreadUs) {
+        PltAtomicStore32(&stats->maxFrameSpreadUs, spreadUs > UINT32_MAX ? UINT32_MAX : (uint32_t)spreadUs);
+    }
+    PltAtomicStore32(&stats->avgMaxPacketGapUs, pacingAverage(queue->pacingMaxGapSumUs, queue->pacingSamples));
+    PltAtomicStore32(&stats->avgMaxBurstPackets, pacingAverage(queue->pacingMaxBurstSum, queue->pacingSamples));
+    if (arrival->maxBurstPackets > stats->maxBurstPackets) {
+        PltAtomicStore32(&stats->maxBurstPackets, arrival->maxBurstPackets);
+    }
+    PltAtomicStore32(&stats->avgArrivalJitterUs, pacingAverage(queue->pacingJitterSumUs, queue->pacingJitterSamples));
+
+    *lastArrival = *arrival;
+}
+
+static void recordFecRecoveredFrameArrival(PRTP_VIDEO_QUEUE queue, PRTPV_FRAME_ARRIVAL arrival) {
+    PVIDEO_PACING_STATS stats = &queue->pacingStats;
+
+    if (arrival->fecRecovered) {
+        return;
+    }
+    arrival->fecRecovered = true;
+
+    if (queue->pacingFecRecoveredSamples >= PACING_DECAY_SAMPLES) {
+        queue->pacingFecRecoveredSamples /= 2;
+        queue->pacingFecRecoveredMaxBurstSum /= 2;
+    }
+    queue->pacingFecRecoveredSamples++;
+    queue->pacingFecRecoveredMaxBurstSum += arrival->maxBurstPackets;
+
+    // These are read by other threads for stats
+    PltAtomicStore32(&stats->fecRecoveredFrames, stats->fecRecoveredFrames + 1);
+    PltAtomicStore32(&stats->fecRecoveredAvgMaxBurstPackets,
+                     pacingAverage(queue->pacingFecRecoveredMaxBurstSum, queue->pacingFecRecoveredSamples));
+}
+
+// Correlates FEC recovery with the arrival timing of the frame. Recovery
+// normally happens before the next frame's packets arrive, but we can also
+// attribute it to the previous frame.
+static void noteFrameFecRecovered(PRTP_VIDEO_QUEUE queue, uint32_t frameNumber) {
+    if (queue->frameArrival.packets != 0 && queue->frameArrival.frameNumber == frameNumber) {
+        recordFecRecoveredFrameArrival(queue, &queue->frameArrival);
+    }
+    else if (queue->lastFrameArrival.packets != 0 && queue->lastFrameArrival.frameNumber == frameNumber) {
+        recordFecRecoveredFrameArrival(queue, &queue->lastFrameArrival);
+    }
+}
+
+// Tracks packet arrival times at frame boundaries to distinguish host send
+// pacing and encode time from network effects. Packets are attributed to the
+// newest frame we've seen, and stragglers from earlier frames are ignored.
+static void trackFrameArrival(PRTP_VIDEO_QUEUE queue, uint32_t frameNumber, uint32_t presentationTimeMs, uint64_t receiveTimeUs) {
+    PRTPV_FRAME_ARRIVAL arrival = &queue->frameArrival;
+
+    if (arrival->packets == 0 || isBefore16(arrival->frameNumber, frameNumber)) {
+        if (arrival->packets != 0) {
+            finishFrameArrival(queue);
+        }
+
+        memset(arrival, 0, sizeof(*arrival));
+        arrival->frameNumber = frameNumber;
+        arrival->presentationTimeMs = presentationTimeMs;
+        arrival->firstPacketTimeUs = receiveTimeUs;
+        arrival->lastPacketTimeUs = receiveTimeUs;
+        arrival->packets = 1;
+        arrival->burstPackets = 1;
+        arrival->maxBurstPackets = 1;
+    }
+    else if (arrival->frameNumber == frameNumber) {
+        uint64_t gapUs = receiveTimeUs > arrival->lastPacketTimeUs ? receiveTimeUs - arrival->lastPacketTimeUs : 0;
+
+        if (gapUs > arrival->maxPacketGapUs) {
+            arrival->maxPacketGapUs = gapUs > UINT32_MAX ? UINT32_MAX : (uint32_t)gapUs;
+        }
+
+        if (gapUs <= PACING_BURST_GAP_US) {
+            arrival->burstPackets++;
+            if (arrival->burstPackets > arrival->maxBurstPackets) {
+                arrival->maxBurstPackets = arrival->burstPackets;
+            }
+        }
+        else {
+            arrival->burstPackets = 1;
+        }
+
+        arrival->lastPacketTimeUs = receiveTimeUs;
+        arrival->packets++;
+    }
+}
+
+// newEntry is contained within the packet buffer so we free the whole entry by freeing entry->allocPtr.
+// The packet may not be at the start of the buffer if a header was stripped by pointer offset.
+static void queuePacket(PRTP_VIDEO_QUEUE queue, PRTPV_FEC_BLOCK block, PRTPV_QUEUE_ENTRY newEntry, void* allocPtr, PRTP_PACKET packet, int length, bool isParity, bool isFecRecovery, uint64_t receiveTimeUs) {
     bool outOfSequence;
     
     LC_ASSERT(!(isFecRecovery && isParity));
-    LC_ASSERT(!isBefore16(packet->sequenceNumber, queue->nextContiguousSequenceNumber));
+    LC_ASSERT(!isBefore16(packet->sequenceNumber, block->lowestSequenceNumber));
 
-    // If the packet is in order, we can take the fast path and avoid having
-    // to loop through the whole list. If we get an out of order or missing
-    // packet, the fast path will stop working and we'll use the loop instead.
+    // Duplicate packets were already rejected by our replay window, so a packet
+    // is out of order if we've already received a later packet of this FEC block.
     //
     // NB: It's not enough to just check next contiguous sequence number because
     // it's possible that we hit the OOS path earlier which doesn't update the
-    // next contiguous sequence number. If that happens, we need to use the slow
-    // path for this entire frame to avoid possibly mishandling a duplicate packet.
-    if (queue->useFastQueuePath && packet->sequenceNumber == queue->nextContiguousSequenceNumber) {
-        queue->nextContiguousSequenceNumber = U16(packet->sequenceNumber + 1);
+    // next contiguous sequence number.
+    if (block->useFastQueuePath && packet->sequenceNumber == block->nextContiguousSequenceNumber) {
+        block->nextContiguousSequenceNumber = U16(packet->sequenceNumber + 1);
         outOfSequence = false;
     }
     else {
-        outOfSequence = false;
+        outOfSequence = block->packetList.count != 0 &&
+                        isBefore16(packet->sequenceNumber, block->receivedHighestSequenceNumber);
 
-        // Check for duplicates
-        entry = queue->pendingFecBlockList.head;
-        while (entry != NULL) {
-            if (packet->sequenceNumber == entry->packet->sequenceNumber) {
-                return false;
-            }
-            else if (isBefore16(packet->sequenceNumber, entry->packet->sequenceNumber)) {
-                outOfSequence = true;
-            }
-
-            entry = entry->next;
-        }
+        // Stop using the fast queue path for this FEC block because we're about
+        // to queue a packet out of order. This will not update nextContiguousSequenceNumber.
+        block->useFastQueuePath = false;
+    }
 
-        // If we make it here, we cannot use the fast queue path for this frame because
-        // we're about to queue a non-duplicate packet out of order. This will not update
-        // nextContiguousSequenceNumber which the fast path relies on.
-        queue->useFastQueuePath = false;
+    // A packet for a FEC block that arrives after data for a later FEC block is also out of order
+    if (block != &queue->fecBlocks[queue->activeFecBlocks - 1]) {
+        outOfSequence = true;
     }
 
     newEntry->packet = packet;
+    newEntry->allocPtr = allocPtr;
     newEntry->length = length;
     newEntry->isParity = isParity;
     newEntry->prev = NULL;
@@ -158,104 +317,73 @@ static bool queuePacket(PRTP_VIDEO_QUEUE queue, PRTPV_QUEUE_ENTRY newEntry, PRTP
 
     // FEC recovery packets are synthesized by us, so don't use them to determine OOS data
     if (!isFecRecovery) {
-        if (outOfSequence) {
-            // This packet was received after a higher sequence number packet, so note that we
-            // received an out of order packet to disable our speculative RFI recovery logic.
+        uint32_t reorderDistance = RtprAddPacket(&queue->reorderEstimator, packet->sequenceNumber, receiveTimeUs / 1000);
+
+        if (outOfSequence && reorderDistance > queue->reorderTolerance) {
+            // This packet was received after a higher sequence number packet, and further behind
+            // than we expected, so note that we received an out of order packet to disable our
+            // speculative RFI recovery logic.
             queue->lastOosFramePresentationTimestamp = newEntry->presentationTimeMs;
             if (!queue->receivedOosData) {
-                Limelog("Leaving speculative RFI mode after OOS video data at frame %u\n",
-                        queue->currentFrameNumber);
+                Limelog("Leaving speculative RFI mode after OOS video data at frame %u (reordered by %u packets)\n",
+                        block->frameNumber, reorderDistance);
                 queue->receivedOosData = true;
             }
         }
-        else if (queue->receivedOosData && newEntry->presentationTimeMs > queue->lastOosFramePresentationTimestamp + SPECULATIVE_RFI_COOLDOWN_PERIOD_MS) {
-            Limelog("Entering speculative RFI mode after sequenced video data at frame %u\n",
-                    queue->currentFrameNumber);
+        else if (queue->receivedOosData && newEntry->presentationTimeMs > queue->lastOosFramePresentationTimestamp + queue->speculativeRfiCooldownMs) {
+            Limelog("Entering speculative RFI mode after sequenced video data at frame %u (tolerating reordering by %u packets)\n",
+                    block->frameNumber, queue->reorderTolerance);
             queue->receivedOosData = false;
         }
+
+        if (reorderDistance != 0) {
+            // This is read by other threads for stats
+            PltAtomicStore32(&queue->reorderTolerance,
+                             RtprGetDistancePercentile(&queue->reorderEstimator, RTPR_TARGET_PERCENTILE, 0));
+        }
     }
 
-    insertEntryIntoList(&queue->pendingFecBlockList, newEntry);
+    insertEntryIntoList(&block->packetList, newEntry);
+}
 
-    return true;
+// Scales the speculative RFI cooldown period by the loss prediction false positive rate
+static void updateSpeculativeRfiCooldown(PRTP_VIDEO_QUEUE queue) {
+    uint32_t cooldownMs;
+
+    LC_ASSERT(queue->lossPredictionFalsePositives <= queue->lossPredictions);
+
+    if (queue->lossPredictions >= LOSS_PREDICTION_DECAY_COUNT) {
+        queue->lossPredictions /= 2;
+        queue->lossPredictionFalsePositives /= 2;
+    }
+
+    // With no predictions to judge by, this is the maximum cooldown period
+    cooldownMs = (uint32_t)(((uint64_t)SPECULATIVE_RFI_MAX_COOLDOWN_PERIOD_MS * (queue->lossPredictionFalsePositives + 1)) /
+                            (queue->lossPredictions + 1));
+    if (cooldownMs < SPECULATIVE_RFI_MIN_COOLDOWN_PERIOD_MS) {
+        cooldownMs = SPECULATIVE_RFI_MIN_COOLDOWN_PERIOD_MS;
+    }
+    else if (cooldownMs > SPECULATIVE_RFI_MAX_COOLDOWN_PERIOD_MS) {
+        cooldownMs = SPECULATIVE_RFI_MAX_COOLDOWN_PERIOD_MS;
+    }
+
+    queue->speculativeRfiCooldownMs = cooldownMs;
 }
 
 #define PACKET_RECOVERY_FAILURE()                     \
     ret = -1;                                         \
     Limelog("FEC recovery returned corrupt packet %d" \
             " (frame %d)", rtpPacket->sequenceNumber, \
-            queue->currentFrameNumber);               \
+            block->frameNumber);                      \
     free(packets[i]);                                 \
     continue
 
-// Returns 0 if the frame is completely constructed
-static int reconstructFrame(PRTP_VIDEO_QUEUE queue) {
-    unsigned int totalPackets = queue->bufferDataPackets + queue->bufferParityPackets;
-    unsigned int neededPackets = queue->bufferDataPackets;
+// Recovers the missing data packets of an FEC block into recoveredList. This doesn't
+// modify the FEC block or any queue state, so it can run on an FEC worker thread.
+static int recoverFecBlockPackets(PRTPV_FEC_BLOCK block, bool multiFecCapable, PRTPV_QUEUE_LIST recoveredList) {
+    unsigned int totalPackets = block->dataPackets + block->parityPackets;
     int ret;
 
-    LC_ASSERT(totalPackets == U16(queue->bufferHighestSequenceNumber - queue->bufferLowestSequenceNumber) + 1U);
-    
-#ifdef FEC_VALIDATION_MODE
-    // We'll need an extra packet to run in FEC validation mode, because we will
-    // be "dropping" one below and recovering it using parity. However, some frames
-    // are so large that FEC is disabled entirely, so don't wait for parity on those.
-    neededPackets += queue->fecPercentage ? 1 : 0;
-#endif
-
-    LC_ASSERT(totalPackets - neededPackets <= queue->bufferParityPackets);
-
-    if (queue->pendingFecBlockList.count < neededPackets) {
-        // If we've never received OOS data from this host, we can predict whether this frame will be recoverable
-        // based on the packets we've received (or not) so far. If the number of missing shards exceeds the total
-        // needed shards, there is no hope of recovering the data. The only way we could recover this frame is by
-        // receiving OOS data, which is unlikely because we've not seen any recently from this host.
-        if (!queue->reportedLostFrame && !queue->receivedOosData) {
-            // NB: We use totalPackets - neededPackets instead of just bufferParityPackets here because we require
-            // one extra parity shard for recovery if we're in FEC validation mode.
-            if (queue->missingPackets > totalPackets - neededPackets) {
-                notifyFrameLost(queue->currentFrameNumber, true);
-                queue->reportedLostFrame = true;
-            }
-            else {
-                // Assert that there are enough remaining packets to possibly recover this frame.
-                LC_ASSERT(neededPackets - queue->pendingFecBlockList.count <= U16(queue->bufferHighestSequenceNumber - queue->receivedHighestSequenceNumber));
-            }
-        }
-
-        // Not enough data to recover yet
-        return -1;
-    }
-
-    // If we make it here and reported a lost frame, we lied to the host. This can happen if we happen to get
-    // unlucky and this particular frame happens to be the one with OOS data, but it should almost never happen.
-    LC_ASSERT(queue->missingPackets <= queue->bufferParityPackets);
-    LC_ASSERT(!queue->reportedLostFrame || queue->receivedOosData);
-    if (queue->reportedLostFrame && !queue->receivedOosData) {
-        // If it turns out that we lied to the host, stop further speculative RFI requests for a while.
-        queue->receivedOosData = true;
-        queue->lastOosFramePresentationTimestamp = queue->pendingFecBlockList.head->presentationTimeMs;
-        Limelog("Leaving speculative RFI mode due to incorrect loss prediction of frame %u\n", queue->currentFrameNumber);
-    }
-
-#ifdef FEC_VALIDATION_MODE
-    // If FEC is disabled or unsupported for this frame, we must bail early here.
-    if ((queue->fecPercentage == 0 || AppVersionQuad[0] < 5) &&
-            queue->receivedDataPackets == queue->bufferDataPackets) {
-#else
-    if (queue->receivedDataPackets == queue->bufferDataPackets) {
-#endif
-        // We've received a full frame with no need for FEC.
-        return 0;
-    }
-
-    if (AppVersionQuad[0] < 5) {
-        // Our FEC recovery code doesn't work properly until Gen 5
-        Limelog("FEC recovery not supported on Gen %d servers\n",
-                AppVersionQuad[0]);
-        return -1;
-    }
-
     reed_solomon* rs = NULL;
     unsigned char** packets = calloc(totalPackets, sizeof(unsigned char*));
     unsigned char* marks = calloc(totalPackets, sizeof(unsigned char));
@@ -264,7 +392,7 @@ static int reconstructFrame(PRTP_VIDEO_QUEUE queue) {
         goto cleanup;
     }
     
-    rs = reed_solomon_new(queue->bufferDataPackets, queue->bufferParityPackets);
+    rs = reed_solomon_new(block->dataPackets, block->parityPackets);
     
     // This could happen in an OOM condition, but it could also mean the FEC data
     // that we fed to reed_solomon_new() is bogus, so we'll assert to get a better look.
@@ -281,14 +409,14 @@ static int reconstructFrame(PRTP_VIDEO_QUEUE queue) {
 
 #ifdef FEC_VALIDATION_MODE
     // Choose a packet to drop
-    unsigned int dropIndex = rand() % queue->bufferDataPackets;
+    unsigned int dropIndex = rand() % block->dataPackets;
     PRTP_PACKET droppedRtpPacket = NULL;
     int droppedRtpPacketLength = 0;
 #endif
 
-    PRTPV_QUEUE_ENTRY entry = queue->pendingFecBlockList.head;
+    PRTPV_QUEUE_ENTRY entry = block->packetList.head;
     while (entry != NULL) {
-        unsigned int index = U16(entry->packet->sequenceNumber - queue->bufferLowestSequenceNumber);
+        unsigned int index = U16(entry->packet->sequenceNumber - block->lowestSequenceNumber);
 
 #ifdef FEC_VALIDATION_MODE
         if (index == dropIndex) {
@@ -333,28 +461,17 @@ static int reconstructFrame(PRTP_VIDEO_QUEUE queue) {
     // If this fails, something is probably wrong with our FEC state.
     LC_ASSERT(ret == 0);
 
-    if (queue->bufferDataPackets != queue->receivedDataPackets) {
-#ifdef FEC_VERBOSE
-        Limelog("Recovered %d video data shards from frame %d\n",
-                queue->bufferDataPackets - queue->receivedDataPackets,
-                queue->currentFrameNumber);
-#endif
-        
-        // Report the final FEC status if we needed to perform a recovery
-        reportFinalFrameFecStatus(queue);
-    }
-
 cleanup_packets:
     for (i = 0; i < totalPackets; i++) {
         if (marks[i]) {
             // Only submit frame data, not FEC packets
-            if (ret == 0 && i < queue->bufferDataPackets) {
+            if (ret == 0 && i < block->dataPackets) {
                 PRTPV_QUEUE_ENTRY queueEntry = (PRTPV_QUEUE_ENTRY)&packets[i][receiveSize];
                 PRTP_PACKET rtpPacket = (PRTP_PACKET) packets[i];
-                rtpPacket->sequenceNumber = U16(i + queue->bufferLowestSequenceNumber);
-                rtpPacket->header = queue->pendingFecBlockList.head->packet->header;
-                rtpPacket->timestamp = queue->pendingFecBlockList.head->packet->timestamp;
-                rtpPacket->ssrc = queue->pendingFecBlockList.head->packet->ssrc;
+                rtpPacket->sequenceNumber = U16(i + block->lowestSequenceNumber);
+                rtpPacket->header = block->packetList.head->packet->header;
+                rtpPacket->timestamp = block->packetList.head->packet->timestamp;
+                rtpPacket->ssrc = block->packetList.head->packet->ssrc;
                 
                 int dataOffset = sizeof(*rtpPacket);
                 if (rtpPacket->header & FLAG_EXTENSION) {
@@ -362,9 +479,9 @@ cleanup_packets:
                 }
 
                 PNV_VIDEO_PACKET nvPacket = (PNV_VIDEO_PACKET)(((char*)rtpPacket) + dataOffset);
-                nvPacket->frameIndex = queue->currentFrameNumber;
+                nvPacket->frameIndex = block->frameNumber;
                 nvPacket->multiFecBlocks =
-                        ((queue->multiFecLastBlockNumber << 2) | queue->multiFecCurrentBlockNumber) << 4;
+                        ((block->lastBlockNumber << 2) | block->blockNumber) << 4;
                 // TODO: nvPacket->multiFecFlags?
 
 #ifdef FEC_VALIDATION_MODE
@@ -384,7 +501,7 @@ cleanup_packets:
                     LC_ASSERT_VT(nvPacket->frameIndex == droppedNvPacket->frameIndex);
                     LC_ASSERT_VT(nvPacket->streamPacketIndex == droppedNvPacket->streamPacketIndex);
                     LC_ASSERT_VT(nvPacket->reserved == droppedNvPacket->reserved);
-                    LC_ASSERT_VT(!queue->multiFecCapable || nvPacket->multiFecBlocks == droppedNvPacket->multiFecBlocks);
+                    LC_ASSERT_VT(!multiFecCapable || nvPacket->multiFecBlocks == droppedNvPacket->multiFecBlocks);
 
                     // Check the data itself - use memcmp() and only loop if an error is detected
                     if (memcmp(nvPacket + 1, droppedNvPacket + 1, droppedDataLength)) {
@@ -426,10 +543,10 @@ cleanup_packets:
                 if (i == 0 && !(nvPacket->flags & FLAG_SOF)) {
                     PACKET_RECOVERY_FAILURE();
                 }
-                if (i == queue->bufferDataPackets - 1 && !(nvPacket->flags & FLAG_EOF)) {
+                if (i == block->dataPackets - 1 && !(nvPacket->flags & FLAG_EOF)) {
                     PACKET_RECOVERY_FAILURE();
                 }
-                if (i > 0 && i < queue->bufferDataPackets - 1 && !(nvPacket->flags & FLAG_CONTAINS_PIC_DATA)) {
+                if (i > 0 && i < block->dataPackets - 1 && !(nvPacket->flags & FLAG_CONTAINS_PIC_DATA)) {
                     PACKET_RECOVERY_FAILURE();
                 }
                 if (nvPacket->flags & ~(FLAG_SOF | FLAG_EOF | FLAG_CONTAINS_PIC_DATA)) {
@@ -441,14 +558,25 @@ cleanup_packets:
                 // discarded by decoders. It's not safe to strip all zero padding because
                 // it may be a legitimate part of the H.264 bytestream.
 
-                LC_ASSERT(isBefore16(rtpPacket->sequenceNumber, queue->bufferFirstParitySequenceNumber));
-                queuePacket(queue, queueEntry, rtpPacket, StreamConfig.packetSize + dataOffset, false, true);
+                LC_ASSERT(isBefore16(rtpPacket->sequenceNumber, block->firstParitySequenceNumber));
+                queueEntry->packet = rtpPacket;
+                queueEntry->allocPtr = packets[i];
+                queueEntry->length = StreamConfig.packetSize + dataOffset;
+                queueEntry->prev = NULL;
+                queueEntry->next = NULL;
+                insertEntryIntoList(recoveredList, queueEntry);
             } else if (packets[i] != NULL) {
                 free(packets[i]);
             }
         }
     }
 
+    // Don't return a partial recovery, since the FEC block would be left with packets
+    // that may collide with the real ones if we receive them later
+    if (ret != 0) {
+        purgeListEntries(recoveredList);
+    }
+
 cleanup:
     reed_solomon_release(rs);
 
@@ -461,11 +589,194 @@ cleanup:
     return ret;
 }
 
-static void stageCompleteFecBlock(PRTP_VIDEO_QUEUE queue) {
-    unsigned int nextSeqNum = queue->bufferLowestSequenceNumber;
+// Queues the packets recovered by recoverFecBlockPackets() into the FEC block
+static void finishFecBlockRecovery(PRTP_VIDEO_QUEUE queue, PRTPV_FEC_BLOCK block, PRTPV_QUEUE_LIST recoveredList, int ret) {
+    if (ret == 0 && block->dataPackets != block->receivedDataPackets) {
+#ifdef FEC_VERBOSE
+        Limelog("Recovered %d video data shards from frame %d\n",
+                block->dataPackets - block->receivedDataPackets,
+                block->frameNumber);
+#endif
+
+        // Report the final FEC status if we needed to perform a recovery
+        reportFinalFrameFecStatus(block);
+        noteFrameFecRecovered(queue, block->frameNumber);
+    }
+
+    while (recoveredList->head != NULL) {
+        PRTPV_QUEUE_ENTRY entry = recoveredList->head;
+
+        removeEntryFromList(recoveredList, entry);
+        queuePacket(queue, block, entry, entry->allocPtr, entry->packet, entry->length, false, true, 0);
+    }
+}
+
+static void freeFecRecoveryJob(PRTPV_FEC_RECOVERY_JOB job) {
+    purgeListEntries(&job->block.packetList);
+    purgeListEntries(&job->recoveredList);
+    free(job);
+}
+
+// Hands an FEC block that needs recovery to an FEC worker thread. The job takes
+// ownership of the received packets until the recovery is completed.
+static bool dispatchFecBlockRecovery(PRTP_VIDEO_QUEUE queue, PRTPV_FEC_BLOCK block) {
+    PRTPV_FEC_RECOVERY_JOB job;
+    uint32_t worker;
+
+    // Bounding the outstanding recoveries ensures the workers can always return them
+    if (queue->pendingFecRecoveries >= MAX_PENDING_FEC_RECOVERIES) {
+        return false;
+    }
+
+    job = malloc(sizeof(*job));
+    if (job == NULL) {
+        return false;
+    }
+
+    job->block = *block;
+    memset(&job->recoveredList, 0, sizeof(job->recoveredList));
+    job->recoveryId = ++queue->nextRecoveryId;
+    job->multiFecCapable = queue->multiFecCapable;
+
+    worker = queue->nextFecWorker++ % queue->fecWorkerCount;
+    if (LbqOfferQueueItem(&queue->fecWorkers[worker].jobQueue, job, &job->lentry) != LBQ_SUCCESS) {
+        free(job);
+        return false;
+    }
+
+    memset(&block->packetList, 0, sizeof(block->packetList));
+    block->recoveryId = job->recoveryId;
+    block->recovering = true;
+    queue->pendingFecRecoveries++;
+    return true;
+}
+
+// Returns the number of missing packets of the FEC block that are further behind the
+// highest received packet than our reorder tolerance. Missing packets closer to it may
+// still arrive, so they don't count as lost yet.
+static uint32_t countLostPackets(PRTP_VIDEO_QUEUE queue, PRTPV_FEC_BLOCK block) {
+    uint32_t tolerance = queue->reorderTolerance;
+    uint32_t recentMissingPackets;
+
+    // Only sequence numbers within this FEC block can be missing
+    if (tolerance > U16(block->receivedHighestSequenceNumber - block->lowestSequenceNumber)) {
+        tolerance = U16(block->receivedHighestSequenceNumber - block->lowestSequenceNumber);
+    }
+
+    recentMissingPackets = tolerance;
+    for (PRTPV_QUEUE_ENTRY entry = block->packetList.head; entry != NULL; entry = entry->next) {
+        uint32_t distance = U16(block->receivedHighestSequenceNumber - entry->packet->sequenceNumber);
+
+        if (distance != 0 && distance <= tolerance) {
+            recentMissingPackets--;
+        }
+    }
+
+    LC_ASSERT(recentMissingPackets <= block->missingPackets);
+    return block->missingPackets - recentMissingPackets;
+}
+
+// Returns 0 if the FEC block is completely constructed, or 1 if it will be completed
+// after recovery on an FEC worker thread
+static int reconstructFecBlock(PRTP_VIDEO_QUEUE queue, PRTPV_FEC_BLOCK block) {
+    unsigned int totalPackets = block->dataPackets + block->parityPackets;
+    unsigned int neededPackets = block->dataPackets;
+    int ret;
+
+    LC_ASSERT(totalPackets == U16(block->highestSequenceNumber - block->lowestSequenceNumber) + 1U);
+    
+#ifdef FEC_VALIDATION_MODE
+    // We'll need an extra packet to run in FEC validation mode, because we will
+    // be "dropping" one below and recovering it using parity. However, some frames
+    // are so large that FEC is disabled entirely, so don't wait for parity on those.
+    neededPackets += block->fecPercentage ? 1 : 0;
+#endif
+
+    LC_ASSERT(totalPackets - neededPackets <= block->parityPackets);
+
+    if (block->packetList.count < neededPackets) {
+        // We can predict whether this FEC block will be recoverable based on the packets we've received (or not)
+        // so far. If the number of missing shards exceeds the available parity shards, there is no hope of
+        // recovering the data. The only way we could recover it is by receiving OOS data.
+        //
+        // NB: We use totalPackets - neededPackets instead of just bufferParityPackets here because we require
+        // one extra parity shard for recovery if we're in FEC validation mode.
+        //
+        // Missing packets within our reorder tolerance of the highest received packet may still arrive,
+        // so only the ones further behind it count against the parity shards.
+        if (block->missingPackets > totalPackets - neededPackets &&
+                countLostPackets(queue, block) > totalPackets - neededPackets) {
+            if (!block->predictedLoss) {
+                block->predictedLoss = true;
+                queue->lossPredictions++;
+            }
+        }
+        else if (block->missingPackets <= totalPackets - neededPackets) {
+            // Assert that there are enough remaining packets to possibly recover this frame.
+            LC_ASSERT(neededPackets - block->packetList.count <= U16(block->highestSequenceNumber - block->receivedHighestSequenceNumber));
+        }
+
+        // Not enough data to recover yet
+        return -1;
+    }
+
+    // If we make it here and predicted a lost frame, the prediction was wrong. This can happen if we happen to get
+    // unlucky and this particular frame happens to be the one with OOS data, but it should almost never happen.
+    LC_ASSERT(block->missingPackets <= block->parityPackets);
+    LC_ASSERT(!block->predictedLoss || queue->receivedOosData);
+    if (block->predictedLoss) {
+        block->predictedLoss = false;
+        queue->lossPredictionFalsePositives++;
+        updateSpeculativeRfiCooldown(queue);
+
+        Limelog("Incorrect loss prediction of frame %u (%u of %u predictions incorrect)\n",
+                block->frameNumber, queue->lossPredictionFalsePositives, queue->lossPredictions);
+
+        if (block->reportedLoss && !queue->receivedOosData) {
+            // If it turns out that we lied to the host, stop further speculative RFI requests for a while.
+            queue->receivedOosData = true;
+            queue->lastOosFramePresentationTimestamp = block->packetList.head->presentationTimeMs;
+            Limelog("Leaving speculative RFI mode for %u ms due to incorrect loss prediction of frame %u\n",
+                    queue->speculativeRfiCooldownMs, block->frameNumber);
+        }
+    }
+
+#ifdef FEC_VALIDATION_MODE
+    // If FEC is disabled or unsupported for this frame, we must bail early here.
+    if ((block->fecPercentage == 0 || AppVersionQuad[0] < 5) &&
+            block->receivedDataPackets == block->dataPackets) {
+#else
+    if (block->receivedDataPackets == block->dataPackets) {
+#endif
+        // We've received a full frame with no need for FEC.
+        return 0;
+    }
+
+    if (AppVersionQuad[0] < 5) {
+        // Our FEC recovery code doesn't work properly until Gen 5
+        Limelog("FEC recovery not supported on Gen %d servers\n",
+                AppVersionQuad[0]);
+        return -1;
+    }
+
+    // Recover the FEC blocks of multi-FEC frames in parallel on our worker threads
+    if (queue->fecWorkerCount != 0 && block->lastBlockNumber != 0 && dispatchFecBlockRecovery(queue, block)) {
+        return 1;
+    }
+
+    RTPV_QUEUE_LIST recoveredList;
+    memset(&recoveredList, 0, sizeof(recoveredList));
+
+    ret = recoverFecBlockPackets(block, queue->multiFecCapable, &recoveredList);
+    finishFecBlockRecovery(queue, block, &recoveredList, ret);
+    return ret;
+}
+
+static void stageCompleteFecBlock(PRTP_VIDEO_QUEUE queue, PRTPV_FEC_BLOCK block) {
+    unsigned int nextSeqNum = block->lowestSequenceNumber;
 
-    while (queue->pendingFecBlockList.count > 0) {
-        PRTPV_QUEUE_ENTRY entry = queue->pendingFecBlockList.head;
+    while (block->packetList.count > 0) {
+        PRTPV_QUEUE_ENTRY entry = block->packetList.head;
 
         unsigned int lowestRtpSequenceNumber = entry->packet->sequenceNumber;
 
@@ -481,26 +792,26 @@ static void stageCompleteFecBlock(PRTP_VIDEO_QUEUE queue) {
                 entry = parityEntry->next;
 
                 // Remove this entry
-                removeEntryFromList(&queue->pendingFecBlockList, parityEntry);
+                removeEntryFromList(&block->packetList, parityEntry);
 
                 // Free the entry and packet
-                free(parityEntry->packet);
+                free(parityEntry->allocPtr);
 
                 continue;
             }
 
             // Check for the next packet in sequence. This will be O(1) for non-reordered packet streams.
             if (entry->packet->sequenceNumber == nextSeqNum) {
-                removeEntryFromList(&queue->pendingFecBlockList, entry);
+                removeEntryFromList(&block->packetList, entry);
 
                 // To avoid having to sample the system time for each packet, we cheat
                 // and use the first packet's receive time for all packets. This ends up
                 // actually being better for the measurements that the depacketizer does,
                 // since it properly handles out of order packets.
-                LC_ASSERT(queue->bufferFirstRecvTimeMs != 0);
-                entry->receiveTimeMs = queue->bufferFirstRecvTimeMs;
+                LC_ASSERT(block->firstRecvTimeMs != 0);
+                entry->receiveTimeMs = block->firstRecvTimeMs;
 
-                // Move this packet to the completed FEC block list
+                // Move this packet to the list of packets to submit
                 insertEntryIntoList(&queue->completedFecBlockList, entry);
                 break;
             }
@@ -522,7 +833,7 @@ static void stageCompleteFecBlock(PRTP_VIDEO_QUEUE queue) {
     }
 }
 
-static void submitCompletedFrame(PRTP_VIDEO_QUEUE queue) {
+static void submitStagedFecBlock(PRTP_VIDEO_QUEUE queue) {
     while (queue->completedFecBlockList.count > 0) {
         PRTPV_QUEUE_ENTRY entry = queue->completedFecBlockList.head;
 
@@ -535,16 +846,504 @@ static void submitCompletedFrame(PRTP_VIDEO_QUEUE queue) {
     }
 }
 
-uint32_t RtpvGetCurrentFrameNumber(PRTP_VIDEO_QUEUE queue) {
-    return queue->currentFrameNumber;
+// Returns true if we have no use for any more packets of this frame, either because it is
+// behind our current frame or because all of its FEC blocks are already complete. This
+// only needs the frame number, so the receive thread can use it to discard packets before
+// decrypting them. It must not be used to mutate any queue state.
+bool RtpvIsFrameDone(PRTP_VIDEO_QUEUE queue, uint32_t frameNumber) {
+    uint32_t completeBlocks = 0;
+
+    if (frameNumber < queue->currentFrameNumber) {
+        return true;
+    }
+
+    // A current frame with all of its FEC blocks complete would have been submitted
+    // already, but a later frame's FEC blocks can all complete while we're waiting on
+    // an earlier one. Their surplus parity packets would just be rejected.
+    //
+    // FEC blocks being recovered aren't done, since we need their remaining packets
+    // if the recovery fails.
+    for (uint32_t i = 0; i < queue->activeFecBlocks; i++) {
+        PRTPV_FEC_BLOCK block = &queue->fecBlocks[i];
+
+        if (block->frameNumber == frameNumber) {
+            if (!block->complete) {
+                return false;
+            }
+
+            if (++completeBlocks == block->lastBlockNumber + 1U) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static bool isFecBlockBefore(uint32_t frameNumber, uint8_t blockNumber, uint32_t otherFrameNumber, uint8_t otherBlockNumber) {
+    if (frameNumber != otherFrameNumber) {
+        return isBefore16(frameNumber, otherFrameNumber);
+    }
+    else {
+        return blockNumber < otherBlockNumber;
+    }
+}
+
+static bool isCurrentFecBlock(PRTP_VIDEO_QUEUE queue, PRTPV_FEC_BLOCK block) {
+    return block->frameNumber == queue->currentFrameNumber && block->blockNumber == queue->multiFecCurrentBlockNumber;
+}
+
+// Packets up to the end of this FEC block will no longer be accepted
+static void skipPastFecBlock(PRTP_VIDEO_QUEUE queue, PRTPV_FEC_BLOCK block) {
+    uint32_t nextSequenceNumber = U16(block->highestSequenceNumber + 1);
+
+    if (isBefore16(queue->nextContiguousSequenceNumber, nextSequenceNumber)) {
+        queue->nextContiguousSequenceNumber = nextSequenceNumber;
+    }
+}
+
+static void removeFecBlock(PRTP_VIDEO_QUEUE queue, uint32_t index) {
+    LC_ASSERT(index < queue->activeFecBlocks);
+
+    purgeListEntries(&queue->fecBlocks[index].packetList);
+    memmove(&queue->fecBlocks[index], &queue->fecBlocks[index + 1],
+            (queue->activeFecBlocks - index - 1) * sizeof(queue->fecBlocks[0]));
+    queue->activeFecBlocks--;
+}
+
+// Sends a speculative RFI request as soon as the FEC block we're waiting on is predicted to be
+// unrecoverable. Predictions for later FEC blocks are reported once they become the current one,
+// because the depacketizer can't handle a loss notification for a later frame while an earlier
+// one may still be delivered.
+static void reportPredictedFrameLoss(PRTP_VIDEO_QUEUE queue) {
+    PRTPV_FEC_BLOCK block;
+
+    // Don't speculate if we've received OOS data from this host recently
+    if (queue->activeFecBlocks == 0 || queue->reportedLostFrame || queue->receivedOosData) {
+        return;
+    }
+
+    block = &queue->fecBlocks[0];
+    if (isCurrentFecBlock(queue, block) && block->predictedLoss) {
+        notifyFrameLost(block->frameNumber, true);
+        queue->reportedLostFrame = true;
+        block->reportedLoss = true;
+    }
+}
+
+// Gives up on the current frame and moves on to the next one we have data for
+static void dropCurrentFrame(PRTP_VIDEO_QUEUE queue) {
+    uint32_t nextFrameNumber;
+
+    if (queue->activeFecBlocks > 0 && isCurrentFecBlock(queue, &queue->fecBlocks[0])) {
+        PRTPV_FEC_BLOCK block = &queue->fecBlocks[0];
+
+        // The loss prediction for this FEC block was correct
+        if (block->predictedLoss) {
+            updateSpeculativeRfiCooldown(queue);
+        }
+
+        // Report the final status of the FEC queue before dropping this frame
+        reportFinalFrameFecStatus(block);
+
+        if (block->lastBlockNumber != 0) {
+            Limelog("Unrecoverable frame %d (block %d of %d): %d+%d=%d received < %d needed\n",
+                    block->frameNumber, block->blockNumber+1,
+                    block->lastBlockNumber+1,
+                    block->receivedDataPackets,
+                    block->receivedParityPackets,
+                    block->packetList.count,
+                    block->dataPackets);
+        }
+        else {
+            Limelog("Unrecoverable frame %d: %d+%d=%d received < %d needed\n",
+                    block->frameNumber, block->receivedDataPackets,
+                    block->receivedParityPackets,
+                    block->packetList.count,
+                    block->dataPackets);
+        }
+    }
+    else {
+        Limelog("Unrecoverable frame %d: lost FEC block %d\n",
+                queue->currentFrameNumber,
+                queue->multiFecCurrentBlockNumber + 1);
+    }
+
+    // Discard the rest of this frame, since it can't be parsed without the missing FEC block.
+    // Earlier FEC blocks of this frame may have already been submitted to the depacketizer,
+    // but notifyFrameLost() will discard them along with the rest of the frame.
+    LC_ASSERT(queue->completedFecBlockList.count == 0);
+    while (queue->activeFecBlocks > 0 && queue->fecBlocks[0].frameNumber == queue->currentFrameNumber) {
+        skipPastFecBlock(queue, &queue->fecBlocks[0]);
+        removeFecBlock(queue, 0);
+    }
+
+    // Frames before the next one we have data for were lost too
+    nextFrameNumber = queue->activeFecBlocks > 0 ? queue->fecBlocks[0].frameNumber : queue->currentFrameNumber + 1;
+    LC_ASSERT_VT(queue->currentFrameNumber < nextFrameNumber);
+
+    // If this was the only lost frame, we may have already reported it using
+    // our speculative RFI logic. Don't report it again.
+    if (queue->currentFrameNumber + 1 != nextFrameNumber || !queue->reportedLostFrame) {
+        // NB: We only have to notify for the most recent lost frame, since
+        // the depacketizer will report the RFI range starting at the last
+        // frame it saw.
+        notifyFrameLost(nextFrameNumber - 1, false);
+    }
+
+    queue->currentFrameNumber = nextFrameNumber;
+    queue->multiFecCurrentBlockNumber = 0;
+    queue->reportedLostFrame = false;
+}
+
+// Submits completed FEC blocks to the depacketizer in order
+static void submitCompletedFecBlocks(PRTP_VIDEO_QUEUE queue) {
+    while (queue->activeFecBlocks > 0 && queue->fecBlocks[0].complete && isCurrentFecBlock(queue, &queue->fecBlocks[0])) {
+        PRTPV_FEC_BLOCK block = &queue->fecBlocks[0];
+
+        // Put the complete FEC block's data packets in sequence order
+        stageCompleteFecBlock(queue, block);
+
+        // stageCompleteFecBlock() should have consumed all pending FEC data
+        LC_ASSERT(block->packetList.head == NULL);
+        LC_ASSERT(block->packetList.tail == NULL);
+        LC_ASSERT(block->packetList.count == 0);
+
+        skipPastFecBlock(queue, block);
+
+        // Submit this FEC block to the depacketizer now rather than waiting for the
+        // rest of the frame. This lets depacketization of large multi-FEC frames
+        // overlap with receiving the remaining FEC blocks. If a later FEC block
+        // is lost, the depacketizer discards the partial frame.
+        submitStagedFecBlock(queue);
+
+        // submitStagedFecBlock() should have consumed all staged FEC data
+        LC_ASSERT(queue->completedFecBlockList.head == NULL);
+        LC_ASSERT(queue->completedFecBlockList.tail == NULL);
+        LC_ASSERT(queue->completedFecBlockList.count == 0);
+
+        // If we're not yet at the last FEC block for this frame, move on to the next block.
+        // Otherwise, the frame is complete and we can move on to the next frame.
+        if (block->blockNumber < block->lastBlockNumber) {
+            // Move on to the next FEC block for this frame
+            queue->multiFecCurrentBlockNumber++;
+        }
+        else {
+            // Continue to the next frame
+            queue->currentFrameNumber++;
+            queue->multiFecCurrentBlockNumber = 0;
+            queue->reportedLostFrame = false;
+        }
+
+        removeFecBlock(queue, 0);
+    }
+}
+
+static bool isCurrentFecBlockRecovering(PRTP_VIDEO_QUEUE queue) {
+    return queue->activeFecBlocks > 0 && isCurrentFecBlock(queue, &queue->fecBlocks[0]) && queue->fecBlocks[0].recovering;
 }
 
-int RtpvAddPacket(PRTP_VIDEO_QUEUE queue, PRTP_PACKET packet, int length, PRTPV_QUEUE_ENTRY packetEntry) {
+// Submits completed FEC blocks in order. If a later FEC block completed before the one
+// we're waiting on, any stragglers from earlier FEC blocks should have arrived by now,
+// so we stop waiting for them and move on to it. We keep waiting if the FEC block
+// we're waiting on is still being recovered.
+static void advanceToCompletedFecBlocks(PRTP_VIDEO_QUEUE queue) {
+    for (;;) {
+        PRTPV_FEC_BLOCK block = NULL;
+        uint32_t frameNumber;
+        uint8_t blockNumber;
+
+        submitCompletedFecBlocks(queue);
+
+        for (uint32_t i = 0; i < queue->activeFecBlocks; i++) {
+            if (queue->fecBlocks[i].complete) {
+                block = &queue->fecBlocks[i];
+                break;
+            }
+        }
+
+        if (block == NULL) {
+            return;
+        }
+
+        // The current FEC block would have been submitted if it was complete
+        LC_ASSERT(!isCurrentFecBlock(queue, block));
+
+        frameNumber = block->frameNumber;
+        blockNumber = block->blockNumber;
+        do {
+            if (isCurrentFecBlockRecovering(queue)) {
+                return;
+            }
+
+            dropCurrentFrame(queue);
+        } while (isFecBlockBefore(queue->currentFrameNumber, queue->multiFecCurrentBlockNumber,
+                                  frameNumber, blockNumber));
+    }
+}
+
+static void handleCompletedFecBlock(PRTP_VIDEO_QUEUE queue, PRTPV_FEC_BLOCK block) {
+    block->complete = true;
+
+    // Without the reassembly window, we would have dropped this
+    // FEC block when we started on the later one.
+    if (isCurrentFecBlock(queue, block) && block != &queue->fecBlocks[queue->activeFecBlocks - 1]) {
+        queue->reorderedFecBlocksCompleted++;
+    }
+
+    advanceToCompletedFecBlocks(queue);
+}
+
+// Returns a recovered FEC block to the queue, unless we gave up on it while it was being recovered
+static void completeFecRecovery(PRTP_VIDEO_QUEUE queue, PRTPV_FEC_RECOVERY_JOB job) {
+    PRTPV_FEC_BLOCK block = NULL;
+    int result = job->result;
+    uint32_t receivedDuringRecovery;
+
+    LC_ASSERT(queue->pendingFecRecoveries > 0);
+    queue->pendingFecRecoveries--;
+
+    for (uint32_t i = 0; i < queue->activeFecBlocks; i++) {
+        if (queue->fecBlocks[i].recovering && queue->fecBlocks[i].recoveryId == job->recoveryId) {
+            block = &queue->fecBlocks[i];
+            break;
+        }
+    }
+
+    if (block == NULL) {
+        freeFecRecoveryJob(job);
+        return;
+    }
+
+    // Packets that arrived during the recovery are in the block's packet list
+    receivedDuringRecovery = block->packetList.count;
+    if (result == 0) {
+        // We don't need them, so go back to the state the block was recovered from
+        purgeListEntries(&block->packetList);
+        *block = job->block;
+    }
+    else {
+        // Recover again with them, or when we receive more packets
+        while (job->block.packetList.head != NULL) {
+            PRTPV_QUEUE_ENTRY entry = job->block.packetList.head;
+
+            removeEntryFromList(&job->block.packetList, entry);
+            insertEntryIntoList(&block->packetList, entry);
+        }
+    }
+    block->recovering = false;
+    finishFecBlockRecovery(queue, block, &job->recoveredList, result);
+    free(job);
+
+    // If the recovery failed, try again if packets arrived during it. Otherwise,
+    // we'll try again when we receive more packets.
+    if (result == 0 || (receivedDuringRecovery != 0 && reconstructFecBlock(queue, block) == 0)) {
+        handleCompletedFecBlock(queue, block);
+    }
+
+    reportPredictedFrameLoss(queue);
+}
+
+static void pollFecRecoveries(PRTP_VIDEO_QUEUE queue) {
+    PRTPV_FEC_RECOVERY_JOB job;
+
+    while (queue->pendingFecRecoveries != 0 && LbqPollQueueElement(&queue->fecRecoveredQueue, (void**)&job) == LBQ_SUCCESS) {
+        completeFecRecovery(queue, job);
+    }
+}
+
+bool RtpvHasPendingFecRecoveries(PRTP_VIDEO_QUEUE queue) {
+    return queue->pendingFecRecoveries != 0;
+}
+
+// Returns an fd that becomes readable when an FEC worker finishes a recovery. The
+// receive thread polls it with the socket while RtpvHasPendingFecRecoveries() is true.
+int RtpvGetFecRecoveryFd(PRTP_VIDEO_QUEUE queue) {
+    LC_ASSERT(queue->fecWorkerCount != 0);
+    return queue->fecRecoveredReadFd;
+}
+
+// Completes all recoveries that the FEC workers have finished
+void RtpvPollFecRecoveries(PRTP_VIDEO_QUEUE queue) {
+    // Clear the fd first, so a recovery returned after we poll signals it again
+    PltClearWakeFd(queue->fecRecoveredReadFd);
+    pollFecRecoveries(queue);
+}
+
+static void FecWorkerThreadProc(void* context) {
+    PRTPV_FEC_WORKER worker = (PRTPV_FEC_WORKER)context;
+    PRTPV_FEC_RECOVERY_JOB job;
+
+    while (LbqWaitForQueueElement(&worker->jobQueue, (void**)&job) == LBQ_SUCCESS) {
+        job->result = recoverFecBlockPackets(&job->block, job->multiFecCapable, &job->recoveredList);
+
+        if (LbqOfferQueueItem(worker->recoveredQueue, job, &job->lentry) != LBQ_SUCCESS) {
+            // The receive thread is shutting down
+            freeFecRecoveryJob(job);
+        }
+        else {
+            PltSignalWakeFd(worker->recoveredWakeFd);
+        }
+    }
+}
+
+static void drainFecRecoveryJobs(PLINKED_BLOCKING_QUEUE queue) {
+    PLINKED_BLOCKING_QUEUE_ENTRY entry = LbqDestroyLinkedBlockingQueue(queue);
+
+    while (entry != NULL) {
+        PLINKED_BLOCKING_QUEUE_ENTRY nextEntry = entry->flink;
+        freeFecRecoveryJob((PRTPV_FEC_RECOVERY_JOB)entry->data);
+        entry = nextEntry;
+    }
+}
+
+// Starts the FEC worker threads. This must be called on the thread calling RtpvAddPacket().
+// If the workers can't be started, FEC recovery is done on the calling thread.
+void RtpvStartFecWorkers(PRTP_VIDEO_QUEUE queue) {
+    LC_ASSERT(queue->fecWorkerCount == 0);
+
+    // The receive thread can't wait for recoveries without a wake fd
+    if (PltCreateWakeFd(&queue->fecRecoveredReadFd, &queue->fecRecoveredWriteFd) != 0) {
+        return;
+    }
+
+    if (LbqInitializeLinkedBlockingQueue(&queue->fecRecoveredQueue, MAX_PENDING_FEC_RECOVERIES) != LBQ_SUCCESS) {
+        PltCloseWakeFd(queue->fecRecoveredReadFd, queue->fecRecoveredWriteFd);
+        return;
+    }
+
+    for (uint32_t i = 0; i < RTPV_FEC_WORKER_THREADS; i++) {
+        PRTPV_FEC_WORKER worker = &queue->fecWorkers[i];
+
+        if (LbqInitializeLinkedBlockingQueue(&worker->jobQueue, MAX_PENDING_FEC_RECOVERIES) != LBQ_SUCCESS) {
+            break;
+        }
+
+        worker->recoveredQueue = &queue->fecRecoveredQueue;
+        worker->recoveredWakeFd = queue->fecRecoveredWriteFd;
+        if (PltCreateThread("VideoFec", THREAD_ROLE_VIDEO_FEC, FecWorkerThreadProc, worker, &worker->thread) != 0) {
+            LbqDestroyLinkedBlockingQueue(&worker->jobQueue);
+            break;
+        }
+
+        queue->fecWorkerCount++;
+    }
+
+    if (queue->fecWorkerCount == 0) {
+        LbqDestroyLinkedBlockingQueue(&queue->fecRecoveredQueue);
+        PltCloseWakeFd(queue->fecRecoveredReadFd, queue->fecRecoveredWriteFd);
+    }
+}
+
+// Stops the FEC worker threads and discards any unfinished recoveries
+void RtpvStopFecWorkers(PRTP_VIDEO_QUEUE queue) {
+    if (queue->fecWorkerCount == 0) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < queue->fecWorkerCount; i++) {
+        LbqSignalQueueShutdown(&queue->fecWorkers[i].jobQueue);
+    }
+
+    for (uint32_t i = 0; i < queue->fecWorkerCount; i++) {
+        PltJoinThread(&queue->fecWorkers[i].thread);
+        drainFecRecoveryJobs(&queue->fecWorkers[i].jobQueue);
+    }
+
+    // The workers are gone, so nothing else will be returned
+    LbqSignalQueueShutdown(&queue->fecRecoveredQueue);
+    drainFecRecoveryJobs(&queue->fecRecoveredQueue);
+    PltCloseWakeFd(queue->fecRecoveredReadFd, queue->fecRecoveredWriteFd);
+
+    queue->fecWorkerCount = 0;
+    queue->pendingFecRecoveries = 0;
+}
+
+// Returns NULL if the packet should be rejected
+static PRTPV_FEC_BLOCK startFecBlock(PRTP_VIDEO_QUEUE queue, PRTP_PACKET packet, PNV_VIDEO_PACKET nvPacket,
+                                     uint32_t fecIndex, uint8_t fecCurrentBlockNumber) {
+    PRTPV_FEC_BLOCK block;
+    uint32_t index;
+
+    if (queue->activeFecBlocks == queue->fecBlockWindow) {
+        PRTPV_FEC_BLOCK newestBlock = &queue->fecBlocks[queue->activeFecBlocks - 1];
+
+        if (isFecBlockBefore(nvPacket->frameIndex, fecCurrentBlockNumber, newestBlock->frameNumber, newestBlock->blockNumber)) {
+            // Earlier FEC blocks take priority, so make room by discarding the newest one.
+            // The packets we've received for it are lost. If more of its packets arrive
+            // later, it starts over with only those.
+            removeFecBlock(queue, queue->activeFecBlocks - 1);
+        }
+        else {
+            // We can't wait any longer for the current frame
+            do {
+                dropCurrentFrame(queue);
+                submitCompletedFecBlocks(queue);
+            } while (queue->activeFecBlocks == queue->fecBlockWindow);
+
+            if (isFecBlockBefore(nvPacket->frameIndex, fecCurrentBlockNumber,
+                                 queue->currentFrameNumber, queue->multiFecCurrentBlockNumber)) {
+                // We just gave up on this frame
+                return NULL;
+            }
+        }
+    }
+
+    // Keep the FEC blocks sorted so they can be submitted in order
+    index = queue->activeFecBlocks;
+    while (index > 0 && isFecBlockBefore(nvPacket->frameIndex, fecCurrentBlockNumber,
+                                         queue->fecBlocks[index - 1].frameNumber, queue->fecBlocks[index - 1].blockNumber)) {
+        index--;
+    }
+    memmove(&queue->fecBlocks[index + 1], &queue->fecBlocks[index],
+            (queue->activeFecBlocks - index) * sizeof(queue->fecBlocks[0]));
+    queue->activeFecBlocks++;
+
+    block = &queue->fecBlocks[index];
+    memset(block, 0, sizeof(*block));
+
+    // Tell the control stream logic about this frame, even if we don't end up
+    // being able to reconstruct a full frame from it.
+    if (isBefore16(queue->highestSeenFrameNumber, nvPacket->frameIndex)) {
+        queue->highestSeenFrameNumber = nvPacket->frameIndex;
+        connectionSawFrame(nvPacket->frameIndex);
+    }
+
+    block->frameNumber = nvPacket->frameIndex;
+    block->firstRecvTimeMs = PltGetMillis();
+    mediaClockAddVideoFrame(packet->timestamp / PTS_DIVISOR, block->firstRecvTimeMs);
+    block->lowestSequenceNumber = U16(packet->sequenceNumber - fecIndex);
+    block->nextContiguousSequenceNumber = block->lowestSequenceNumber;
+    block->useFastQueuePath = true;
+    block->dataPackets = (nvPacket->fecInfo & 0xFFC00000) >> 22;
+    block->fecPercentage = (nvPacket->fecInfo & 0xFF0) >> 4;
+    block->parityPackets = (block->dataPackets * block->fecPercentage + 99) / 100;
+    block->firstParitySequenceNumber = U16(block->lowestSequenceNumber + block->dataPackets);
+    block->highestSequenceNumber = U16(block->firstParitySequenceNumber + block->parityPackets - 1);
+    block->blockNumber = fecCurrentBlockNumber;
+    block->lastBlockNumber = (nvPacket->multiFecBlocks >> 6) & 0x3;
+
+    return block;
+}
+
+int RtpvAddPacket(PRTP_VIDEO_QUEUE queue, void* allocPtr, PRTP_PACKET packet, int length, PRTPV_QUEUE_ENTRY packetEntry, uint64_t receiveTimeUs) {
+    PRTPV_FEC_BLOCK block;
+
+    // Pick up any FEC blocks that our workers have finished recovering
+    if (queue->pendingFecRecoveries != 0) {
+        pollFecRecoveries(queue);
+    }
+
     if (isBefore16(packet->sequenceNumber, queue->nextContiguousSequenceNumber)) {
         // Reject packets behind our current buffer window
         return RTPF_RET_REJECTED;
     }
 
+    if (RtpwIsDuplicate(&queue->replayWindow, packet->sequenceNumber)) {
+        // Reject duplicate packets
+        return RTPF_RET_REJECTED;
+    }
+
     // FLAG_EXTENSION is required for all supported versions of GFE.
     LC_ASSERT_VT(packet->header & FLAG_EXTENSION);
 
@@ -572,6 +1371,8 @@ int RtpvAddPacket(PRTP_VIDEO_QUEUE queue, PRTP_PACKET packet, int length, PRTPV_
         nvPacket->multiFecBlocks = 0x00;
     }
 
+    trackFrameArrival(queue, nvPacket->frameIndex, packet->timestamp / PTS_DIVISOR, receiveTimeUs);
+
 #ifndef LC_FUZZING
     if (isBefore16(nvPacket->frameIndex, queue->currentFrameNumber)) {
         // Reject frames behind our current frame number
@@ -587,215 +1388,96 @@ int RtpvAddPacket(PRTP_VIDEO_QUEUE queue, PRTP_PACKET packet, int length, PRTPV_
         return RTPF_RET_REJECTED;
     }
 
-    // Reinitialize the queue if it's empty after a frame delivery or
-    // if we can't finish a frame before receiving the next one.
-    if (queue->pendingFecBlockList.count == 0 || queue->currentFrameNumber != nvPacket->frameIndex ||
-            queue->multiFecCurrentBlockNumber != fecCurrentBlockNumber) {
-        if (queue->pendingFecBlockList.count != 0) {
-            // Report the final status of the FEC queue before dropping this frame
-            reportFinalFrameFecStatus(queue);
-
-            if (queue->multiFecLastBlockNumber != 0) {
-                Limelog("Unrecoverable frame %d (block %d of %d): %d+%d=%d received < %d needed\n",
-                        queue->currentFrameNumber, queue->multiFecCurrentBlockNumber+1,
-                        queue->multiFecLastBlockNumber+1,
-                        queue->receivedDataPackets,
-                        queue->receivedParityPackets,
-                        queue->pendingFecBlockList.count,
-                        queue->bufferDataPackets);
-
-                // If we just missed a block of this frame rather than the whole thing,
-                // we must manually advance the queue to the next frame. Parsing this
-                // frame further is not possible.
-                if (queue->currentFrameNumber == nvPacket->frameIndex) {
-                    // Discard any unsubmitted buffers from the previous frame
-                    purgeListEntries(&queue->pendingFecBlockList);
-                    purgeListEntries(&queue->completedFecBlockList);
-
-                    // Notify the host of the loss of this frame
-                    if (!queue->reportedLostFrame) {
-                        notifyFrameLost(queue->currentFrameNumber, false);
-                        queue->reportedLostFrame = true;
-                    }
-
-                    queue->currentFrameNumber++;
-                    queue->multiFecCurrentBlockNumber = 0;
-                    return RTPF_RET_REJECTED;
-                }
-            }
-            else {
-                Limelog("Unrecoverable frame %d: %d+%d=%d received < %d needed\n",
-                        queue->currentFrameNumber, queue->receivedDataPackets,
-                        queue->receivedParityPackets,
-                        queue->pendingFecBlockList.count,
-                        queue->bufferDataPackets);
-            }
+    // Find the FEC block that this packet belongs to. If we're not reassembling
+    // it yet, start on it as long as it fits in our reassembly window.
+    block = NULL;
+    for (uint32_t i = 0; i < queue->activeFecBlocks; i++) {
+        if (queue->fecBlocks[i].frameNumber == nvPacket->frameIndex && queue->fecBlocks[i].blockNumber == fecCurrentBlockNumber) {
+            block = &queue->fecBlocks[i];
+            break;
         }
-        
-        // We must either start on the current FEC block number for the current frame,
-        // or block 0 of a new frame.
-        uint8_t expectedFecBlockNumber = (queue->currentFrameNumber == nvPacket->frameIndex ? queue->multiFecCurrentBlockNumber : 0);
-        if (fecCurrentBlockNumber != expectedFecBlockNumber) {
-            // Report the final status of the FEC queue before dropping this frame
-            reportFinalFrameFecStatus(queue);
-
-            Limelog("Unrecoverable frame %d: lost FEC blocks %d to %d\n",
-                    nvPacket->frameIndex,
-                    expectedFecBlockNumber + 1,
-                    fecCurrentBlockNumber);
-
-            // Discard any unsubmitted buffers from the previous frame
-            purgeListEntries(&queue->pendingFecBlockList);
-            purgeListEntries(&queue->completedFecBlockList);
-
-            // Notify the host of the loss of this frame
-            if (!queue->reportedLostFrame) {
-                notifyFrameLost(queue->currentFrameNumber, false);
-                queue->reportedLostFrame = true;
-            }
-
-            // We dropped a block of this frame, so we must skip to the next one.
-            queue->currentFrameNumber = nvPacket->frameIndex + 1;
-            queue->multiFecCurrentBlockNumber = 0;
+    }
+    if (block == NULL) {
+        block = startFecBlock(queue, packet, nvPacket, fecIndex, fecCurrentBlockNumber);
+        if (block == NULL) {
+            // We may have given up on earlier frames to get here
+            reportPredictedFrameLoss(queue);
             return RTPF_RET_REJECTED;
         }
+    }
+    else if (block->complete) {
+        // This FEC block is just waiting on an earlier one to be submitted
+        return RTPF_RET_REJECTED;
+    }
 
-        // Discard any pending buffers from the previous FEC block
-        purgeListEntries(&queue->pendingFecBlockList);
-
-        // Discard any completed FEC blocks from the previous frame
-        if (queue->currentFrameNumber != nvPacket->frameIndex) {
-            purgeListEntries(&queue->completedFecBlockList);
-        }
-
-        // If the frame numbers are not contiguous, the network dropped an entire frame.
-        // The check here looks weird, but that's because we increment the frame number
-        // after successfully processing a frame.
-        if (queue->currentFrameNumber != nvPacket->frameIndex) {
-            LC_ASSERT_VT(queue->currentFrameNumber < nvPacket->frameIndex);
-
-            // If the frame immediately preceding this one was lost, we may have already
-            // reported it using our speculative RFI logic. Don't report it again.
-            if (queue->currentFrameNumber + 1 != nvPacket->frameIndex || !queue->reportedLostFrame) {
-                // NB: We only have to notify for the most recent lost frame, since
-                // the depacketizer will report the RFI range starting at the last
-                // frame it saw.
-                notifyFrameLost(nvPacket->frameIndex - 1, false);
-            }
-        }
-
-        queue->currentFrameNumber = nvPacket->frameIndex;
-
-        // Tell the control stream logic about this frame, even if we don't end up
-        // being able to reconstruct a full frame from it.
-        connectionSawFrame(queue->currentFrameNumber);
-        
-        queue->bufferFirstRecvTimeMs = PltGetMillis();
-        queue->bufferLowestSequenceNumber = U16(packet->sequenceNumber - fecIndex);
-        queue->nextContiguousSequenceNumber = queue->bufferLowestSequenceNumber;
-        queue->receivedDataPackets = 0;
-        queue->receivedParityPackets = 0;
-        queue->receivedHighestSequenceNumber = 0;
-        queue->missingPackets = 0;
-        queue->useFastQueuePath = true;
-        queue->reportedLostFrame = false;
-        queue->bufferDataPackets = (nvPacket->fecInfo & 0xFFC00000) >> 22;
-        queue->fecPercentage = (nvPacket->fecInfo & 0xFF0) >> 4;
-        queue->bufferParityPackets = (queue->bufferDataPackets * queue->fecPercentage + 99) / 100;
-        queue->bufferFirstParitySequenceNumber = U16(queue->bufferLowestSequenceNumber + queue->bufferDataPackets);
-        queue->bufferHighestSequenceNumber = U16(queue->bufferFirstParitySequenceNumber + queue->bufferParityPackets - 1);
-        queue->multiFecCurrentBlockNumber = fecCurrentBlockNumber;
-        queue->multiFecLastBlockNumber = (nvPacket->multiFecBlocks >> 6) & 0x3;
-    }
-
-    // Reject packets above our FEC queue valid sequence number range
-    if (isBefore16(queue->bufferHighestSequenceNumber, packet->sequenceNumber)) {
+    // Reject packets outside of this FEC block's valid sequence number range
+    if (isBefore16(packet->sequenceNumber, block->lowestSequenceNumber) ||
+            isBefore16(block->highestSequenceNumber, packet->sequenceNumber)) {
         return RTPF_RET_REJECTED;
     }
 
-    LC_ASSERT_VT(!queue->fecPercentage || U16(packet->sequenceNumber - fecIndex) == queue->bufferLowestSequenceNumber);
-    LC_ASSERT_VT((nvPacket->fecInfo & 0xFF0) >> 4 == queue->fecPercentage);
-    LC_ASSERT_VT((nvPacket->fecInfo & 0xFFC00000) >> 22 == queue->bufferDataPackets);
+    LC_ASSERT_VT(!block->fecPercentage || U16(packet->sequenceNumber - fecIndex) == block->lowestSequenceNumber);
+    LC_ASSERT_VT((nvPacket->fecInfo & 0xFF0) >> 4 == block->fecPercentage);
+    LC_ASSERT_VT((nvPacket->fecInfo & 0xFFC00000) >> 22 == block->dataPackets);
 
     // Verify that the legacy non-multi-FEC compatibility code works
     LC_ASSERT_VT(queue->multiFecCapable || fecCurrentBlockNumber == 0);
-    LC_ASSERT_VT(queue->multiFecCapable || queue->multiFecLastBlockNumber == 0);
+    LC_ASSERT_VT(queue->multiFecCapable || block->lastBlockNumber == 0);
 
     // Multi-block FEC details must remain the same within a single frame
-    LC_ASSERT_VT(fecCurrentBlockNumber == queue->multiFecCurrentBlockNumber);
-    LC_ASSERT_VT(((nvPacket->multiFecBlocks >> 6) & 0x3) == queue->multiFecLastBlockNumber);
+    LC_ASSERT_VT(((nvPacket->multiFecBlocks >> 6) & 0x3) == block->lastBlockNumber);
 
     LC_ASSERT_VT((nvPacket->flags & FLAG_EOF) || length - dataOffset == StreamConfig.packetSize);
-    if (!queuePacket(queue, packetEntry, packet, length, !isBefore16(packet->sequenceNumber, queue->bufferFirstParitySequenceNumber), false)) {
-        return RTPF_RET_REJECTED;
+
+    // Only record the sequence number once the packet is valid, so a runt or malformed
+    // packet can't cause the real one to be rejected as a duplicate or move the replay
+    // window ahead of the rest of the stream.
+    RtpwRecordPacket(&queue->replayWindow, packet->sequenceNumber);
+    queuePacket(queue, block, packetEntry, allocPtr, packet, length, !isBefore16(packet->sequenceNumber, block->firstParitySequenceNumber), false, receiveTimeUs);
+
+    // Update total missing packet count. If the FEC block is being recovered, its
+    // earlier packets are owned by the recovery job.
+    if (block->receivedDataPackets + block->receivedParityPackets == 0) {
+        // Initialize counts and highest seqnum on the first packet
+        LC_ASSERT(block->missingPackets == 0);
+        LC_ASSERT(block->receivedHighestSequenceNumber == 0);
+        block->missingPackets += U16(packet->sequenceNumber - block->lowestSequenceNumber);
+        block->receivedHighestSequenceNumber = packet->sequenceNumber;
+    }
+    else if (isBefore16(block->receivedHighestSequenceNumber, packet->sequenceNumber)) {
+        // If we receive a packet above the highest sequence number,
+        // adjust our missing packets count based on that new sequence number.
+        block->missingPackets += U16(packet->sequenceNumber - block->receivedHighestSequenceNumber - 1);
+        block->receivedHighestSequenceNumber = packet->sequenceNumber;
     }
     else {
-        // Update total missing packet count
-        if (queue->pendingFecBlockList.count == 1) {
-            // Initialize counts and highest seqnum on the first packet
-            LC_ASSERT(queue->missingPackets == 0);
-            LC_ASSERT(queue->receivedHighestSequenceNumber == 0);
-            queue->missingPackets += U16(packet->sequenceNumber - queue->bufferLowestSequenceNumber);
-            queue->receivedHighestSequenceNumber = packet->sequenceNumber;
-        }
-        else if (isBefore16(queue->receivedHighestSequenceNumber, packet->sequenceNumber)) {
-            // If we receive a packet above the highest sequence number,
-            // adjust our missing packets count based on that new sequence number.
-            queue->missingPackets += U16(packet->sequenceNumber - queue->receivedHighestSequenceNumber - 1);
-            queue->receivedHighestSequenceNumber = packet->sequenceNumber;
-        }
-        else {
-            // If we receive a packet behind the highest sequence number, but
-            // queuePacket() accepted it, we must have received a missing packet.
-            LC_ASSERT(queue->missingPackets > 0);
-            queue->missingPackets--;
-        }
+        // If we receive a packet behind the highest sequence number, and
+        // it's not a duplicate, we must have received a missing packet.
+        LC_ASSERT(block->missingPackets > 0);
+        block->missingPackets--;
+    }
 
-        // We explicitly assert less-than because we know we received at least one packet (this one)
-        LC_ASSERT(queue->missingPackets < queue->bufferDataPackets + queue->bufferParityPackets);
+    // We explicitly assert less-than because we know we received at least one packet (this one)
+    LC_ASSERT(block->missingPackets < block->dataPackets + block->parityPackets);
 
-        if (isBefore16(packet->sequenceNumber, queue->bufferFirstParitySequenceNumber)) {
-            queue->receivedDataPackets++;
-            LC_ASSERT(queue->receivedDataPackets <= queue->bufferDataPackets);
-        }
-        else {
-            queue->receivedParityPackets++;
-            LC_ASSERT(queue->receivedParityPackets <= queue->bufferParityPackets);
-        }
-        
-        // Try to submit this frame. If we haven't received enough packets,
-        // this will fail and we'll keep waiting.
-        if (reconstructFrame(queue) == 0) {
-            // Stage the complete FEC block for use once reassembly is complete
-            stageCompleteFecBlock(queue);
-            
-            // stageCompleteFecBlock() should have consumed all pending FEC data
-            LC_ASSERT(queue->pendingFecBlockList.head == NULL);
-            LC_ASSERT(queue->pendingFecBlockList.tail == NULL);
-            LC_ASSERT(queue->pendingFecBlockList.count == 0);
-            
-            // If we're not yet at the last FEC block for this frame, move on to the next block.
-            // Otherwise, the frame is complete and we can move on to the next frame.
-            if (queue->multiFecCurrentBlockNumber < queue->multiFecLastBlockNumber) {
-                // Move on to the next FEC block for this frame
-                queue->multiFecCurrentBlockNumber++;
-            }
-            else {
-                // Submit all FEC blocks to the depacketizer
-                submitCompletedFrame(queue);
-
-                // submitCompletedFrame() should have consumed all completed FEC data
-                LC_ASSERT(queue->completedFecBlockList.head == NULL);
-                LC_ASSERT(queue->completedFecBlockList.tail == NULL);
-                LC_ASSERT(queue->completedFecBlockList.count == 0);
-
-                // Continue to the next frame
-                queue->currentFrameNumber++;
-                queue->multiFecCurrentBlockNumber = 0;
-            }
-        }
+    if (isBefore16(packet->sequenceNumber, block->firstParitySequenceNumber)) {
+        block->receivedDataPackets++;
+        LC_ASSERT(block->receivedDataPackets <= block->dataPackets);
+    }
+    else {
+        block->receivedParityPackets++;
+        LC_ASSERT(block->receivedParityPackets <= block->parityPackets);
+    }
 
-        return RTPF_RET_QUEUED;
+    // Try to complete this FEC block. If we haven't received enough packets,
+    // this will fail and we'll keep waiting. If the FEC block is being recovered,
+    // we keep this packet in case the recovery fails.
+    if (!block->recovering && reconstructFecBlock(queue, block) == 0) {
+        handleCompletedFecBlock(queue, block);
     }
-}
 
+    // Report predicted loss of this FEC block or one that we've just advanced to
+    reportPredictedFrameLoss(queue);
+
+    return RTPF_RET_QUEUED;
+}
@@ -1,11 +1,14 @@
 #pragma once
 
 #include "Video.h"
+#include "RtpReorderEstimator.h"
+#include "RtpReplayWindow.h"
 
 typedef struct _RTPV_QUEUE_ENTRY {
     struct _RTPV_QUEUE_ENTRY* next;
     struct _RTPV_QUEUE_ENTRY* prev;
     PRTP_PACKET packet;
+    void* allocPtr; // Start of the buffer containing the packet and this entry
     uint64_t receiveTimeMs;
     uint32_t presentationTimeMs;
     int length;
@@ -18,33 +21,143 @@ typedef struct _RTPV_QUEUE_LIST {
     uint32_t count;
 } RTPV_QUEUE_LIST, *PRTPV_QUEUE_LIST;
 
-typedef struct _RTP_VIDEO_QUEUE {
-    RTPV_QUEUE_LIST pendingFecBlockList;
-    RTPV_QUEUE_LIST completedFecBlockList;
+// State for a single FEC block of a frame that is being reassembled
+typedef struct _RTPV_FEC_BLOCK {
+    RTPV_QUEUE_LIST packetList;
 
-    uint64_t bufferFirstRecvTimeMs;
-    uint32_t bufferLowestSequenceNumber;
-    uint32_t bufferHighestSequenceNumber;
-    uint32_t bufferFirstParitySequenceNumber;
-    uint32_t bufferDataPackets;
-    uint32_t bufferParityPackets;
+    uint64_t firstRecvTimeMs;
+    uint32_t frameNumber;
+    uint32_t lowestSequenceNumber;
+    uint32_t highestSequenceNumber;
+    uint32_t firstParitySequenceNumber;
+    uint32_t dataPackets;
+    uint32_t parityPackets;
     uint32_t receivedDataPackets;
     uint32_t receivedParityPackets;
     uint32_t receivedHighestSequenceNumber;
     uint32_t fecPercentage;
     uint32_t nextContiguousSequenceNumber;
     uint32_t missingPackets; // # of holes behind receivedHighestSequenceNumber
+    uint8_t blockNumber;
+    uint8_t lastBlockNumber;
     bool useFastQueuePath;
+    bool predictedLoss; // Too many holes to be recoverable without OOS data
+    bool reportedLoss; // Predicted loss was sent to the host as a speculative RFI
+    bool recovering; // Earlier packets are owned by an FEC recovery job until it completes
+    bool complete;
+    uint32_t recoveryId;
+} RTPV_FEC_BLOCK, *PRTPV_FEC_BLOCK;
+
+// Number of threads recovering FEC blocks of multi-FEC frames in parallel
+#define RTPV_FEC_WORKER_THREADS 2
+
+// An FEC block being recovered by an FEC worker thread. The job owns a copy of
+// the FEC block and its packets until it is returned to the receive thread.
+typedef struct _RTPV_FEC_RECOVERY_JOB {
+    LINKED_BLOCKING_QUEUE_ENTRY lentry;
+    RTPV_FEC_BLOCK block;
+    RTPV_QUEUE_LIST recoveredList;
+    uint32_t recoveryId;
+    bool multiFecCapable;
+    int result;
+} RTPV_FEC_RECOVERY_JOB, *PRTPV_FEC_RECOVERY_JOB;
+
+typedef struct _RTPV_FEC_WORKER {
+    PLT_THREAD thread;
+    LINKED_BLOCKING_QUEUE jobQueue;
+    PLINKED_BLOCKING_QUEUE recoveredQueue;
+    int recoveredWakeFd;
+} RTPV_FEC_WORKER, *PRTPV_FEC_WORKER;
+
+// Arrival timing of the packets of a single frame
+typedef struct _RTPV_FRAME_ARRIVAL {
+    uint64_t firstPacketTimeUs;
+    uint64_t lastPacketTimeUs;
+    uint32_t frameNumber;
+    uint32_t presentationTimeMs;
+    uint32_t packets;
+    uint32_t maxPacketGapUs;
+    uint32_t burstPackets;
+    uint32_t maxBurstPackets;
+    bool fecRecovered;
+} RTPV_FRAME_ARRIVAL, *PRTPV_FRAME_ARRIVAL;
+
+// The maximum number of FEC blocks that may be reassembled concurrently
+#define RTPV_MAX_FEC_BLOCK_WINDOW 8
+#define RTPV_DEFAULT_FEC_BLOCK_WINDOW 2
+
+typedef struct _RTP_VIDEO_QUEUE {
+    // FEC blocks being reassembled, sorted by frame and block number
+    RTPV_FEC_BLOCK fecBlocks[RTPV_MAX_FEC_BLOCK_WINDOW];
+    uint32_t activeFecBlocks;
+    uint32_t fecBlockWindow;
+
+    // FEC blocks of multi-FEC frames are recovered by worker threads, so large
+    // frames with losses recover in parallel while the receive thread keeps
+    // draining the socket. Recovered FEC blocks are returned to the receive
+    // thread and submitted in order with the rest. The workers signal the wake
+    // fd when they return one, so the receive thread can poll it with the socket.
+    RTPV_FEC_WORKER fecWorkers[RTPV_FEC_WORKER_THREADS];
+    LINKED_BLOCKING_QUEUE fecRecoveredQueue;
+    int fecRecoveredReadFd;
+    int fecRecoveredWriteFd;
+    uint32_t fecWorkerCount;
+    uint32_t nextFecWorker;
+    uint32_t pendingFecRecoveries;
+    uint32_t nextRecoveryId;
+
+    // Data packets of a completed FEC block in sequence order, ready to be
+    // submitted to the depacketizer
+    RTPV_QUEUE_LIST completedFecBlockList;
+
+    // Packets before this have already been delivered or dropped
+    uint32_t nextContiguousSequenceNumber;
+
+    // Rejects duplicates of packets after nextContiguousSequenceNumber
+    RTP_REPLAY_WINDOW replayWindow;
     bool reportedLostFrame;
 
     uint32_t currentFrameNumber;
+    uint32_t highestSeenFrameNumber;
 
     bool multiFecCapable;
     uint8_t multiFecCurrentBlockNumber;
-    uint8_t multiFecLastBlockNumber;
 
     uint32_t lastOosFramePresentationTimestamp;
     bool receivedOosData;
+
+    // Loss predictions are made for every FEC block, even while speculative RFI
+    // is disabled. The fraction of them that turned out to be recoverable after
+    // all determines how long speculative RFI stays disabled after OOS data.
+    uint32_t lossPredictions;
+    uint32_t lossPredictionFalsePositives;
+    uint32_t speculativeRfiCooldownMs;
+
+    // Packets reordered by up to this many sequence numbers are expected based
+    // on what we've measured. They don't disable speculative RFI, and speculative
+    // loss prediction doesn't count missing packets this close to the highest
+    // received packet of an FEC block as lost.
+    RTP_REORDER_ESTIMATOR reorderEstimator;
+    uint32_t reorderTolerance;
+
+    // FEC blocks that completed while a later FEC block was already being
+    // reassembled. These would have been dropped without the window.
+    uint32_t reorderedFecBlocksCompleted;
+
+    // Arrival timing of the newest frame we've received packets for and of
+    // the frame before it. Recent averages are computed from decaying sums
+    // and published in pacingStats, which is read by other threads.
+    RTPV_FRAME_ARRIVAL frameArrival;
+    RTPV_FRAME_ARRIVAL lastFrameArrival;
+    uint32_t pacingSamples;
+    uint64_t pacingSpreadSumUs;
+    uint64_t pacingMaxGapSumUs;
+    uint64_t pacingMaxBurstSum;
+    uint32_t pacingJitterSamples;
+    uint64_t pacingJitterSumUs;
+    uint32_t pacingFecRecoveredSamples;
+    uint64_t pacingFecRecoveredMaxBurstSum;
+    VIDEO_PACING_STATS pacingStats;
 } RTP_VIDEO_QUEUE, *PRTP_VIDEO_QUEUE;
 
 #define RTPF_RET_QUEUED    0
@@ -52,6 +165,11 @@ typedef struct _RTP_VIDEO_QUEUE {
 
 void RtpvInitializeQueue(PRTP_VIDEO_QUEUE queue);
 void RtpvCleanupQueue(PRTP_VIDEO_QUEUE queue);
-int RtpvAddPacket(PRTP_VIDEO_QUEUE queue, PRTP_PACKET packet, int length, PRTPV_QUEUE_ENTRY packetEntry);
-uint32_t RtpvGetCurrentFrameNumber(PRTP_VIDEO_QUEUE queue);
+int RtpvAddPacket(PRTP_VIDEO_QUEUE queue, void* allocPtr, PRTP_PACKET packet, int length, PRTPV_QUEUE_ENTRY packetEntry, uint64_t receiveTimeUs);
+bool RtpvIsFrameDone(PRTP_VIDEO_QUEUE queue, uint32_t frameNumber);
+void RtpvStartFecWorkers(PRTP_VIDEO_QUEUE queue);
+void RtpvStopFecWorkers(PRTP_VIDEO_QUEUE queue);
+bool RtpvHasPendingFecRecoveries(PRTP_VIDEO_QUEUE queue);
+int RtpvGetFecRecoveryFd(PRTP_VIDEO_QUEUE queue);
+void RtpvPollFecRecoveries(PRTP_VIDEO_QUEUE queue);
 void RtpvSubmitQueuedPackets(PRTP_VIDEO_QUEUE queue);
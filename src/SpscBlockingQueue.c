@@ -0,0 +1,300 @@
+#include "SpscBlockingQueue.h"
+
+// This is a bounded ring buffer for a single producer thread and a single consumer
+// thread. The producer never takes a lock unless the consumer is blocked waiting
+// for data, and the consumer only takes a lock when it must block.
+//
+// Flushes may be performed by either thread, so the read index is advanced using
+// compare-and-swap rather than a plain store. Item slots are always read before the
+// read index is advanced past them, so a flush can never race with the producer
+// reusing a slot that is being read.
+//
+// Consumers running an event loop can enable a ready fd, which is readable whenever the
+// queue has items or a pending signal. It is only cleared when a poll finds the queue
+// empty, so it may be spuriously readable after the consumer takes the last item.
+
+int SbqInitializeQueue(PSPSC_BLOCKING_QUEUE queue, int sizeBound) {
+    uint32_t capacity;
+    int err;
+
+    LC_ASSERT(sizeBound > 0);
+
+    memset(queue, 0, sizeof(*queue));
+    queue->readyReadFd = queue->readyWriteFd = -1;
+
+    // Round the capacity up to a power of 2 so we can mask indexes
+    capacity = 1;
+    while (capacity < (uint32_t)sizeBound) {
+        capacity <<= 1;
+    }
+
+    queue->slots = (void**)calloc(capacity, sizeof(*queue->slots));
+    if (queue->slots == NULL) {
+        return -1;
+    }
+
+    err = PltCreateMutex(&queue->mutex);
+    if (err != 0) {
+        free(queue->slots);
+        queue->slots = NULL;
+        return err;
+    }
+
+    err = PltCreateConditionVariable(&queue->cond, &queue->mutex);
+    if (err != 0) {
+        PltDeleteMutex(&queue->mutex);
+        free(queue->slots);
+        queue->slots = NULL;
+        return err;
+    }
+
+    queue->mask = capacity - 1;
+    queue->sizeBound = (uint32_t)sizeBound;
+
+    return 0;
+}
+
+// This must be called before the queue is used by the producer or consumer
+int SbqEnableReadyFd(PSPSC_BLOCKING_QUEUE queue) {
+    LC_ASSERT(queue->readyReadFd < 0);
+    return PltCreateWakeFd(&queue->readyReadFd, &queue->readyWriteFd);
+}
+
+// Returns -1 if the ready fd is not enabled
+int SbqGetReadyFd(PSPSC_BLOCKING_QUEUE queue) {
+    return queue->readyReadFd;
+}
+
+// The caller must flush any remaining items before destroying the queue
+void SbqDestroyQueue(PSPSC_BLOCKING_QUEUE queue) {
+    LC_ASSERT(queue->readIndex == queue->writeIndex);
+
+    PltDeleteConditionVariable(&queue->cond);
+    PltDeleteMutex(&queue->mutex);
+
+    if (queue->readyReadFd >= 0) {
+        PltCloseWakeFd(queue->readyReadFd, queue->readyWriteFd);
+        queue->readyReadFd = queue->readyWriteFd = -1;
+    }
+
+    free(queue->slots);
+    queue->slots = NULL;
+}
+
+static bool hasWakeCondition(PSPSC_BLOCKING_QUEUE queue) {
+    return PltAtomicLoad32(&queue->readIndex) != PltAtomicLoad32(&queue->writeIndex) ||
+           PltAtomicLoad32(&queue->shutdown) ||
+           PltAtomicLoad32(&queue->draining) ||
+           PltAtomicLoad32(&queue->pendingUserWake);
+}
+
+static void signalReadyFd(PSPSC_BLOCKING_QUEUE queue) {
+    // Only the first signal since the consumer last cleared the fd needs to write to it
+    if (queue->readyWriteFd >= 0 && !PltAtomicLoad32(&queue->readySignalled) && !PltAtomicExchange32(&queue->readySignalled, 1)) {
+        PltSignalWakeFd(queue->readyWriteFd);
+    }
+}
+
+// Clears the ready fd unless there is still something to wake the consumer for. This
+// must only be called by the consumer thread. Returns true if a user wake was consumed.
+static bool clearReadyFd(PSPSC_BLOCKING_QUEUE queue) {
+    bool userWake;
+
+    PltAtomicStore32(&queue->readySignalled, 0);
+    PltClearWakeFd(queue->readyReadFd);
+
+    // The fd is readable to deliver a user wake, so the wake is consumed along with it
+    userWake = PltAtomicLoad32(&queue->pendingUserWake) && PltAtomicExchange32(&queue->pendingUserWake, 0);
+
+    // Producers signal after publishing, so anything published before we cleared
+    // readySignalled is visible now. If a producer signalled the fd again before we
+    // cleared it, our clear may have swallowed that signal, so always write here.
+    if (hasWakeCondition(queue)) {
+        PltAtomicStore32(&queue->readySignalled, 1);
+        PltSignalWakeFd(queue->readyWriteFd);
+    }
+
+    return userWake;
+}
+
+static void setSignalFlag(PSPSC_BLOCKING_QUEUE queue, uint32_t* flag) {
+    // The flag must be set under the mutex to ensure the consumer either
+    // observes it before blocking or is blocked when we signal.
+    PltLockMutex(&queue->mutex);
+    PltAtomicStore32(flag, 1);
+    PltUnlockMutex(&queue->mutex);
+    PltSignalConditionVariable(&queue->cond);
+
+    signalReadyFd(queue);
+}
+
+void SbqSignalQueueShutdown(PSPSC_BLOCKING_QUEUE queue) {
+    setSignalFlag(queue, &queue->shutdown);
+}
+
+// NB: Unlike LBQ, an item offered concurrently with this call may be left
+// in the queue after the consumer observes the drain, so the owner must
+// flush the queue before destroying it.
+void SbqSignalQueueDrain(PSPSC_BLOCKING_QUEUE queue) {
+    setSignalFlag(queue, &queue->draining);
+}
+
+void SbqSignalQueueUserWake(PSPSC_BLOCKING_QUEUE queue) {
+    setSignalFlag(queue, &queue->pendingUserWake);
+}
+
+int SbqGetItemCount(PSPSC_BLOCKING_QUEUE queue) {
+    // Read the read index first to ensure it can't pass the write index
+    uint32_t readIndex = PltAtomicLoad32(&queue->readIndex);
+    return (int)(PltAtomicLoad32(&queue->writeIndex) - readIndex);
+}
+
+// This must only be called by the producer thread
+int SbqOfferQueueItem(PSPSC_BLOCKING_QUEUE queue, void* data) {
+    uint32_t writeIndex;
+
+    if (PltAtomicLoad32(&queue->shutdown) || PltAtomicLoad32(&queue->draining)) {
+        return LBQ_INTERRUPTED;
+    }
+
+    // Only the producer modifies the write index
+    writeIndex = queue->writeIndex;
+
+    // Avoid touching the consumer's cache line unless the queue looks full
+    if (writeIndex - queue->cachedReadIndex >= queue->sizeBound) {
+        queue->cachedReadIndex = PltAtomicLoad32(&queue->readIndex);
+        if (writeIndex - queue->cachedReadIndex >= queue->sizeBound) {
+            return LBQ_BOUND_EXCEEDED;
+        }
+    }
+
+    PltAtomicStorePtr(&queue->slots[writeIndex & queue->mask], data);
+    PltAtomicStore32(&queue->writeIndex, writeIndex + 1);
+
+    // Only take the lock if the consumer is (or is about to be) blocked
+    if (PltAtomicLoad32(&queue->consumerWaiting)) {
+        PltLockMutex(&queue->mutex);
+        PltUnlockMutex(&queue->mutex);
+        PltSignalConditionVariable(&queue->cond);
+    }
+
+    signalReadyFd(queue);
+
+    return LBQ_SUCCESS;
+}
+
+// Claims the item at the head of the queue
+static bool dequeueItem(PSPSC_BLOCKING_QUEUE queue, void** data) {
+    for (;;) {
+        uint32_t readIndex = PltAtomicLoad32(&queue->readIndex);
+        void* item;
+
+        if (readIndex == PltAtomicLoad32(&queue->writeIndex)) {
+            return false;
+        }
+
+        // The slot must be read before we advance the read index,
+        // since the producer may reuse it immediately afterwards.
+        item = PltAtomicLoadPtr(&queue->slots[readIndex & queue->mask]);
+
+        // This can only fail if a flush raced with us
+        if (PltAtomicCompareExchange32(&queue->readIndex, readIndex, readIndex + 1)) {
+            *data = item;
+            return true;
+        }
+    }
+}
+
+// This must be synchronized with SbqFlushQueueItems by the caller
+int SbqPeekQueueElement(PSPSC_BLOCKING_QUEUE queue, void** data) {
+    uint32_t readIndex;
+
+    if (PltAtomicLoad32(&queue->shutdown)) {
+        return LBQ_INTERRUPTED;
+    }
+
+    readIndex = PltAtomicLoad32(&queue->readIndex);
+    if (readIndex == PltAtomicLoad32(&queue->writeIndex)) {
+        return PltAtomicLoad32(&queue->draining) ? LBQ_INTERRUPTED : LBQ_NO_ELEMENT;
+    }
+
+    *data = PltAtomicLoadPtr(&queue->slots[readIndex & queue->mask]);
+    return LBQ_SUCCESS;
+}
+
+int SbqPollQueueElement(PSPSC_BLOCKING_QUEUE queue, void** data) {
+    if (PltAtomicLoad32(&queue->shutdown)) {
+        return LBQ_INTERRUPTED;
+    }
+
+    if (dequeueItem(queue, data)) {
+        return LBQ_SUCCESS;
+    }
+
+    if (PltAtomicLoad32(&queue->draining)) {
+        return LBQ_INTERRUPTED;
+    }
+
+    // The queue is empty, so the ready fd shouldn't stay readable
+    if (queue->readyReadFd >= 0 && clearReadyFd(queue)) {
+        return LBQ_USER_WAKE;
+    }
+
+    return LBQ_NO_ELEMENT;
+}
+
+int SbqWaitForQueueElement(PSPSC_BLOCKING_QUEUE queue, void** data) {
+    for (;;) {
+        // If we're shutting down, abort immediately, even if there's data available
+        if (PltAtomicLoad32(&queue->shutdown)) {
+            return LBQ_INTERRUPTED;
+        }
+
+        // If this is a user requested wake, process it now
+        if (PltAtomicLoad32(&queue->pendingUserWake) && PltAtomicExchange32(&queue->pendingUserWake, 0)) {
+            return LBQ_USER_WAKE;
+        }
+
+        if (dequeueItem(queue, data)) {
+            return LBQ_SUCCESS;
+        }
+
+        // If we're draining, only abort if we have no data available
+        if (PltAtomicLoad32(&queue->draining)) {
+            return dequeueItem(queue, data) ? LBQ_SUCCESS : LBQ_INTERRUPTED;
+        }
+
+        // Wait for a waking condition: either data available or rundown.
+        // The producer checks consumerWaiting after publishing an item, so
+        // either it will see our flag or we will see its item below.
+        PltLockMutex(&queue->mutex);
+        PltAtomicStore32(&queue->consumerWaiting, 1);
+        if (!hasWakeCondition(queue)) {
+            PltWaitForConditionVariable(&queue->cond, &queue->mutex);
+        }
+        PltAtomicStore32(&queue->consumerWaiting, 0);
+        PltUnlockMutex(&queue->mutex);
+    }
+}
+
+// Removes all items from the queue and stores them in the items array in FIFO
+// order. The array must have space for the queue's size bound. This may be
+// called from either the producer or consumer thread.
+int SbqFlushQueueItems(PSPSC_BLOCKING_QUEUE queue, void** items) {
+    for (;;) {
+        uint32_t readIndex = PltAtomicLoad32(&queue->readIndex);
+        uint32_t writeIndex = PltAtomicLoad32(&queue->writeIndex);
+        uint32_t count = writeIndex - readIndex;
+
+        LC_ASSERT(count <= queue->sizeBound);
+
+        for (uint32_t i = 0; i < count; i++) {
+            items[i] = PltAtomicLoadPtr(&queue->slots[(readIndex + i) & queue->mask]);
+        }
+
+        // Claim all of the items we copied at once
+        if (PltAtomicCompareExchange32(&queue->readIndex, readIndex, writeIndex)) {
+            return (int)count;
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Platform.h"
+#include "PlatformThreads.h"
+#include "LinkedBlockingQueue.h"
+
+// Return values are the same LBQ_* values used by the linked blocking queue
+
+// Keep producer and consumer state on separate cache lines to avoid false sharing
+#define SBQ_CACHE_LINE_SIZE 64
+
+typedef struct _SPSC_BLOCKING_QUEUE {
+    // Written only by the producer (except by flushes)
+    uint32_t writeIndex;
+    uint32_t cachedReadIndex;
+    char producerPad[SBQ_CACHE_LINE_SIZE - 2 * sizeof(uint32_t)];
+
+    // Written by the consumer and by flushes
+    uint32_t readIndex;
+    uint32_t consumerWaiting;
+    char consumerPad[SBQ_CACHE_LINE_SIZE - 2 * sizeof(uint32_t)];
+
+    // Rarely modified state
+    void** slots;
+    uint32_t mask;
+    uint32_t sizeBound;
+    uint32_t shutdown;
+    uint32_t draining;
+    uint32_t pendingUserWake;
+
+    // Optional fd that is readable while the consumer has something to wake for
+    int readyReadFd;
+    int readyWriteFd;
+    uint32_t readySignalled;
+
+    // Only used when the consumer must block
+    PLT_MUTEX mutex;
+    PLT_COND cond;
+} SPSC_BLOCKING_QUEUE, *PSPSC_BLOCKING_QUEUE;
+
+int SbqInitializeQueue(PSPSC_BLOCKING_QUEUE queue, int sizeBound);
+void SbqDestroyQueue(PSPSC_BLOCKING_QUEUE queue);
+int SbqEnableReadyFd(PSPSC_BLOCKING_QUEUE queue);
+int SbqGetReadyFd(PSPSC_BLOCKING_QUEUE queue);
+int SbqOfferQueueItem(PSPSC_BLOCKING_QUEUE queue, void* data);
+int SbqWaitForQueueElement(PSPSC_BLOCKING_QUEUE queue, void** data);
+int SbqPollQueueElement(PSPSC_BLOCKING_QUEUE queue, void** data);
+int SbqPeekQueueElement(PSPSC_BLOCKING_QUEUE queue, void** data);
+int SbqFlushQueueItems(PSPSC_BLOCKING_QUEUE queue, void** items);
+void SbqSignalQueueShutdown(PSPSC_BLOCKING_QUEUE queue);
+void SbqSignalQueueDrain(PSPSC_BLOCKING_QUEUE queue);
+void SbqSignalQueueUserWake(PSPSC_BLOCKING_QUEUE queue);
+int SbqGetItemCount(PSPSC_BLOCKING_QUEUE queue);
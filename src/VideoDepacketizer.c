@@ -24,12 +24,30 @@ static unsigned int firstPacketPresentationTime;
 static bool dropStatePending;
 static bool idrFrameProcessed;
 
+// Set if the decoder wants complete NALUs as soon as they arrive rather than
+// whole frames. partialFrameSubmitted is set once part of the current frame
+// has been given to the decoder.
+static bool partialFrameSubmit;
+static bool partialFrameSubmitted;
+static unsigned int partialFrameNumber;
+
 #define DR_CLEANUP -1000
 
 #define CONSECUTIVE_DROP_LIMIT 120
 static unsigned int consecutiveFrameDrops;
 
-static LINKED_BLOCKING_QUEUE decodeUnitQueue;
+#define DECODE_UNIT_QUEUE_BOUND 15
+static SPSC_BLOCKING_QUEUE decodeUnitQueue;
+
+// Enqueue times of the most recently queued decode units. This lets us find the
+// age of the oldest queued frame without touching a decode unit that may be
+// concurrently completed by the consumer. This must be a power of 2 that is no
+// smaller than DECODE_UNIT_QUEUE_BOUND.
+#define DECODE_UNIT_TIME_RING_SIZE 16
+static uint64_t decodeUnitEnqueueTimes[DECODE_UNIT_TIME_RING_SIZE];
+static uint32_t decodeUnitsQueued;
+
+static VIDEO_QUEUE_DROP_STATS queueDropStats;
 
 typedef struct _BUFFER_DESC {
     char* data;
@@ -58,8 +76,23 @@ typedef struct _LENTRY_INTERNAL {
 #define HEVC_NAL_TYPE_SEI 39
 
 // Init
-void initializeVideoDepacketizer(int pktSize) {
-    LbqInitializeLinkedBlockingQueue(&decodeUnitQueue, 15);
+int initializeVideoDepacketizer(int pktSize) {
+    int err;
+
+    err = SbqInitializeQueue(&decodeUnitQueue, DECODE_UNIT_QUEUE_BOUND);
+    if (err != 0) {
+        return err;
+    }
+
+    if (VideoCallbacks.capabilities & CAPABILITY_PULL_RENDERER) {
+        // Not fatal, since the renderer can still wait or poll for frames
+        err = SbqEnableReadyFd(&decodeUnitQueue);
+        if (err != 0) {
+            Limelog("Unable to create video frame ready fd: %d\n", err);
+        }
+    }
+    decodeUnitsQueued = 0;
+    memset(&queueDropStats, 0, sizeof(queueDropStats));
 
     nextFrameNumber = 1;
     startFrameNumber = 0;
@@ -76,6 +109,10 @@ void initializeVideoDepacketizer(int pktSize) {
     dropStatePending = false;
     idrFrameProcessed = false;
     strictIdrFrameWait = !isReferenceFrameInvalidationEnabled();
+    partialFrameSubmit = (VideoCallbacks.capabilities & CAPABILITY_PARTIAL_FRAME_SUBMIT) != 0;
+    partialFrameSubmitted = false;
+
+    return 0;
 }
 
 // Free the NAL chain
@@ -93,6 +130,40 @@ static void cleanupFrameState(void) {
     nalChainDataLength = 0;
 }
 
+static void populateDecodeUnit(PDECODE_UNIT decodeUnit, int frameNumber) {
+    decodeUnit->bufferList = nalChainHead;
+    decodeUnit->fullLength = nalChainDataLength;
+    decodeUnit->frameType = frameType;
+    decodeUnit->frameNumber = frameNumber;
+    decodeUnit->frameHostProcessingLatency = frameHostProcessingLatency;
+    decodeUnit->receiveTimeMs = firstPacketReceiveTime;
+    decodeUnit->presentationTimeMs = firstPacketPresentationTime;
+    decodeUnit->enqueueTimeMs = LiGetMillis();
+
+    // These might be wrong for a few frames during a transition between SDR and HDR,
+    // but the effects shouldn't very noticable since that's an infrequent operation.
+    //
+    // If we start sending this state in the frame header, we can make it 100% accurate.
+    decodeUnit->hdrActive = LiGetCurrentHostDisplayHdrMode();
+    decodeUnit->colorspace = (uint8_t)(decodeUnit->hdrActive ? COLORSPACE_REC_2020 : StreamConfig.colorSpace);
+}
+
+// Tell the decoder to discard the part of a frame that it already received
+static void abortPartialFrame(void) {
+    if (partialFrameSubmitted) {
+        DECODE_UNIT decodeUnit;
+
+        Limelog("Aborting partially submitted frame %u\n", partialFrameNumber);
+
+        populateDecodeUnit(&decodeUnit, partialFrameNumber);
+        decodeUnit.bufferList = NULL;
+        decodeUnit.fullLength = 0;
+
+        VideoCallbacks.submitPartialDecodeUnit(&decodeUnit, PARTIAL_DU_FLAG_ABORT_FRAME);
+        partialFrameSubmitted = false;
+    }
+}
+
 // Cleanup frame state and set that we're waiting for an IDR Frame
 static void dropFrameState(void) {
     // This may only be called at frame boundaries
@@ -101,6 +172,9 @@ static void dropFrameState(void) {
     // We're dropping frame state now
     dropStatePending = false;
 
+    // The decoder may already have part of the frame being dropped
+    abortPartialFrame();
+
     if (strictIdrFrameWait || !idrFrameProcessed || waitingForIdrFrame) {
         // We'll need an IDR frame now if we're in non-RFI mode, if we've never
         // received an IDR frame, or if we explicitly need an IDR frame.
@@ -128,27 +202,26 @@ static void dropFrameState(void) {
     cleanupFrameState();
 }
 
-// Cleanup the list of decode units
-static void freeDecodeUnitList(PLINKED_BLOCKING_QUEUE_ENTRY entry) {
-    PLINKED_BLOCKING_QUEUE_ENTRY nextEntry;
-
-    while (entry != NULL) {
-        nextEntry = entry->flink;
+// Flush and cleanup all queued decode units
+static void flushDecodeUnitQueue(void) {
+    void* decodeUnits[DECODE_UNIT_QUEUE_BOUND];
+    int count;
 
+    count = SbqFlushQueueItems(&decodeUnitQueue, decodeUnits);
+    for (int i = 0; i < count; i++) {
         // Complete this with a failure status
-        LiCompleteVideoFrame(entry->data, DR_CLEANUP);
-
-        entry = nextEntry;
+        LiCompleteVideoFrame(decodeUnits[i], DR_CLEANUP);
     }
 }
 
 void stopVideoDepacketizer(void) {
-    LbqSignalQueueShutdown(&decodeUnitQueue);
+    SbqSignalQueueShutdown(&decodeUnitQueue);
 }
 
 // Cleanup video depacketizer and free malloced memory
 void destroyVideoDepacketizer(void) {
-    freeDecodeUnitList(LbqDestroyLinkedBlockingQueue(&decodeUnitQueue));
+    flushDecodeUnitQueue();
+    SbqDestroyQueue(&decodeUnitQueue);
     cleanupFrameState();
 }
 
@@ -234,7 +307,7 @@ void validateDecodeUnitForPlayback(PDECODE_UNIT decodeUnit) {
 bool LiWaitForNextVideoFrame(VIDEO_FRAME_HANDLE* frameHandle, PDECODE_UNIT* decodeUnit) {
     PQUEUED_DECODE_UNIT qdu;
 
-    int err = LbqWaitForQueueElement(&decodeUnitQueue, (void**)&qdu);
+    int err = SbqWaitForQueueElement(&decodeUnitQueue, (void**)&qdu);
     if (err != LBQ_SUCCESS) {
         return false;
     }
@@ -249,7 +322,7 @@ bool LiWaitForNextVideoFrame(VIDEO_FRAME_HANDLE* frameHandle, PDECODE_UNIT* deco
 bool LiPollNextVideoFrame(VIDEO_FRAME_HANDLE* frameHandle, PDECODE_UNIT* decodeUnit) {
     PQUEUED_DECODE_UNIT qdu;
 
-    int err = LbqPollQueueElement(&decodeUnitQueue, (void**)&qdu);
+    int err = SbqPollQueueElement(&decodeUnitQueue, (void**)&qdu);
     if (err != LBQ_SUCCESS) {
         return false;
     }
@@ -264,7 +337,7 @@ bool LiPollNextVideoFrame(VIDEO_FRAME_HANDLE* frameHandle, PDECODE_UNIT* decodeU
 bool LiPeekNextVideoFrame(PDECODE_UNIT* decodeUnit) {
     PQUEUED_DECODE_UNIT qdu;
 
-    int err = LbqPeekQueueElement(&decodeUnitQueue, (void**)&qdu);
+    int err = SbqPeekQueueElement(&decodeUnitQueue, (void**)&qdu);
     if (err != LBQ_SUCCESS) {
         return false;
     }
@@ -276,7 +349,11 @@ bool LiPeekNextVideoFrame(PDECODE_UNIT* decodeUnit) {
 }
 
 void LiWakeWaitForVideoFrame(void) {
-    LbqSignalQueueUserWake(&decodeUnitQueue);
+    SbqSignalQueueUserWake(&decodeUnitQueue);
+}
+
+int LiGetVideoFrameReadyFd(void) {
+    return SbqGetReadyFd(&decodeUnitQueue);
 }
 
 // Cleanup a decode unit by freeing the buffer chain and the holder
@@ -463,6 +540,122 @@ static bool isIdrFrameStart(PBUFFER_DESC buffer) {
     }
 }
 
+// Only the depacketizer thread updates the drop stats
+static void addQueueDropStat(uint32_t* stat, uint32_t value) {
+    PltAtomicStore32(stat, PltAtomicLoad32(stat) + value);
+}
+
+static int offerDecodeUnit(PQUEUED_DECODE_UNIT qdu) {
+    int err = SbqOfferQueueItem(&decodeUnitQueue, qdu);
+    if (err == LBQ_SUCCESS) {
+        decodeUnitEnqueueTimes[decodeUnitsQueued++ % DECODE_UNIT_TIME_RING_SIZE] = qdu->decodeUnit.enqueueTimeMs;
+    }
+    return err;
+}
+
+static bool isDecodeUnitQueueOverLatencyCap(int queuedFrames, uint64_t oldestEnqueueTimeMs, uint64_t now) {
+    if (queuedFrames == 0) {
+        return false;
+    }
+    else if (StreamConfig.maxQueuedVideoFrames > 0 && queuedFrames >= StreamConfig.maxQueuedVideoFrames) {
+        return true;
+    }
+    else if (StreamConfig.maxQueuedVideoLatencyMs > 0 &&
+             now - oldestEnqueueTimeMs > (uint64_t)StreamConfig.maxQueuedVideoLatencyMs) {
+        return true;
+    }
+    else {
+        return false;
+    }
+}
+
+// Drops queued decode units to make room for a new one while keeping the decoder's
+// reference frames valid. Returns false if the new decode unit was dropped too.
+static bool dropQueuedDecodeUnits(PQUEUED_DECODE_UNIT qdu, bool overflow) {
+    void* decodeUnits[DECODE_UNIT_QUEUE_BOUND];
+    int frameNumber = qdu->decodeUnit.frameNumber;
+    int firstKept;
+    int count;
+
+    count = SbqFlushQueueItems(&decodeUnitQueue, decodeUnits);
+
+    // The consumer may have taken frames since we checked the latency cap
+    if (!overflow && !isDecodeUnitQueueOverLatencyCap(count,
+                                                      count > 0 ? ((PQUEUED_DECODE_UNIT)decodeUnits[0])->decodeUnit.enqueueTimeMs : 0,
+                                                      qdu->decodeUnit.enqueueTimeMs)) {
+        firstKept = 0;
+    }
+    else if (qdu->decodeUnit.frameType == FRAME_TYPE_IDR) {
+        firstKept = count;
+    }
+    else {
+        // Look for the newest queued IDR frame. An IDR frame at the head of the
+        // queue doesn't help since we wouldn't be dropping anything before it.
+        firstKept = -1;
+        for (int i = count - 1; i > 0; i--) {
+            if (((PQUEUED_DECODE_UNIT)decodeUnits[i])->decodeUnit.frameType == FRAME_TYPE_IDR) {
+                firstKept = i;
+                break;
+            }
+        }
+    }
+
+    if (firstKept >= 0) {
+        // Frames after an IDR frame can't reference frames before it, so we can
+        // drop everything older than the IDR frame without involving the host.
+        if (firstKept > 0) {
+            Limelog("Dropping %d queued frames to skip ahead to IDR frame\n", firstKept);
+            addQueueDropStat(&queueDropStats.droppedFrames, (uint32_t)firstKept);
+            addQueueDropStat(&queueDropStats.dropEvents, 1);
+            addQueueDropStat(&queueDropStats.idrSkipRecoveries, 1);
+        }
+
+        for (int i = 0; i < count; i++) {
+            if (i < firstKept || offerDecodeUnit(decodeUnits[i]) != LBQ_SUCCESS) {
+                LiCompleteVideoFrame(decodeUnits[i], DR_CLEANUP);
+            }
+        }
+
+        return true;
+    }
+
+    // Every queued frame and the new frame may reference the oldest queued frame,
+    // so we must drop them all and have the host recover the reference chain.
+    for (int i = 0; i < count; i++) {
+        LiCompleteVideoFrame(decodeUnits[i], DR_CLEANUP);
+    }
+    addQueueDropStat(&queueDropStats.droppedFrames, (uint32_t)count + 1);
+    addQueueDropStat(&queueDropStats.dropEvents, 1);
+
+    // The RFI window must start at the oldest frame that the decoder didn't get.
+    // The host was already told that the queued frames were received.
+    if (count > 0) {
+        startFrameNumber = ((PQUEUED_DECODE_UNIT)decodeUnits[0])->decodeUnit.frameNumber;
+    }
+
+    // Clear NAL state for the frame that we're not going to enqueue
+    nalChainHead = qdu->decodeUnit.bufferList;
+    nalChainDataLength = qdu->decodeUnit.fullLength;
+    free(qdu);
+
+    // Drop state and determine if we need an IDR frame or if RFI is okay
+    dropFrameState();
+
+    if (waitingForIdrFrame) {
+        Limelog("Requesting IDR frame after dropping %d queued frames\n", count + 1);
+        addQueueDropStat(&queueDropStats.idrRequestRecoveries, 1);
+        LiRequestIdrFrame();
+    }
+    else {
+        Limelog("Sending RFI request for frames %u-%d dropped from the decode unit queue\n",
+                startFrameNumber, frameNumber);
+        addQueueDropStat(&queueDropStats.refInvalRecoveries, 1);
+        connectionDetectedFrameLoss(startFrameNumber, frameNumber);
+    }
+
+    return false;
+}
+
 // Reassemble the frame with the given frame number
 static void reassembleFrame(int frameNumber) {
     if (nalChainHead != NULL) {
@@ -478,21 +671,7 @@ static void reassembleFrame(int frameNumber) {
         }
 
         if (qdu != NULL) {
-            qdu->decodeUnit.bufferList = nalChainHead;
-            qdu->decodeUnit.fullLength = nalChainDataLength;
-            qdu->decodeUnit.frameType = frameType;
-            qdu->decodeUnit.frameNumber = frameNumber;
-            qdu->decodeUnit.frameHostProcessingLatency = frameHostProcessingLatency;
-            qdu->decodeUnit.receiveTimeMs = firstPacketReceiveTime;
-            qdu->decodeUnit.presentationTimeMs = firstPacketPresentationTime;
-            qdu->decodeUnit.enqueueTimeMs = LiGetMillis();
-
-            // These might be wrong for a few frames during a transition between SDR and HDR,
-            // but the effects shouldn't very noticable since that's an infrequent operation.
-            //
-            // If we start sending this state in the frame header, we can make it 100% accurate.
-            qdu->decodeUnit.hdrActive = LiGetCurrentHostDisplayHdrMode();
-            qdu->decodeUnit.colorspace = (uint8_t)(qdu->decodeUnit.hdrActive ? COLORSPACE_REC_2020 : StreamConfig.colorSpace);
+            populateDecodeUnit(&qdu->decodeUnit, frameNumber);
 
             // Invoke the key frame callback if needed
             if (qdu->decodeUnit.frameType == FRAME_TYPE_IDR) {
@@ -503,28 +682,41 @@ static void reassembleFrame(int frameNumber) {
             nalChainDataLength = 0;
 
             if ((VideoCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {
-                if (LbqOfferQueueItem(&decodeUnitQueue, qdu, &qdu->entry) == LBQ_BOUND_EXCEEDED) {
-                    Limelog("Video decode unit queue overflow\n");
-
-                    // RFI recovery is not supported here
-                    waitingForIdrFrame = true;
+                int queuedFrames = SbqGetItemCount(&decodeUnitQueue);
+                int err;
+
+                // Frames are queued in order, so the oldest one was queued queuedFrames ago
+                if (isDecodeUnitQueueOverLatencyCap(queuedFrames,
+                                                    queuedFrames > 0 ? decodeUnitEnqueueTimes[(decodeUnitsQueued - queuedFrames) % DECODE_UNIT_TIME_RING_SIZE] : 0,
+                                                    qdu->decodeUnit.enqueueTimeMs) &&
+                        !dropQueuedDecodeUnits(qdu, false)) {
+                    return;
+                }
 
-                    // Clear NAL state for the frame that we failed to enqueue
-                    nalChainHead = qdu->decodeUnit.bufferList;
-                    nalChainDataLength = qdu->decodeUnit.fullLength;
-                    dropFrameState();
+                err = offerDecodeUnit(qdu);
+                if (err == LBQ_BOUND_EXCEEDED) {
+                    Limelog("Video decode unit queue overflow\n");
 
-                    // Free the DU we were going to queue
-                    free(qdu);
+                    if (!dropQueuedDecodeUnits(qdu, true)) {
+                        return;
+                    }
 
-                    // Free all frames in the decode unit queue
-                    freeDecodeUnitList(LbqFlushQueueItems(&decodeUnitQueue));
+                    err = offerDecodeUnit(qdu);
+                    LC_ASSERT(err != LBQ_BOUND_EXCEEDED);
+                }
 
-                    // Request an IDR frame to recover
-                    LiRequestIdrFrame();
+                if (err != LBQ_SUCCESS) {
+                    // We're shutting down
+                    LiCompleteVideoFrame(qdu, DR_CLEANUP);
                     return;
                 }
             }
+            else if (partialFrameSubmit) {
+                // Submit the rest of the frame to the decoder. Earlier parts of the frame
+                // may have been submitted already, so we can't validate the whole frame.
+                partialFrameSubmitted = false;
+                LiCompleteVideoFrame(qdu, VideoCallbacks.submitPartialDecodeUnit(&qdu->decodeUnit, PARTIAL_DU_FLAG_END_OF_FRAME));
+            }
             else {
                 // Submit the frame to the decoder
                 validateDecodeUnitForPlayback(&qdu->decodeUnit);
@@ -541,6 +733,10 @@ static void reassembleFrame(int frameNumber) {
             startFrameNumber = nextFrameNumber;
         }
     }
+    else {
+        // If we failed to allocate the rest of the frame, the decoder can't finish it
+        abortPartialFrame();
+    }
 }
 
 static int getBufferFlags(char* data, int length) {
@@ -643,6 +839,93 @@ static void queueFragment(PLENTRY_INTERNAL* existingEntry, char* data, int offse
     }
 }
 
+// Returns the offset of the last Annex B start sequence in the buffer or -1 if there is none.
+// Start sequences spanning multiple buffers are not detected.
+static int findLastAnnexBStartSequence(char* data, int length) {
+    for (int i = length - 3; i >= 0; i--) {
+        if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+            // Include the leading zero of a 4 byte start sequence
+            if (i > 0 && data[i - 1] == 0) {
+                i--;
+            }
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+// Submits all complete NALUs in the NAL chain to the decoder. The last NALU in the
+// chain may be continued by the next packet, so it is kept until a later NALU
+// starts or the frame ends.
+static void submitCompleteNalus(int frameNumber) {
+    PLENTRY_INTERNAL tail = (PLENTRY_INTERNAL)nalChainTail;
+    PLENTRY_INTERNAL remainder;
+    QUEUED_DECODE_UNIT qdu;
+    int naluStart;
+    int drStatus;
+
+    if (tail == NULL) {
+        return;
+    }
+
+    // Earlier fragments were searched when they were queued, so we only need
+    // to look for a new NALU in the most recent one.
+    naluStart = findLastAnnexBStartSequence(tail->entry.data, tail->entry.length);
+    if (naluStart < 0) {
+        // Still in the middle of the same NALU
+        return;
+    }
+    else if (naluStart == 0) {
+        // The whole fragment belongs to the incomplete NALU
+        if (nalChainHead == nalChainTail) {
+            return;
+        }
+
+        remainder = tail;
+
+        // Unlink the fragment from the chain
+        PLENTRY entry = nalChainHead;
+        while (entry->next != nalChainTail) {
+            entry = entry->next;
+        }
+        entry->next = NULL;
+        nalChainTail = entry;
+        nalChainDataLength -= remainder->entry.length;
+    }
+    else {
+        // Split the incomplete NALU into its own fragment
+        int remainderLength = tail->entry.length - naluStart;
+        remainder = (PLENTRY_INTERNAL)malloc(sizeof(*remainder) + remainderLength);
+        if (remainder == NULL) {
+            // We'll try again with the next packet
+            return;
+        }
+
+        remainder->allocPtr = remainder;
+        remainder->entry.next = NULL;
+        remainder->entry.data = (char*)(remainder + 1);
+        remainder->entry.length = remainderLength;
+        memcpy(remainder->entry.data, &tail->entry.data[naluStart], remainderLength);
+        remainder->entry.bufferType = getBufferFlags(remainder->entry.data, remainder->entry.length);
+
+        tail->entry.length = naluStart;
+        nalChainDataLength -= remainderLength;
+    }
+
+    populateDecodeUnit(&qdu.decodeUnit, frameNumber);
+    nalChainHead = nalChainTail = (PLENTRY)remainder;
+    nalChainDataLength = remainder->entry.length;
+
+    partialFrameSubmitted = true;
+    partialFrameNumber = frameNumber;
+    drStatus = VideoCallbacks.submitPartialDecodeUnit(&qdu.decodeUnit, 0);
+
+    // The frame isn't complete yet, so an IDR frame must not count as processed.
+    // If the decoder needs an IDR frame, the rest of this frame will be dropped.
+    LiCompleteVideoFrame(&qdu, drStatus == DR_NEED_IDR ? DR_NEED_IDR : DR_CLEANUP);
+}
+
 // Process an RTP Payload using the slow path that handles multiple NALUs per packet
 static void processAvcHevcRtpPayloadSlow(PBUFFER_DESC currentPos, PLENTRY_INTERNAL* existingEntry) {
     // We should not have any NALUs when processing the first packet in an IDR frame
@@ -712,7 +995,7 @@ void requestDecoderRefresh(void) {
     waitingForIdrFrame = true;
     
     // Flush the decode unit queue
-    freeDecodeUnitList(LbqFlushQueueItems(&decodeUnitQueue));
+    flushDecodeUnitQueue();
     
     // Request the receive thread drop its state
     // on the next call. We can't do it here because
@@ -1057,6 +1340,14 @@ static void processRtpPayload(PNV_VIDEO_PACKET videoPacket, int length,
         queueFragment(existingEntry, currentPos.data, currentPos.offset, currentPos.length);
     }
 
+    // If the decoder accepts partial frames, give it the complete NALUs that we have so far.
+    // This is only possible if we're not going to drop this frame when it completes.
+    if (partialFrameSubmit && !lastPacket &&
+            (NegotiatedVideoFormat & (VIDEO_FORMAT_MASK_H264 | VIDEO_FORMAT_MASK_H265)) &&
+            !waitingForIdrFrame && !waitingForRefInvalFrame && !dropStatePending) {
+        submitCompleteNalus(frameIndex);
+    }
+
     if (lastPacket) {
         // Move on to the next frame
         decodingFrame = false;
@@ -1122,6 +1413,18 @@ void notifyFrameLost(unsigned int frameNumber, bool speculative) {
     // We may not invalidate frames that we've already received
     LC_ASSERT(frameNumber >= startFrameNumber);
 
+    // The FEC queue submits each FEC block of a frame as soon as it is complete,
+    // so we may have already processed the first part of a lost frame. Roll back
+    // to the frame boundary and reject the remainder of the lost frame, since
+    // it can't be parsed without the missing FEC block.
+    if (decodingFrame) {
+        LC_ASSERT(!isBefore32(frameNumber, nextFrameNumber));
+        Limelog("Discarding partially received frame %u\n", nextFrameNumber);
+
+        decodingFrame = false;
+        nextFrameNumber = frameNumber + 1;
+    }
+
     // Drop state and determine if we need an IDR frame or if RFI is okay
     dropFrameState();
 
@@ -1165,7 +1468,7 @@ void queueRtpPacket(PRTPV_QUEUE_ENTRY queueEntryPtr) {
     // on the stack here so we can safely modify this memory in place.
     LC_ASSERT(sizeof(LENTRY_INTERNAL) <= sizeof(RTPV_QUEUE_ENTRY));
     PLENTRY_INTERNAL existingEntry = (PLENTRY_INTERNAL)queueEntryPtr;
-    existingEntry->allocPtr = queueEntry.packet;
+    existingEntry->allocPtr = queueEntry.allocPtr;
 
     processRtpPayload((PNV_VIDEO_PACKET)(((char*)queueEntry.packet) + dataOffset),
                       queueEntry.length - dataOffset,
@@ -1180,5 +1483,13 @@ void queueRtpPacket(PRTPV_QUEUE_ENTRY queueEntryPtr) {
 }
 
 int LiGetPendingVideoFrames(void) {
-    return LbqGetItemCount(&decodeUnitQueue);
+    return SbqGetItemCount(&decodeUnitQueue);
+}
+
+void LiGetVideoQueueDropStats(PVIDEO_QUEUE_DROP_STATS stats) {
+    stats->droppedFrames = PltAtomicLoad32(&queueDropStats.droppedFrames);
+    stats->dropEvents = PltAtomicLoad32(&queueDropStats.dropEvents);
+    stats->idrSkipRecoveries = PltAtomicLoad32(&queueDropStats.idrSkipRecoveries);
+    stats->refInvalRecoveries = PltAtomicLoad32(&queueDropStats.refInvalRecoveries);
+    stats->idrRequestRecoveries = PltAtomicLoad32(&queueDropStats.idrRequestRecoveries);
 }
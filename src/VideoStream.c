@@ -1,7 +1,7 @@
 #include "Limelight-internal.h"
 
 #define FIRST_FRAME_MAX 1500
-define FIRST_FRAME_TIMEOUT_SEC 60
+#define FIRST_FRAME_TIMEOUT_SEC 60
 
 #define FIRST_FRAME_PORT 47996
 
@@ -20,11 +20,6 @@ static bool receivedDataFromPeer;
 static uint64_t firstDataTimeMs;
 static bool receivedFullFrame;
 
-// We can't request an IDR frame until the depacketizer knows
-// that a packet was lost. This timeout bounds the time that
-// the RTP queue will wait for missing/reordered packets.
-#define RTP_QUEUE_DELAY 10
-
 // This is the desired number of video packets that can be
 // stored in the socket's receive buffer. 2048 is chosen
 // because it should be large enough for all reasonable
@@ -35,13 +30,20 @@ static bool receivedFullFrame;
 #define RTP_RECV_PACKETS_BUFFERED 2048
 
 // Initialize the video stream
-void initializeVideoStream(void) {
-    initializeVideoDepacketizer(StreamConfig.packetSize);
+int initializeVideoStream(void) {
+    int err;
+
+    err = initializeVideoDepacketizer(StreamConfig.packetSize);
+    if (err != 0) {
+        return err;
+    }
+
     RtpvInitializeQueue(&rtpQueue);
     decryptionCtx = PltCreateCryptoContext();
     receivedDataFromPeer = false;
     firstDataTimeMs = 0;
     receivedFullFrame = false;
+    return 0;
 }
 
 // Clean up the video stream
@@ -81,22 +83,53 @@ static void VideoPingThreadProc(void* context) {
     }
 }
 
+// Converts a received (and decrypted) packet to host byte-order and adds it to
+// the RTP queue. The packet starts packetOffset bytes into the buffer and its queue
+// entry follows at receiveSize. Returns true if the queue took ownership of the buffer.
+static bool queueReceivedPacket(char* buffer, int packetOffset, int length, int receiveSize, uint64_t receiveTimeUs) {
+    PRTP_PACKET packet;
+
+    // Convert fields to host byte-order
+    packet = (PRTP_PACKET)&buffer[packetOffset];
+    packet->sequenceNumber = BE16(packet->sequenceNumber);
+    packet->timestamp = BE32(packet->timestamp);
+    packet->ssrc = BE32(packet->ssrc);
+
+    return RtpvAddPacket(&rtpQueue, buffer, packet, length, (PRTPV_QUEUE_ENTRY)&buffer[receiveSize], receiveTimeUs) == RTPF_RET_QUEUED;
+}
+
+// Waits until the RTP socket is readable, an FEC worker finishes a recovery,
+// or the receive thread is interrupted
+static void waitForPacketOrFecRecovery(void) {
+    struct pollfd pfds[3];
+
+    pfds[0].fd = rtpSocket;
+    pfds[0].events = POLLIN;
+    pfds[1].fd = RtpvGetFecRecoveryFd(&rtpQueue);
+    pfds[1].events = POLLIN;
+    pfds[2].fd = PltGetThreadInterruptFd(&receiveThread);
+    pfds[2].events = POLLIN;
+    pollSockets(pfds, 3, -1);
+}
+
 // Receive thread proc
 static void VideoReceiveThreadProc(void* context) {
     int err;
-    int bufferSize, receiveSize, decryptedSize, minSize;
+    int bufferSize, receiveSize, decryptedSize, minSize, packetOffset;
     char* buffer;
-    char* encryptedBuffer;
-    int queueStatus;
     bool useSelect;
-    int waitingForVideoMs;
+    uint64_t waitStartMs;
+    uint64_t receiveTimeUs;
     bool encrypted;
 
+    // Encrypted packets are received and decrypted in place, so the plaintext
+    // RTP packet begins after the ENC_VIDEO_HEADER at the start of the buffer.
     encrypted = !!(EncryptionFeaturesEnabled & SS_ENC_VIDEO);
+    packetOffset = encrypted ? sizeof(ENC_VIDEO_HEADER) : 0;
     decryptedSize = StreamConfig.packetSize + MAX_RTP_HEADER_SIZE;
-    minSize = sizeof(RTP_PACKET) + ((EncryptionFeaturesEnabled & SS_ENC_VIDEO) ? sizeof(ENC_VIDEO_HEADER) : 0);
-    receiveSize = decryptedSize + ((EncryptionFeaturesEnabled & SS_ENC_VIDEO) ? sizeof(ENC_VIDEO_HEADER) : 0);
-    bufferSize = decryptedSize + sizeof(RTPV_QUEUE_ENTRY);
+    minSize = sizeof(RTP_PACKET) + packetOffset;
+    receiveSize = decryptedSize + packetOffset;
+    bufferSize = receiveSize + sizeof(RTPV_QUEUE_ENTRY);
     buffer = NULL;
 
     if (setNonFatalRecvTimeoutMs(rtpSocket, UDP_RECV_POLL_TIMEOUT_MS) < 0) {
@@ -108,23 +141,13 @@ static void VideoReceiveThreadProc(void* context) {
         useSelect = false;
     }
 
-    // Allocate a staging buffer to use for each received packet
-    if (encrypted) {
-        encryptedBuffer = (char*)malloc(receiveSize);
-        if (encryptedBuffer == NULL) {
-            Limelog("Video Receive: malloc() failed\n");
-            ListenerCallbacks.connectionTerminated(-1);
-            return;
-        }
-    }
-    else {
-        encryptedBuffer = NULL;
-    }
+#ifdef MSG_DONTWAIT
+    // FEC workers need non-blocking receives to keep the socket drained while they work
+    RtpvStartFecWorkers(&rtpQueue);
+#endif
 
-    waitingForVideoMs = 0;
+    waitStartMs = PltGetMillis();
     while (!PltIsThreadInterrupted(&receiveThread)) {
-        PRTP_PACKET packet;
-
         if (buffer == NULL) {
             buffer = (char*)malloc(bufferSize);
             if (buffer == NULL) {
@@ -134,10 +157,37 @@ static void VideoReceiveThreadProc(void* context) {
             }
         }
 
-        err = recvUdpSocket(rtpSocket,
-                            encrypted ? encryptedBuffer : buffer,
-                            receiveSize,
-                            useSelect);
+        if (RtpvHasPendingFecRecoveries(&rtpQueue)) {
+            // Keep draining the socket while FEC blocks are being recovered,
+            // and pick up the recovered FEC blocks once it's empty.
+            err = recvUdpSocketNoWait(rtpSocket, buffer, receiveSize);
+            if (err == 0) {
+                waitForPacketOrFecRecovery();
+                RtpvPollFecRecoveries(&rtpQueue);
+                continue;
+            }
+        }
+        else {
+            int timeoutMs = -1;
+
+            // Until the first packet arrives, wake up in time to give up on the stream.
+            // After that, we only need to wake up for packets or interruption.
+            if (!receivedDataFromPeer) {
+                uint64_t waitedMs = PltGetMillis() - waitStartMs;
+
+                timeoutMs = 0;
+                if (waitedMs < FIRST_FRAME_TIMEOUT_SEC * 1000) {
+                    timeoutMs = (int)(FIRST_FRAME_TIMEOUT_SEC * 1000 - waitedMs);
+                }
+            }
+
+            err = recvUdpSocket(rtpSocket,
+                                buffer,
+                                receiveSize,
+                                useSelect,
+                                PltGetThreadInterruptFd(&receiveThread),
+                                timeoutMs);
+        }
         if (err < 0) {
             Limelog("Video Receive: recvUdpSocket() failed: %d\n", (int)LastSocketError());
             ListenerCallbacks.connectionTerminated(LastSocketFail());
@@ -147,8 +197,7 @@ static void VideoReceiveThreadProc(void* context) {
             if (!receivedDataFromPeer) {
                 // If we wait many seconds without ever receiving a video packet,
                 // assume something is broken and terminate the connection.
-                waitingForVideoMs += UDP_RECV_POLL_TIMEOUT_MS;
-                if (waitingForVideoMs >= FIRST_FRAME_TIMEOUT_SEC * 1000) {
+                if (PltGetMillis() - waitStartMs >= FIRST_FRAME_TIMEOUT_SEC * 1000) {
                     Limelog("Terminating connection due to lack of video traffic\n");
                     ListenerCallbacks.connectionTerminated(ML_ERROR_NO_VIDEO_TRAFFIC);
                     break;
@@ -159,11 +208,12 @@ static void VideoReceiveThreadProc(void* context) {
             continue;
         }
 
+        receiveTimeUs = PltGetMicroseconds();
+
         if (!receivedDataFromPeer) {
             receivedDataFromPeer = true;
-            Limelog("Received first video packet after %d ms\n", waitingForVideoMs);
-
             firstDataTimeMs = PltGetMillis();
+            Limelog("Received first video packet after %d ms\n", (int)(firstDataTimeMs - waitStartMs));
         }
 
 #ifndef LC_FUZZING
@@ -183,12 +233,13 @@ static void VideoReceiveThreadProc(void* context) {
             continue;
         }
 
-        // Decrypt the packet into the buffer if encryption is enabled
         if (encrypted) {
-            PENC_VIDEO_HEADER encHeader = (PENC_VIDEO_HEADER)encryptedBuffer;
+            PENC_VIDEO_HEADER encHeader = (PENC_VIDEO_HEADER)buffer;
+            unsigned char* ciphertext = (unsigned char*)(encHeader + 1);
 
-            // If this frame is below our current frame number, discard it before decryption
-            // to save CPU cycles decrypting FEC shards for a frame we already reassembled.
+            // If this frame is below our current frame number or all of its FEC blocks are
+            // already complete, discard it before decryption to save CPU cycles decrypting
+            // FEC shards for a frame we already reassembled.
             //
             // Since this is happening _before_ decryption, this packet is not trusted yet.
             // It's imperative that we do not mutate any state based on this packet until
@@ -196,7 +247,7 @@ static void VideoReceiveThreadProc(void* context) {
             //
             // It's possible for an attacker to inject a fake packet that has any value of
             // header fields they want, however this provides them no benefit because we will
-            // simply drop said packet here (if it's below the current frame number) or it
+            // simply drop said packet here (if it's for a frame we're done with) or it
             // will pass this check and be dropped during decryption (if contents is tampered)
             // or after decryption in the RTP queue (if it's a replay of a previous authentic
             // packet from the host).
@@ -208,42 +259,51 @@ static void VideoReceiveThreadProc(void* context) {
             // couldn't already do. If they're not on-link, we just throw their malicious
             // traffic away (as mentioned in the paragraph above) and continue accepting
             // legitmate video traffic.
-            if (encHeader->frameNumber && LE32(encHeader->frameNumber) < RtpvGetCurrentFrameNumber(&rtpQueue)) {
+            if (encHeader->frameNumber && RtpvIsFrameDone(&rtpQueue, LE32(encHeader->frameNumber))) {
                 continue;
             }
 
+            // The ciphertext is after the header and is decrypted in place
             if (!PltDecryptMessage(decryptionCtx, ALGORITHM_AES_GCM, 0,
                                    (unsigned char*)StreamConfig.remoteInputAesKey, sizeof(StreamConfig.remoteInputAesKey),
                                    encHeader->iv, sizeof(encHeader->iv),
                                    encHeader->tag, sizeof(encHeader->tag),
-                                   ((unsigned char*)(encHeader + 1)), err - sizeof(ENC_VIDEO_HEADER), // The ciphertext is after the header
-                                   (unsigned char*)buffer, &err)) {
+                                   ciphertext, err - sizeof(ENC_VIDEO_HEADER),
+                                   ciphertext, &err)) {
                 Limelog("Failed to decrypt video packet!\n");
                 continue;
             }
         }
 
-        // Convert fields to host byte-order
-        packet = (PRTP_PACKET)&buffer[0];
-        packet->sequenceNumber = BE16(packet->sequenceNumber);
-        packet->timestamp = BE32(packet->timestamp);
-        packet->ssrc = BE32(packet->ssrc);
-
-        queueStatus = RtpvAddPacket(&rtpQueue, packet, err, (PRTPV_QUEUE_ENTRY)&buffer[decryptedSize]);
-
-        if (queueStatus == RTPF_RET_QUEUED) {
+        if (queueReceivedPacket(buffer, packetOffset, err, receiveSize, receiveTimeUs)) {
             // The queue owns the buffer
             buffer = NULL;
         }
     }
 
+    RtpvStopFecWorkers(&rtpQueue);
+
     if (buffer != NULL) {
         free(buffer);
     }
+}
 
-    if (encryptedBuffer != NULL) {
-        free(encryptedBuffer);
-    }
+void getVideoReorderStats(PRTP_REORDER_STATS stats) {
+    stats->videoReorderedPackets = PltAtomicLoad32(&rtpQueue.reorderEstimator.reorderedPackets);
+    stats->videoReorderTolerancePackets = PltAtomicLoad32(&rtpQueue.reorderTolerance);
+    stats->videoDuplicatePackets = PltAtomicLoad32(&rtpQueue.replayWindow.rejectedPackets);
+}
+
+void LiGetVideoPacingStats(PVIDEO_PACING_STATS stats) {
+    stats->framesAnalyzed = PltAtomicLoad32(&rtpQueue.pacingStats.framesAnalyzed);
+    stats->avgFrameSpreadUs = PltAtomicLoad32(&rtpQueue.pacingStats.avgFrameSpreadUs);
+    stats->maxFrameSpreadUs = PltAtomicLoad32(&rtpQueue.pacingStats.maxFrameSpreadUs);
+    stats->avgMaxPacketGapUs = PltAtomicLoad32(&rtpQueue.pacingStats.avgMaxPacketGapUs);
+    stats->avgMaxBurstPackets = PltAtomicLoad32(&rtpQueue.pacingStats.avgMaxBurstPackets);
+    stats->maxBurstPackets = PltAtomicLoad32(&rtpQueue.pacingStats.maxBurstPackets);
+    stats->avgArrivalJitterUs = PltAtomicLoad32(&rtpQueue.pacingStats.avgArrivalJitterUs);
+    stats->fecRecoveredFrames = PltAtomicLoad32(&rtpQueue.pacingStats.fecRecoveredFrames);
+    stats->fecRecoveredAvgMaxBurstPackets = PltAtomicLoad32(&rtpQueue.pacingStats.fecRecoveredAvgMaxBurstPackets);
 }
 
 void notifyKeyFrameReceived(void) {
@@ -340,7 +400,7 @@ int startVideoStream(void* rendererContext, int drFlags) {
 
     VideoCallbacks.start();
 
-    err = PltCreateThread("VideoRecv", VideoReceiveThreadProc, NULL, &receiveThread);
+    err = PltCreateThread("VideoRecv", THREAD_ROLE_VIDEO_RECEIVE, VideoReceiveThreadProc, NULL, &receiveThread);
     if (err != 0) {
         VideoCallbacks.stop();
         closeSocket(rtpSocket);
@@ -349,7 +409,7 @@ int startVideoStream(void* rendererContext, int drFlags) {
     }
 
     if ((VideoCallbacks.capabilities & (CAPABILITY_DIRECT_SUBMIT | CAPABILITY_PULL_RENDERER)) == 0) {
-        err = PltCreateThread("VideoDec", VideoDecoderThreadProc, NULL, &decoderThread);
+        err = PltCreateThread("VideoDec", THREAD_ROLE_VIDEO_DECODE, VideoDecoderThreadProc, NULL, &decoderThread);
         if (err != 0) {
             VideoCallbacks.stop();
             PltInterruptThread(&receiveThread);
@@ -383,7 +443,7 @@ int startVideoStream(void* rendererContext, int drFlags) {
 
     // Start pinging before reading the first frame so GFE knows where
     // to send UDP data
-    err = PltCreateThread("VideoPing", VideoPingThreadProc, NULL, &udpPingThread);
+    err = PltCreateThread("VideoPing", THREAD_ROLE_DEFAULT, VideoPingThreadProc, NULL, &udpPingThread);
     if (err != 0) {
         VideoCallbacks.stop();
         stopVideoDepacketizer();
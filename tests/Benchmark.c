@@ -0,0 +1,27 @@
+#include "Benchmark.h"
+
+#include <stdlib.h>
+
+void BenchSpinUs(uint64_t us) {
+    uint64_t end = PltGetMicroseconds() + us;
+    while (PltGetMicroseconds() < end);
+}
+
+static int compareSamples(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+void BenchPrintPercentiles(const char* name, uint64_t* samples, int count) {
+    if (count == 0) {
+        printf("  %-14s no samples\n", name);
+        return;
+    }
+
+    qsort(samples, count, sizeof(*samples), compareSamples);
+    printf("  %-14s p50 %5llu us  p99 %5llu us  p99.9 %5llu us  max %5llu us\n", name,
+           (unsigned long long)samples[count / 2],
+           (unsigned long long)samples[count * 99 / 100],
+           (unsigned long long)samples[count * 999 / 1000],
+           (unsigned long long)samples[count - 1]);
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "Limelight-internal.h"
+
+// Busy-waits for the given time, for modeling work without sleeping
+void BenchSpinUs(uint64_t us);
+
+// Sorts the samples and prints their p50, p99, p99.9 and maximum
+void BenchPrintPercentiles(const char* name, uint64_t* samples, int count);
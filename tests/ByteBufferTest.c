@@ -0,0 +1,196 @@
+#include "Benchmark.h"
+#include "ByteBuffer.h"
+
+// Checks that the fixed byte-order unchecked accessors produce and parse the same
+// bytes as the checked accessors on a buffer of that byte order, then compares
+// how long each takes to write and read a small message.
+
+#define FIELD_VALUE_8 0x81
+#define FIELD_VALUE_16 0x8283
+#define FIELD_VALUE_32 0x84858687U
+#define FIELD_VALUE_64 0x88898A8B8C8D8E8FULL
+
+// 1 + 2 + 4 + 8 bytes
+#define MESSAGE_LENGTH 15
+
+#define BENCHMARK_MESSAGES 2000000
+
+static int failures;
+
+static const unsigned char expectedLittle[MESSAGE_LENGTH] = {
+    0x81,
+    0x83, 0x82,
+    0x87, 0x86, 0x85, 0x84,
+    0x8F, 0x8E, 0x8D, 0x8C, 0x8B, 0x8A, 0x89, 0x88,
+};
+
+static const unsigned char expectedBig[MESSAGE_LENGTH] = {
+    0x81,
+    0x82, 0x83,
+    0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8A, 0x8B, 0x8C, 0x8D, 0x8E, 0x8F,
+};
+
+static void putChecked(PBYTE_BUFFER buff, uint8_t c, uint16_t s, uint32_t i, uint64_t l) {
+    BbPut8(buff, c);
+    BbPut16(buff, s);
+    BbPut32(buff, i);
+    BbPut64(buff, l);
+}
+
+static void putUncheckedLE(PBYTE_BUFFER buff, uint8_t c, uint16_t s, uint32_t i, uint64_t l) {
+    BbPut8Unchecked(buff, c);
+    BbPut16LEUnchecked(buff, s);
+    BbPut32LEUnchecked(buff, i);
+    BbPut64LEUnchecked(buff, l);
+}
+
+static void putUncheckedBE(PBYTE_BUFFER buff, uint8_t c, uint16_t s, uint32_t i, uint64_t l) {
+    BbPut8Unchecked(buff, c);
+    BbPut16BEUnchecked(buff, s);
+    BbPut32BEUnchecked(buff, i);
+    BbPut64BEUnchecked(buff, l);
+}
+
+static void expectBytes(const char* buffer, const unsigned char* expected, const char* testName) {
+    if (memcmp(buffer, expected, MESSAGE_LENGTH) != 0) {
+        printf("%s: wrote unexpected bytes\n", testName);
+        failures++;
+    }
+}
+
+static void expectFields(uint8_t c, uint16_t s, uint32_t i, uint64_t l, const char* testName) {
+    if (c != FIELD_VALUE_8 || s != FIELD_VALUE_16 || i != FIELD_VALUE_32 || l != FIELD_VALUE_64) {
+        printf("%s: read unexpected values\n", testName);
+        failures++;
+    }
+}
+
+static void testRoundTrip(int byteOrder, const unsigned char* expected, const char* testName) {
+    char checkedBuffer[MESSAGE_LENGTH], uncheckedBuffer[MESSAGE_LENGTH];
+    BYTE_BUFFER checked, unchecked;
+    uint8_t c;
+    uint16_t s;
+    uint32_t i;
+    uint64_t l;
+
+    BbInitializeWrappedBuffer(&checked, checkedBuffer, 0, sizeof(checkedBuffer), byteOrder);
+    BbInitializeWrappedBuffer(&unchecked, uncheckedBuffer, 0, sizeof(uncheckedBuffer), byteOrder);
+
+    putChecked(&checked, FIELD_VALUE_8, FIELD_VALUE_16, FIELD_VALUE_32, FIELD_VALUE_64);
+    if (!BbReserve(&unchecked, MESSAGE_LENGTH)) {
+        printf("%s: unable to reserve the whole buffer\n", testName);
+        failures++;
+        return;
+    }
+    if (byteOrder == BYTE_ORDER_LITTLE) {
+        putUncheckedLE(&unchecked, FIELD_VALUE_8, FIELD_VALUE_16, FIELD_VALUE_32, FIELD_VALUE_64);
+    }
+    else {
+        putUncheckedBE(&unchecked, FIELD_VALUE_8, FIELD_VALUE_16, FIELD_VALUE_32, FIELD_VALUE_64);
+    }
+
+    expectBytes(checkedBuffer, expected, testName);
+    expectBytes(uncheckedBuffer, expected, testName);
+    if (checked.position != MESSAGE_LENGTH || unchecked.position != MESSAGE_LENGTH || BbReserve(&unchecked, 1)) {
+        printf("%s: unexpected position after writing\n", testName);
+        failures++;
+    }
+
+    // Read what the unchecked accessors wrote with the checked ones
+    BbInitializeWrappedBuffer(&checked, uncheckedBuffer, 0, sizeof(uncheckedBuffer), byteOrder);
+    if (!BbGet8(&checked, &c) || !BbGet16(&checked, &s) || !BbGet32(&checked, &i) || !BbGet64(&checked, &l)) {
+        printf("%s: checked read failed\n", testName);
+        failures++;
+        return;
+    }
+    expectFields(c, s, i, l, testName);
+
+    // And the other way around
+    BbInitializeWrappedBuffer(&unchecked, checkedBuffer, 0, sizeof(checkedBuffer), byteOrder);
+    BbGet8Unchecked(&unchecked, &c);
+    if (byteOrder == BYTE_ORDER_LITTLE) {
+        BbGet16LEUnchecked(&unchecked, &s);
+        BbGet32LEUnchecked(&unchecked, &i);
+        BbGet64LEUnchecked(&unchecked, &l);
+    }
+    else {
+        BbGet16BEUnchecked(&unchecked, &s);
+        BbGet32BEUnchecked(&unchecked, &i);
+        BbGet64BEUnchecked(&unchecked, &l);
+    }
+    expectFields(c, s, i, l, testName);
+
+    // The checked accessors stop at the end of the buffer
+    if (BbGet8(&checked, &c) || BbPut8(&checked, c)) {
+        printf("%s: accessed past the end of the buffer\n", testName);
+        failures++;
+    }
+}
+
+// Writes and reads back BENCHMARK_MESSAGES little-endian messages each way
+static void benchmarkAccessors(void) {
+    char buffer[MESSAGE_LENGTH];
+    BYTE_BUFFER buff;
+    uint64_t checkedUs, uncheckedUs, startUs;
+    uint64_t sum = 0;
+    uint8_t c;
+    uint16_t s;
+    uint32_t i;
+    uint64_t l;
+
+    startUs = PltGetMicroseconds();
+    for (uint32_t n = 0; n < BENCHMARK_MESSAGES; n++) {
+        BbInitializeWrappedBuffer(&buff, buffer, 0, sizeof(buffer), BYTE_ORDER_LITTLE);
+        putChecked(&buff, (uint8_t)n, (uint16_t)n, n, n);
+
+        BbInitializeWrappedBuffer(&buff, buffer, 0, sizeof(buffer), BYTE_ORDER_LITTLE);
+        BbGet8(&buff, &c);
+        BbGet16(&buff, &s);
+        BbGet32(&buff, &i);
+        BbGet64(&buff, &l);
+        sum += c + s + i + l;
+    }
+    checkedUs = PltGetMicroseconds() - startUs;
+
+    startUs = PltGetMicroseconds();
+    for (uint32_t n = 0; n < BENCHMARK_MESSAGES; n++) {
+        BbInitializeWrappedBuffer(&buff, buffer, 0, sizeof(buffer), BYTE_ORDER_LITTLE);
+        if (BbReserve(&buff, MESSAGE_LENGTH)) {
+            putUncheckedLE(&buff, (uint8_t)n, (uint16_t)n, n, n);
+        }
+
+        BbInitializeWrappedBuffer(&buff, buffer, 0, sizeof(buffer), BYTE_ORDER_LITTLE);
+        if (BbReserve(&buff, MESSAGE_LENGTH)) {
+            BbGet8Unchecked(&buff, &c);
+            BbGet16LEUnchecked(&buff, &s);
+            BbGet32LEUnchecked(&buff, &i);
+            BbGet64LEUnchecked(&buff, &l);
+        }
+        sum -= c + s + i + l;
+    }
+    uncheckedUs = PltGetMicroseconds() - startUs;
+
+    printf("Write and read of a %d byte message:\n", MESSAGE_LENGTH);
+    printf("  checked    %6.1f ns\n", checkedUs * 1000.0 / BENCHMARK_MESSAGES);
+    printf("  unchecked  %6.1f ns\n", uncheckedUs * 1000.0 / BENCHMARK_MESSAGES);
+
+    // Both loops read back the same values, and using the sum keeps them from being optimized out
+    if (sum != 0) {
+        printf("benchmark: checked and unchecked reads differ\n");
+        failures++;
+    }
+}
+
+int main(void) {
+    testRoundTrip(BYTE_ORDER_LITTLE, expectedLittle, "little-endian");
+    testRoundTrip(BYTE_ORDER_BIG, expectedBig, "big-endian");
+    benchmarkAccessors();
+
+    if (failures != 0) {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+
+    return 0;
+}
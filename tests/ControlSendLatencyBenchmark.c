@@ -0,0 +1,229 @@
+#include "Benchmark.h"
+
+#include <stdlib.h>
+
+// Compares the input send latency of the two ways ControlStream.c has handed messages
+// to the ENet host:
+// - Locked: the sender takes the host mutex and sends directly, so it waits behind
+//   whatever ENet housekeeping the control receive thread is doing.
+// - Ring: the sender submits to a lock-free ring and wakes the owner of the host with
+//   a loopback datagram, as ControlStream.c does now.
+//
+// ENet itself isn't involved. The control receive thread is modeled as a service pass
+// every SERVICE_INTERVAL_US that usually takes SERVICE_SHORT_US but takes SERVICE_LONG_US
+// every SERVICE_LONG_PERIOD passes, like a batch of retransmissions would.
+
+#define SEND_COUNT 1000
+#define SEND_INTERVAL_MIN_US 500
+#define RING_SIZE 128
+
+#define SERVICE_INTERVAL_US 2000
+#define SERVICE_SHORT_US 20
+#define SERVICE_LONG_US 500
+#define SERVICE_LONG_PERIOD 8
+
+// Time spent handing a message to ENet once the sender or owner has the host
+#define SEND_COST_US 2
+
+typedef struct _RING_SLOT {
+    uint32_t sequence;
+    uint64_t submitTimeUs;
+} RING_SLOT;
+
+static RING_SLOT ring[RING_SIZE];
+static uint32_t enqueuePos;
+static uint32_t dequeuePos;
+static uint32_t wakePending;
+static SOCKET wakeSock = INVALID_SOCKET;
+
+static PLT_MUTEX hostMutex;
+static bool useRing;
+static uint32_t senderDone;
+
+// Time the sender spent in the send call and time until the message reached ENet
+static uint64_t callUs[SEND_COUNT];
+static uint64_t handoffUs[SEND_COUNT];
+static int handoffCount;
+
+static SOCKET createWakeSocket(void) {
+    struct sockaddr_in addr;
+    SOCKADDR_LEN addrLen = sizeof(addr);
+    SOCKET s;
+
+    s = createSocket(AF_INET, SOCK_DGRAM, IPPROTO_UDP, true);
+    if (s == INVALID_SOCKET) {
+        return INVALID_SOCKET;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(s, (struct sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR ||
+            getsockname(s, (struct sockaddr*)&addr, &addrLen) == SOCKET_ERROR ||
+            connect(s, (struct sockaddr*)&addr, addrLen) == SOCKET_ERROR) {
+        closeSocket(s);
+        return INVALID_SOCKET;
+    }
+
+    return s;
+}
+
+static bool enqueue(void) {
+    uint32_t pos = PltAtomicLoad32(&enqueuePos);
+    RING_SLOT* slot;
+
+    for (;;) {
+        int32_t diff;
+
+        slot = &ring[pos % RING_SIZE];
+        diff = (int32_t)(PltAtomicLoad32(&slot->sequence) - pos);
+        if (diff == 0) {
+            if (PltAtomicCompareExchange32(&enqueuePos, pos, pos + 1)) {
+                break;
+            }
+        }
+        else if (diff < 0) {
+            return false;
+        }
+
+        pos = PltAtomicLoad32(&enqueuePos);
+    }
+
+    slot->submitTimeUs = PltGetMicroseconds();
+    PltAtomicStore32(&slot->sequence, pos + 1);
+    return true;
+}
+
+static void processRing(void) {
+    PltAtomicStore32(&wakePending, 0);
+
+    for (;;) {
+        RING_SLOT* slot = &ring[dequeuePos % RING_SIZE];
+
+        if (PltAtomicLoad32(&slot->sequence) != dequeuePos + 1) {
+            break;
+        }
+
+        BenchSpinUs(SEND_COST_US);
+        handoffUs[handoffCount++] = PltGetMicroseconds() - slot->submitTimeUs;
+
+        PltAtomicStore32(&slot->sequence, dequeuePos + RING_SIZE);
+        dequeuePos++;
+    }
+}
+
+static void ownerThreadProc(void* context) {
+    uint64_t nextServiceUs = PltGetMicroseconds();
+    int pass = 0;
+
+    while (!PltAtomicLoad32(&senderDone)) {
+        uint64_t now = PltGetMicroseconds();
+
+        if (now >= nextServiceUs) {
+            PltLockMutex(&hostMutex);
+            BenchSpinUs(++pass % SERVICE_LONG_PERIOD == 0 ? SERVICE_LONG_US : SERVICE_SHORT_US);
+            PltUnlockMutex(&hostMutex);
+            nextServiceUs += SERVICE_INTERVAL_US;
+        }
+
+        if (useRing) {
+            struct pollfd pfd;
+
+            processRing();
+
+            pfd.fd = wakeSock;
+            pfd.events = POLLIN;
+            if (pollSockets(&pfd, 1, 1) > 0 && (pfd.revents & POLLIN)) {
+                char buffer[16];
+                while (recv(wakeSock, buffer, sizeof(buffer), 0) > 0);
+            }
+        }
+        else {
+            PltSleepMs(1);
+        }
+    }
+
+    if (useRing) {
+        processRing();
+    }
+}
+
+static void senderThreadProc(void* context) {
+    for (int i = 0; i < SEND_COUNT; i++) {
+        uint64_t startUs;
+
+        // Randomize the send times so they don't line up with the service passes
+        BenchSpinUs(SEND_INTERVAL_MIN_US + rand() % SEND_INTERVAL_MIN_US);
+
+        startUs = PltGetMicroseconds();
+        if (useRing) {
+            while (!enqueue());
+            if (PltAtomicExchange32(&wakePending, 1) == 0) {
+                char wake = 0;
+                send(wakeSock, &wake, sizeof(wake), 0);
+            }
+        }
+        else {
+            PltLockMutex(&hostMutex);
+            BenchSpinUs(SEND_COST_US);
+            PltUnlockMutex(&hostMutex);
+            handoffUs[handoffCount++] = PltGetMicroseconds() - startUs;
+        }
+        callUs[i] = PltGetMicroseconds() - startUs;
+    }
+
+    PltAtomicStore32(&senderDone, 1);
+}
+
+static int runBenchmark(bool withRing) {
+    PLT_THREAD owner, sender;
+
+    useRing = withRing;
+    senderDone = 0;
+    handoffCount = 0;
+    enqueuePos = dequeuePos = wakePending = 0;
+    for (uint32_t i = 0; i < RING_SIZE; i++) {
+        ring[i].sequence = i;
+    }
+
+    if (PltCreateThread("Owner", THREAD_ROLE_CONTROL, ownerThreadProc, NULL, &owner) != 0) {
+        return -1;
+    }
+    if (PltCreateThread("Sender", THREAD_ROLE_INPUT_SEND, senderThreadProc, NULL, &sender) != 0) {
+        PltAtomicStore32(&senderDone, 1);
+        PltJoinThread(&owner);
+        return -1;
+    }
+
+    PltJoinThread(&sender);
+    PltJoinThread(&owner);
+
+    printf("%s:\n", withRing ? "Ring" : "Locked");
+    BenchPrintPercentiles("send call", callUs, SEND_COUNT);
+    BenchPrintPercentiles("submit to ENet", handoffUs, handoffCount);
+    return handoffCount == SEND_COUNT ? 0 : -1;
+}
+
+int main(void) {
+    int err;
+
+    if (initializePlatformSockets() != 0 || PltCreateMutex(&hostMutex) != 0) {
+        return 1;
+    }
+
+    wakeSock = createWakeSocket();
+    if (wakeSock == INVALID_SOCKET) {
+        printf("Unable to create wake socket: %d\n", (int)LastSocketError());
+        return 1;
+    }
+
+    err = runBenchmark(false);
+    if (err == 0) {
+        err = runBenchmark(true);
+    }
+
+    closeSocket(wakeSock);
+    PltDeleteMutex(&hostMutex);
+    cleanupPlatformSockets();
+    return err == 0 ? 0 : 1;
+}
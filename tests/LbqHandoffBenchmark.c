@@ -0,0 +1,130 @@
+#include "Benchmark.h"
+
+#include <stdlib.h>
+
+// Measures how long an element takes to get from LbqOfferQueueItem() on one thread to
+// LbqWaitForQueueElement() returning on another, and how much dequeuing a burst of
+// elements costs one at a time versus with LbqWaitForQueueElements().
+//
+// The build also produces a variant with LBQ_SPIN_COUNT set to 0, which blocks on the
+// condition variable right away like the queue did before waiters spun.
+
+#define HANDOFF_COUNT 2000
+#define HANDOFF_INTERVAL_MIN_US 100
+
+#define BURST_COUNT 2000
+#define BURST_SIZE 64
+
+typedef struct _ITEM {
+    LINKED_BLOCKING_QUEUE_ENTRY entry;
+    uint64_t offerTimeUs;
+} ITEM;
+
+static LINKED_BLOCKING_QUEUE queue;
+static ITEM items[HANDOFF_COUNT];
+static uint64_t handoffUs[HANDOFF_COUNT];
+
+static void producerThreadProc(void* context) {
+    for (int i = 0; i < HANDOFF_COUNT; i++) {
+        // Randomize the offer times so the consumer is sometimes still spinning
+        // and sometimes already blocked
+        BenchSpinUs(HANDOFF_INTERVAL_MIN_US + rand() % (2 * HANDOFF_INTERVAL_MIN_US));
+
+        items[i].offerTimeUs = PltGetMicroseconds();
+        if (LbqOfferQueueItem(&queue, &items[i], &items[i].entry) != LBQ_SUCCESS) {
+            break;
+        }
+    }
+}
+
+static int measureHandoff(void) {
+    PLT_THREAD producer;
+    int count;
+
+    if (LbqInitializeLinkedBlockingQueue(&queue, HANDOFF_COUNT) != LBQ_SUCCESS) {
+        return -1;
+    }
+
+    if (PltCreateThread("Producer", THREAD_ROLE_DEFAULT, producerThreadProc, NULL, &producer) != 0) {
+        LbqDestroyLinkedBlockingQueue(&queue);
+        return -1;
+    }
+
+    for (count = 0; count < HANDOFF_COUNT; count++) {
+        ITEM* item;
+
+        if (LbqWaitForQueueElement(&queue, (void**)&item) != LBQ_SUCCESS) {
+            break;
+        }
+
+        handoffUs[count] = PltGetMicroseconds() - item->offerTimeUs;
+    }
+
+    PltJoinThread(&producer);
+    LbqSignalQueueShutdown(&queue);
+    LbqDestroyLinkedBlockingQueue(&queue);
+
+#ifdef LBQ_SPIN_COUNT
+    printf("Handoff with a spin count of %d:\n", LBQ_SPIN_COUNT);
+#else
+    printf("Handoff with the default spin count:\n");
+#endif
+    BenchPrintPercentiles("offer to wake", handoffUs, count);
+    return count == HANDOFF_COUNT ? 0 : -1;
+}
+
+static void offerBurst(void) {
+    for (int i = 0; i < BURST_SIZE; i++) {
+        LbqOfferQueueItem(&queue, &items[i], &items[i].entry);
+    }
+}
+
+static int measureBurstDequeue(void) {
+    uint64_t singleUs = 0, batchUs = 0;
+    int dequeued = 0;
+
+    if (LbqInitializeLinkedBlockingQueue(&queue, BURST_SIZE) != LBQ_SUCCESS) {
+        return -1;
+    }
+
+    for (int burst = 0; burst < BURST_COUNT; burst++) {
+        PLINKED_BLOCKING_QUEUE_ENTRY entries;
+        uint64_t startUs;
+        void* data;
+
+        offerBurst();
+        startUs = PltGetMicroseconds();
+        for (int i = 0; i < BURST_SIZE; i++) {
+            if (LbqWaitForQueueElement(&queue, &data) == LBQ_SUCCESS) {
+                dequeued++;
+            }
+        }
+        singleUs += PltGetMicroseconds() - startUs;
+
+        offerBurst();
+        startUs = PltGetMicroseconds();
+        if (LbqWaitForQueueElements(&queue, 0, &entries) == LBQ_SUCCESS) {
+            while (entries != NULL) {
+                dequeued++;
+                entries = entries->flink;
+            }
+        }
+        batchUs += PltGetMicroseconds() - startUs;
+    }
+
+    LbqSignalQueueShutdown(&queue);
+    LbqDestroyLinkedBlockingQueue(&queue);
+
+    printf("Dequeue of %d element bursts:\n", BURST_SIZE);
+    printf("  one at a time  %6.1f ns per element\n", singleUs * 1000.0 / (BURST_COUNT * BURST_SIZE));
+    printf("  batch          %6.1f ns per element\n", batchUs * 1000.0 / (BURST_COUNT * BURST_SIZE));
+    return dequeued == 2 * BURST_COUNT * BURST_SIZE ? 0 : -1;
+}
+
+int main(void) {
+    if (measureHandoff() != 0 || measureBurstDequeue() != 0) {
+        return 1;
+    }
+
+    return 0;
+}
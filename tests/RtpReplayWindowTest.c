@@ -0,0 +1,108 @@
+#include "RtpReplayWindow.h"
+
+#include <stdio.h>
+
+static int failures;
+
+static void expectAdd(PRTP_REPLAY_WINDOW window, uint16_t sequenceNumber, bool expected, const char* testName) {
+    if (RtpwAddPacket(window, sequenceNumber) != expected) {
+        printf("%s: sequence number %u was %s\n", testName, sequenceNumber, expected ? "rejected" : "accepted");
+        failures++;
+    }
+}
+
+// Adds the range [first, last] and expects all of them to be accepted once and rejected the second time
+static void expectFreshRange(PRTP_REPLAY_WINDOW window, uint16_t first, uint16_t last, const char* testName) {
+    for (uint16_t i = first; i != (uint16_t)(last + 1); i++) {
+        expectAdd(window, i, true, testName);
+    }
+    for (uint16_t i = first; i != (uint16_t)(last + 1); i++) {
+        expectAdd(window, i, false, testName);
+    }
+}
+
+static void testDuplicates(void) {
+    RTP_REPLAY_WINDOW window;
+
+    RtpwInitialize(&window);
+    expectFreshRange(&window, 0, 100, "duplicates");
+
+    // Reordered packets within the window are accepted once
+    expectAdd(&window, 200, true, "duplicates");
+    expectAdd(&window, 150, true, "duplicates");
+    expectAdd(&window, 150, false, "duplicates");
+}
+
+static void testSequenceNumberWrap(void) {
+    RTP_REPLAY_WINDOW window;
+
+    RtpwInitialize(&window);
+    expectFreshRange(&window, 65000, 65535, "wrap");
+    expectFreshRange(&window, 0, 500, "wrap");
+
+    // Packets from before the wrap are still recognized
+    expectAdd(&window, 65500, false, "wrap");
+}
+
+static void testLargeJumps(void) {
+    // Try every jump size around the window size from every position within a word,
+    // since the bitmap is cleared differently depending on where the jump lands.
+    for (uint16_t jump = RTPW_WINDOW_BITS - 128; jump <= RTPW_WINDOW_BITS + 64; jump++) {
+        for (uint16_t start = 0; start < 64; start++) {
+            RTP_REPLAY_WINDOW window;
+            uint16_t last = start + 60;
+
+            RtpwInitialize(&window);
+            expectFreshRange(&window, start, last, "large jump");
+            expectFreshRange(&window, last + jump, last + jump + 30, "large jump");
+        }
+    }
+}
+
+static void testTooOld(void) {
+    RTP_REPLAY_WINDOW window;
+
+    RtpwInitialize(&window);
+    expectAdd(&window, 5000, true, "too old");
+
+    // Packets at least a window (minus one word) behind can't be tracked
+    expectAdd(&window, 5000 - (RTPW_WINDOW_BITS - 64), false, "too old");
+    expectAdd(&window, 5000 - (RTPW_WINDOW_BITS - 65), true, "too old");
+}
+
+static void testCheckWithoutRecording(void) {
+    RTP_REPLAY_WINDOW window;
+
+    RtpwInitialize(&window);
+    expectAdd(&window, 100, true, "check only");
+
+    // Checking a sequence number doesn't record it or move the window
+    if (RtpwIsDuplicate(&window, 101) || RtpwIsDuplicate(&window, 100 + RTPW_WINDOW_BITS)) {
+        printf("check only: new sequence number reported as a duplicate\n");
+        failures++;
+    }
+    if (!RtpwIsDuplicate(&window, 100)) {
+        printf("check only: duplicate sequence number not reported\n");
+        failures++;
+    }
+    expectAdd(&window, 101, true, "check only");
+    expectAdd(&window, 99, true, "check only");
+
+    RtpwRecordPacket(&window, 102);
+    expectAdd(&window, 102, false, "check only");
+}
+
+int main(void) {
+    testDuplicates();
+    testSequenceNumberWrap();
+    testLargeJumps();
+    testTooOld();
+    testCheckWithoutRecording();
+
+    if (failures != 0) {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+
+    return 0;
+}
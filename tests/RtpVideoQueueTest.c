@@ -0,0 +1,329 @@
+#include "Limelight-internal.h"
+#include "rs.h"
+
+#include <stdlib.h>
+
+// Feeds synthetic video streams through the RtpVideoQueue and checks which frames
+// make it to the depacketizer. The depacketizer and control stream entry points
+// that the queue calls are stubbed out below.
+
+#define PACKET_SIZE 256
+#define RECEIVE_SIZE (PACKET_SIZE + MAX_RTP_HEADER_SIZE)
+#define DATA_PACKETS 4
+#define FEC_PERCENTAGE 75
+#define PARITY_PACKETS ((DATA_PACKETS * FEC_PERCENTAGE + 99) / 100)
+#define FRAME_PACKETS (DATA_PACKETS + PARITY_PACKETS)
+
+#define FRAME_COUNT 400
+
+// Every this many frames, the first packet of the next frame overtakes the
+// last few packets of the current one
+#define REORDER_PERIOD 4
+#define REORDER_DEPTH 4
+
+static int failures;
+
+static uint32_t deliveredFrames;
+static uint32_t lastDeliveredFrame;
+static uint32_t deliveredFramePackets;
+static uint32_t frameDataPackets;
+static uint32_t lostFrameNotifications;
+
+void queueRtpPacket(PRTPV_QUEUE_ENTRY queueEntry) {
+    PNV_VIDEO_PACKET nvPacket = (PNV_VIDEO_PACKET)(((char*)queueEntry->packet) + MAX_RTP_HEADER_SIZE);
+
+    if (nvPacket->frameIndex != lastDeliveredFrame) {
+        if (nvPacket->frameIndex < lastDeliveredFrame) {
+            printf("frame %u was delivered after frame %u\n", nvPacket->frameIndex, lastDeliveredFrame);
+            failures++;
+        }
+
+        lastDeliveredFrame = nvPacket->frameIndex;
+        deliveredFramePackets = 0;
+    }
+
+    if (++deliveredFramePackets == frameDataPackets) {
+        deliveredFrames++;
+    }
+
+    free(queueEntry->allocPtr);
+}
+
+void notifyFrameLost(unsigned int frameNumber, bool speculative) {
+    lostFrameNotifications++;
+}
+
+void connectionSawFrame(uint32_t frameIndex) {
+}
+
+void connectionSendFrameFecStatus(PSS_FRAME_FEC_STATUS fecStatus) {
+}
+
+void mediaClockAddVideoFrame(uint32_t presentationTimeMs, uint64_t receiveTimeMs) {
+}
+
+// Builds the data and parity packets of an FEC block, in sequence order. Each
+// buffer has room for the RTPV_QUEUE_ENTRY after the packet, like VideoStream.c.
+static void buildFecBlock(uint32_t frameIndex, uint8_t blockNumber, uint8_t lastBlockNumber,
+                          uint16_t firstSequenceNumber, unsigned char* packets[FRAME_PACKETS]) {
+    reed_solomon* rs = reed_solomon_new(DATA_PACKETS, PARITY_PACKETS);
+
+    for (int i = 0; i < FRAME_PACKETS; i++) {
+        PNV_VIDEO_PACKET nvPacket;
+
+        packets[i] = malloc(RECEIVE_SIZE + sizeof(RTPV_QUEUE_ENTRY));
+        memset(packets[i], 0, RECEIVE_SIZE);
+        if (i >= DATA_PACKETS) {
+            continue;
+        }
+
+        nvPacket = (PNV_VIDEO_PACKET)(packets[i] + MAX_RTP_HEADER_SIZE);
+        nvPacket->streamPacketIndex = (frameIndex * DATA_PACKETS + i) << 8;
+        nvPacket->flags = FLAG_CONTAINS_PIC_DATA;
+        if (i == 0) {
+            nvPacket->flags |= FLAG_SOF;
+        }
+        if (i == DATA_PACKETS - 1) {
+            nvPacket->flags |= FLAG_EOF;
+        }
+        for (int j = sizeof(*nvPacket); j < PACKET_SIZE; j++) {
+            ((unsigned char*)nvPacket)[j] = (unsigned char)rand();
+        }
+    }
+
+    reed_solomon_encode(rs, packets, FRAME_PACKETS, RECEIVE_SIZE);
+    reed_solomon_release(rs);
+
+    // The RTP header and FEC details are filled in after encoding, like the host does.
+    // The receive thread has already converted the RTP header to host byte order.
+    for (int i = 0; i < FRAME_PACKETS; i++) {
+        PRTP_PACKET rtpPacket = (PRTP_PACKET)packets[i];
+        PNV_VIDEO_PACKET nvPacket = (PNV_VIDEO_PACKET)(packets[i] + MAX_RTP_HEADER_SIZE);
+
+        rtpPacket->header = 0x80 | FLAG_EXTENSION;
+        rtpPacket->sequenceNumber = (uint16_t)(firstSequenceNumber + i);
+        rtpPacket->timestamp = frameIndex * 16 * 90;
+        rtpPacket->ssrc = 0;
+
+        nvPacket->frameIndex = frameIndex;
+        nvPacket->multiFecFlags = 0x10;
+        nvPacket->multiFecBlocks = ((lastBlockNumber << 2) | blockNumber) << 4;
+        nvPacket->fecInfo = DATA_PACKETS << 22 | i << 12 | FEC_PERCENTAGE << 4;
+    }
+}
+
+static void addPacket(PRTP_VIDEO_QUEUE queue, unsigned char* buffer, uint64_t receiveTimeUs) {
+    if (RtpvAddPacket(queue, buffer, (PRTP_PACKET)buffer, RECEIVE_SIZE,
+                      (PRTPV_QUEUE_ENTRY)&buffer[RECEIVE_SIZE], receiveTimeUs) != RTPF_RET_QUEUED) {
+        free(buffer);
+    }
+}
+
+// Sends FRAME_COUNT frames, reordering some frame boundaries, and returns the number
+// of frames that were delivered
+static uint32_t runReorderedStream(int reassemblyWindow, uint32_t* reorderedFrames, uint32_t* savedBlocks) {
+    RTP_VIDEO_QUEUE queue;
+    unsigned char* packets[FRAME_COUNT][FRAME_PACKETS];
+    uint64_t receiveTimeUs = 0;
+
+    StreamConfig.videoReassemblyWindow = reassemblyWindow;
+    RtpvInitializeQueue(&queue);
+    frameDataPackets = DATA_PACKETS;
+
+    deliveredFrames = lastDeliveredFrame = deliveredFramePackets = lostFrameNotifications = 0;
+    *reorderedFrames = 0;
+
+    for (uint32_t frame = 0; frame < FRAME_COUNT; frame++) {
+        // Frame numbers start at 1
+        buildFecBlock(frame + 1, 0, 0, (uint16_t)(frame * FRAME_PACKETS), packets[frame]);
+    }
+
+    for (uint32_t frame = 0; frame < FRAME_COUNT; frame++) {
+        bool reorder = frame % REORDER_PERIOD == REORDER_PERIOD - 1 && frame + 1 < FRAME_COUNT;
+
+        for (int i = 0; i < FRAME_PACKETS; i++) {
+            if (reorder && i == FRAME_PACKETS - REORDER_DEPTH) {
+                // Send the first packet of the next frame early
+                addPacket(&queue, packets[frame + 1][0], receiveTimeUs += 10);
+                packets[frame + 1][0] = NULL;
+                (*reorderedFrames)++;
+            }
+
+            if (packets[frame][i] != NULL) {
+                addPacket(&queue, packets[frame][i], receiveTimeUs += 10);
+            }
+        }
+
+        receiveTimeUs += 16000;
+    }
+
+    *savedBlocks = queue.reorderedFecBlocksCompleted;
+    RtpvCleanupQueue(&queue);
+    return deliveredFrames;
+}
+
+static void testReorderedFrameBoundaries(void) {
+    uint32_t reorderedFrames, savedBlocks;
+    uint32_t withoutWindow, withWindow;
+
+    // The data packets of the reordered frames are among the packets that get
+    // overtaken, so they can't be recovered without them
+    LC_ASSERT(REORDER_DEPTH > PARITY_PACKETS);
+
+    withoutWindow = runReorderedStream(1, &reorderedFrames, &savedBlocks);
+    printf("Reassembly window of 1: %u of %u frames delivered, %u loss notifications\n",
+           withoutWindow, FRAME_COUNT, lostFrameNotifications);
+    if (withoutWindow != FRAME_COUNT - reorderedFrames) {
+        printf("reorder: expected %u frames lost without the window\n", reorderedFrames);
+        failures++;
+    }
+
+    withWindow = runReorderedStream(0, &reorderedFrames, &savedBlocks);
+    printf("Default reassembly window: %u of %u frames delivered, %u loss notifications\n",
+           withWindow, FRAME_COUNT, lostFrameNotifications);
+    printf("%u frames saved by the window\n", withWindow - withoutWindow);
+    if (withWindow != FRAME_COUNT || lostFrameNotifications != 0) {
+        printf("reorder: expected every frame to be delivered with the window\n");
+        failures++;
+    }
+    if (savedBlocks != reorderedFrames) {
+        printf("reorder: %u reordered FEC blocks counted, expected %u\n", savedBlocks, reorderedFrames);
+        failures++;
+    }
+}
+
+// Sends FRAME_COUNT frames in order, preceding each packet with an invalid copy
+// of it that the queue rejects, and returns the number of frames that were delivered
+static uint32_t runStreamWithInvalidPackets(bool runt) {
+    RTP_VIDEO_QUEUE queue;
+    unsigned char* packets[FRAME_PACKETS];
+    uint64_t receiveTimeUs = 0;
+
+    StreamConfig.videoReassemblyWindow = 0;
+    RtpvInitializeQueue(&queue);
+    frameDataPackets = DATA_PACKETS;
+
+    deliveredFrames = lastDeliveredFrame = deliveredFramePackets = lostFrameNotifications = 0;
+
+    for (uint32_t frame = 0; frame < FRAME_COUNT; frame++) {
+        buildFecBlock(frame + 1, 0, 0, (uint16_t)(frame * FRAME_PACKETS), packets);
+
+        for (int i = 0; i < FRAME_PACKETS; i++) {
+            unsigned char* invalid = malloc(RECEIVE_SIZE + sizeof(RTPV_QUEUE_ENTRY));
+            int length = RECEIVE_SIZE;
+
+            memcpy(invalid, packets[i], RECEIVE_SIZE);
+            if (runt) {
+                // Too short to hold a NV_VIDEO_PACKET
+                length = MAX_RTP_HEADER_SIZE;
+            }
+            else {
+                // Belongs to the frame before, which was already delivered
+                ((PNV_VIDEO_PACKET)(invalid + MAX_RTP_HEADER_SIZE))->frameIndex = frame;
+            }
+
+            if (RtpvAddPacket(&queue, invalid, (PRTP_PACKET)invalid, length,
+                              (PRTPV_QUEUE_ENTRY)&invalid[RECEIVE_SIZE], receiveTimeUs += 10) == RTPF_RET_QUEUED) {
+                printf("invalid packets: packet %d of frame %u was queued\n", i, frame + 1);
+                failures++;
+            }
+            else {
+                free(invalid);
+            }
+
+            addPacket(&queue, packets[i], receiveTimeUs += 10);
+        }
+
+        receiveTimeUs += 16000;
+    }
+
+    RtpvCleanupQueue(&queue);
+    return deliveredFrames;
+}
+
+static void testInvalidPackets(void) {
+    // Rejected packets must not use up their sequence numbers
+    if (runStreamWithInvalidPackets(true) != FRAME_COUNT) {
+        printf("invalid packets: runt packets caused frames to be lost\n");
+        failures++;
+    }
+    if (runStreamWithInvalidPackets(false) != FRAME_COUNT) {
+        printf("invalid packets: packets of old frames caused frames to be lost\n");
+        failures++;
+    }
+}
+
+// Sends FRAME_COUNT frames of two FEC blocks, each missing a data packet, so their
+// FEC blocks are recovered by the FEC workers. The last parity packet of each FEC
+// block arrives after it has enough packets, usually while it's being recovered.
+static void testRecoveryOnFecWorkers(void) {
+    RTP_VIDEO_QUEUE queue;
+    unsigned char* packets[FRAME_PACKETS];
+    uint64_t receiveTimeUs = 0;
+    uint16_t sequenceNumber = 0;
+
+    StreamConfig.videoReassemblyWindow = 0;
+    RtpvInitializeQueue(&queue);
+    RtpvStartFecWorkers(&queue);
+    frameDataPackets = 2 * DATA_PACKETS;
+
+    deliveredFrames = lastDeliveredFrame = deliveredFramePackets = lostFrameNotifications = 0;
+
+    for (uint32_t frame = 0; frame < FRAME_COUNT; frame++) {
+        for (uint8_t blockNumber = 0; blockNumber < 2; blockNumber++) {
+            buildFecBlock(frame + 1, blockNumber, 1, sequenceNumber, packets);
+            sequenceNumber += FRAME_PACKETS;
+
+            free(packets[1]);
+            for (int i = 0; i < FRAME_PACKETS; i++) {
+                if (i != 1) {
+                    addPacket(&queue, packets[i], receiveTimeUs += 10);
+                }
+            }
+        }
+
+        // Wait for the recoveries before the next frame, so it doesn't push this one
+        // out of the reassembly window
+        while (RtpvHasPendingFecRecoveries(&queue)) {
+            struct pollfd pfd;
+
+            pfd.fd = RtpvGetFecRecoveryFd(&queue);
+            pfd.events = POLLIN;
+            if (pollSockets(&pfd, 1, 1000) <= 0) {
+                printf("FEC workers: timed out waiting for a recovery\n");
+                failures++;
+                break;
+            }
+
+            RtpvPollFecRecoveries(&queue);
+        }
+
+        receiveTimeUs += 16000;
+    }
+
+    RtpvStopFecWorkers(&queue);
+    RtpvCleanupQueue(&queue);
+
+    if (deliveredFrames != FRAME_COUNT || lostFrameNotifications != 0) {
+        printf("FEC workers: %u of %u frames delivered\n", deliveredFrames, FRAME_COUNT);
+        failures++;
+    }
+}
+
+int main(void) {
+    AppVersionQuad[0] = 7;
+    AppVersionQuad[1] = 1;
+    AppVersionQuad[2] = 431;
+    StreamConfig.packetSize = PACKET_SIZE;
+
+    testReorderedFrameBoundaries();
+    testInvalidPackets();
+    testRecoveryOnFecWorkers();
+
+    if (failures != 0) {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+
+    return 0;
+}
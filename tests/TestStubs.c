@@ -0,0 +1,6 @@
+#include "Limelight-internal.h"
+
+// Globals normally defined by Connection.c, which isn't linked into the tests
+int AppVersionQuad[4];
+STREAM_CONFIGURATION StreamConfig;
+CONNECTION_LISTENER_CALLBACKS ListenerCallbacks;